@@ -55,8 +55,7 @@ void ngraph::he::HEPlainTensor::write(const void* source, size_t n) {
       m_plaintexts[0].values() = {f};
     }
   } else {
-#pragma omp parallel for
-    for (size_t i = 0; i < num_elements_to_write; ++i) {
+    auto write_element = [&](size_t i) {
       const void* src_with_offset = static_cast<const void*>(
           static_cast<const char*>(source) + i * type_byte_size);
       if (m_batch_size > 1) {
@@ -75,7 +74,9 @@ void ngraph::he::HEPlainTensor::write(const void* source, size_t n) {
         const float f = *static_cast<const float*>(src_with_offset);
         m_plaintexts[i].values() = {f};
       }
-    }
+    };
+    m_he_seal_backend.get_thread_pool().parallel_for(0, num_elements_to_write,
+                                                     write_element);
   }
 }
 
@@ -92,8 +93,7 @@ void ngraph::he::HEPlainTensor::read(void* target, size_t n) const {
     NGRAPH_CHECK(values.size() > 0, "Cannot read from empty plaintext");
     memcpy(dst_with_offset, &values[0], type_byte_size * m_batch_size);
   } else {
-#pragma omp parallel for
-    for (size_t i = 0; i < num_elements_to_read; ++i) {
+    auto read_element = [&](size_t i) {
       const std::vector<float>& values = m_plaintexts[i].values();
       NGRAPH_CHECK(values.size() >= m_batch_size, "values size ", values.size(),
                    " is smaller than batch size ", m_batch_size);
@@ -105,7 +105,9 @@ void ngraph::he::HEPlainTensor::read(void* target, size_t n) const {
         const void* src = static_cast<const void*>(&values[j]);
         memcpy(dst_with_offset, src, type_byte_size);
       }
-    }
+    };
+    m_he_seal_backend.get_thread_pool().parallel_for(0, num_elements_to_read,
+                                                     read_element);
   }
 }
 
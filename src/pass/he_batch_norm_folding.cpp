@@ -0,0 +1,163 @@
+//*****************************************************************************
+// Copyright 2018-2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//*****************************************************************************
+
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "ngraph/graph_util.hpp"
+#include "ngraph/log.hpp"
+#include "ngraph/op/add.hpp"
+#include "ngraph/op/batch_norm.hpp"
+#include "ngraph/op/broadcast.hpp"
+#include "ngraph/op/concat.hpp"
+#include "ngraph/op/constant.hpp"
+#include "ngraph/op/convolution.hpp"
+#include "ngraph/op/dot.hpp"
+#include "pass/he_batch_norm_folding.hpp"
+
+namespace {
+// Returns the values of node if it is an f32 constant, else an empty vector
+std::vector<float> constant_values(const std::shared_ptr<ngraph::Node>& node) {
+  auto constant = std::dynamic_pointer_cast<ngraph::op::Constant>(node);
+  if (constant == nullptr ||
+      constant->get_element_type() != ngraph::element::f32) {
+    return {};
+  }
+  return constant->get_vector<float>();
+}
+
+// Returns a copy of node whose output channels, starting at channel_offset,
+// are multiplied by scale, or nullptr if node is not a Convolution or Dot
+// with constant weights, or a Concat of them along the channel axis. Only
+// nodes whose sole user is the folded op are rewritten
+std::shared_ptr<ngraph::Node> scale_output_channels(
+    const std::shared_ptr<ngraph::Node>& node, const std::vector<double>& scale,
+    size_t channel_offset) {
+  if (node->get_users().size() != 1) {
+    return nullptr;
+  }
+  if (auto conv = std::dynamic_pointer_cast<ngraph::op::Convolution>(node)) {
+    // Filters are {C_out, C_in, spatial...}
+    std::vector<float> filters = constant_values(conv->get_argument(1));
+    if (filters.empty()) {
+      return nullptr;
+    }
+    const ngraph::Shape& filter_shape = conv->get_argument(1)->get_shape();
+    size_t channel_size = filters.size() / filter_shape[0];
+    NGRAPH_CHECK(channel_offset + filter_shape[0] <= scale.size(),
+                 "Convolution has more channels than the batch norm");
+    for (size_t i = 0; i < filters.size(); ++i) {
+      filters[i] *= scale[channel_offset + i / channel_size];
+    }
+    auto new_filters = ngraph::op::Constant::create(ngraph::element::f32,
+                                                    filter_shape, filters);
+    return conv->copy_with_new_args({conv->get_argument(0), new_filters});
+  }
+  if (auto dot = std::dynamic_pointer_cast<ngraph::op::Dot>(node)) {
+    // Only {N, K} x {K, C}, whose output channels are the weight columns
+    if (dot->get_reduction_axes_count() != 1 ||
+        dot->get_argument(0)->get_shape().size() != 2 ||
+        dot->get_argument(1)->get_shape().size() != 2) {
+      return nullptr;
+    }
+    std::vector<float> weights = constant_values(dot->get_argument(1));
+    if (weights.empty()) {
+      return nullptr;
+    }
+    const ngraph::Shape& weight_shape = dot->get_argument(1)->get_shape();
+    size_t channels = weight_shape[1];
+    NGRAPH_CHECK(channel_offset + channels <= scale.size(),
+                 "Dot has more channels than the batch norm");
+    for (size_t i = 0; i < weights.size(); ++i) {
+      weights[i] *= scale[channel_offset + i % channels];
+    }
+    auto new_weights = ngraph::op::Constant::create(ngraph::element::f32,
+                                                    weight_shape, weights);
+    return dot->copy_with_new_args({dot->get_argument(0), new_weights});
+  }
+  if (auto concat = std::dynamic_pointer_cast<ngraph::op::Concat>(node)) {
+    if (concat->get_concatenation_axis() != 1) {
+      return nullptr;
+    }
+    ngraph::NodeVector new_args;
+    for (const auto& arg : concat->get_arguments()) {
+      auto new_arg = scale_output_channels(arg, scale, channel_offset);
+      if (new_arg == nullptr) {
+        return nullptr;
+      }
+      new_args.emplace_back(new_arg);
+      channel_offset += arg->get_shape()[1];
+    }
+    return concat->copy_with_new_args(new_args);
+  }
+  return nullptr;
+}
+}  // namespace
+
+bool ngraph::he::pass::HEBatchNormFolding::run_on_function(
+    std::shared_ptr<ngraph::Function> function) {
+  bool modified = false;
+  for (const auto& node : function->get_ordered_ops()) {
+    auto bn = std::dynamic_pointer_cast<ngraph::op::BatchNormInference>(node);
+    if (bn == nullptr) {
+      continue;
+    }
+    // Arguments are gamma, beta, input, mean, variance
+    std::vector<float> gamma = constant_values(bn->get_argument(0));
+    std::vector<float> beta = constant_values(bn->get_argument(1));
+    std::vector<float> mean = constant_values(bn->get_argument(3));
+    std::vector<float> variance = constant_values(bn->get_argument(4));
+    auto input = bn->get_argument(2);
+    const Shape& shape = input->get_shape();
+    if (gamma.empty() || beta.empty() || mean.empty() || variance.empty() ||
+        shape.size() < 2) {
+      continue;
+    }
+
+    size_t channels = shape[1];
+    std::vector<double> scale(channels);
+    std::vector<float> bias(channels);
+    for (size_t c = 0; c < channels; ++c) {
+      scale[c] = gamma[c] / std::sqrt(variance[c] + bn->get_eps_value());
+      bias[c] = beta[c] - scale[c] * mean[c];
+    }
+
+    auto scaled = scale_output_channels(input, scale, 0);
+    if (scaled == nullptr) {
+      NGRAPH_DEBUG << "Not folding " << bn->get_name() << " into "
+                   << input->get_name();
+      continue;
+    }
+    NGRAPH_DEBUG << "Folding " << bn->get_name() << " into "
+                 << input->get_name();
+
+    AxisSet broadcast_axes;
+    for (size_t axis = 0; axis < shape.size(); ++axis) {
+      if (axis != 1) {
+        broadcast_axes.insert(axis);
+      }
+    }
+    auto bias_constant =
+        ngraph::op::Constant::create(element::f32, Shape{channels}, bias);
+    auto broadcast_bias = std::make_shared<ngraph::op::Broadcast>(
+        bias_constant, shape, broadcast_axes);
+    ngraph::replace_node(
+        bn, std::make_shared<ngraph::op::Add>(scaled, broadcast_bias));
+    modified = true;
+  }
+  return modified;
+}
@@ -0,0 +1,41 @@
+//*****************************************************************************
+// Copyright 2018-2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//*****************************************************************************
+
+#pragma once
+
+#include <memory>
+
+#include "ngraph/function.hpp"
+#include "ngraph/pass/pass.hpp"
+
+namespace ngraph {
+namespace he {
+namespace pass {
+
+// Folds each BatchNormInference whose statistics are constant into the
+// constant weights of the Convolution or Dot producing its input, so the
+// normalization becomes an addition of a constant bias. This saves the
+// multiplication, and hence a level, the BatchNormInference takes at runtime.
+// Besides the Convolutions CoreFusion folds, this covers Dots and Concats along
+// the channel axis of such ops, which is how depthwise convolutions are
+// imported.
+class HEBatchNormFolding : public ngraph::pass::FunctionPass {
+ public:
+  bool run_on_function(std::shared_ptr<ngraph::Function> function) override;
+};
+}  // namespace pass
+}  // namespace he
+}  // namespace ngraph
@@ -16,17 +16,33 @@
 
 #pragma once
 
+#include <unordered_map>
+#include <vector>
+
+#include "ngraph/descriptor/tensor.hpp"
+#include "ngraph/node.hpp"
 #include "ngraph/pass/graph_rewrite.hpp"
 
 namespace ngraph {
 namespace he {
 namespace pass {
 
-// An aggressive version of Liveness which will delete the parameter node and
-// any constant nodes
+// Assigns each tensor a dense slot index, so executors can store tensors in a
+// vector and address them by index. The executor frees a tensor once every
+// step reading its slot has run.
 class HELiveness : public ngraph::pass::FunctionPass {
  public:
   bool run_on_function(std::shared_ptr<ngraph::Function>) override;
+
+  /// @brief Returns the slot index of each tensor in the last function run.
+  /// Slots are numbered 0, 1, ... in order of the producing ops
+  const std::unordered_map<const descriptor::Tensor*, size_t>&
+  get_tensor_slots() const {
+    return m_tensor_slots;
+  }
+
+ private:
+  std::unordered_map<const descriptor::Tensor*, size_t> m_tensor_slots;
 };
 }  // namespace pass
 }  // namespace he
@@ -0,0 +1,84 @@
+//*****************************************************************************
+// Copyright 2018-2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//*****************************************************************************
+
+#include <algorithm>
+
+#include "ngraph/check.hpp"
+#include "seal/encoded_constant.hpp"
+#include "seal/he_seal_backend.hpp"
+#include "seal/seal_util.hpp"
+#include "seal/thread_pool.hpp"
+
+std::shared_ptr<const ngraph::he::EncodedScalars>
+ngraph::he::EncodedConstant::encode(const seal::parms_id_type& parms_id,
+                                    double scale,
+                                    const HESealBackend& he_seal_backend) {
+  auto key = std::make_pair(parms_id, scale);
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_encodings.find(key);
+    if (it != m_encodings.end()) {
+      return it->second;
+    }
+  }
+
+  auto context_data = he_seal_backend.get_context()->get_context_data(parms_id);
+  NGRAPH_CHECK(context_data != nullptr, "parms_id not in context");
+  size_t coeff_mod_count = context_data->parms().coeff_modulus().size();
+
+  const std::vector<HEPlaintext>& values = m_tensor->get_elements();
+  auto encoded = std::make_shared<EncodedScalars>(parms_id, scale,
+                                                  coeff_mod_count,
+                                                  values.size());
+  he_seal_backend.get_thread_pool().parallel_for(
+      0, values.size(), [&](size_t i) {
+        NGRAPH_CHECK(values[i].is_single_value(),
+                     "Encoded constants must have single values");
+        double value = static_cast<double>(values[i].values()[0]);
+        // The residues of zero are zero, and encode() does not accept it
+        if (value == 0) {
+          return;
+        }
+        std::vector<std::uint64_t> residues;
+        ngraph::he::encode(value, scale, parms_id, residues, he_seal_backend,
+                           ngraph::he::ThreadPool::memory_pool());
+        std::copy(residues.begin(), residues.end(), encoded->residues(i));
+      });
+
+  // The lock is not held while encoding, so concurrent steps using other
+  // encodings are not blocked. If another call encoded the constant meanwhile,
+  // its encoding is kept
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_encodings.emplace(key, encoded).first->second;
+}
+
+std::shared_ptr<const ngraph::he::EncodedScalars>
+ngraph::he::EncodedConstant::encode(
+    const std::vector<std::shared_ptr<SealCiphertextWrapper>>& ciphers,
+    const HESealBackend& he_seal_backend) {
+  for (const auto& cipher : ciphers) {
+    if (cipher != nullptr && !cipher->known_value()) {
+      return encode(cipher->ciphertext().parms_id(),
+                    cipher->ciphertext().scale(), he_seal_backend);
+    }
+  }
+  return nullptr;
+}
+
+size_t ngraph::he::EncodedConstant::num_encodings() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_encodings.size();
+}
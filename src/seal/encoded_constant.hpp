@@ -0,0 +1,123 @@
+//*****************************************************************************
+// Copyright 2018-2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//*****************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "he_plain_tensor.hpp"
+#include "seal/seal.h"
+#include "seal/seal_ciphertext_wrapper.hpp"
+
+namespace ngraph {
+namespace he {
+class HESealBackend;
+
+/// \brief The values of a constant encoded at one parms_id and scale, as the
+/// RNS residues which multiply_plain_inplace and add_plain_inplace take
+class EncodedScalars {
+ public:
+  EncodedScalars(const seal::parms_id_type& parms_id, double scale,
+                 size_t coeff_mod_count, size_t count)
+      : m_parms_id(parms_id),
+        m_scale(scale),
+        m_coeff_mod_count(coeff_mod_count),
+        m_residues(coeff_mod_count * count, 0) {}
+
+  const seal::parms_id_type& parms_id() const { return m_parms_id; }
+
+  double scale() const { return m_scale; }
+
+  /// @brief Returns whether the values were encoded at the parms_id and scale
+  /// of cipher
+  bool matches(const SealCiphertextWrapper& cipher) const {
+    return !cipher.known_value() &&
+           cipher.ciphertext().parms_id() == m_parms_id &&
+           cipher.ciphertext().scale() == m_scale;
+  }
+
+  /// @brief Returns the residues of the value at index
+  const std::uint64_t* residues(size_t index) const {
+    return m_residues.data() + index * m_coeff_mod_count;
+  }
+
+  std::uint64_t* residues(size_t index) {
+    return m_residues.data() + index * m_coeff_mod_count;
+  }
+
+ private:
+  seal::parms_id_type m_parms_id;
+  double m_scale;
+  size_t m_coeff_mod_count;
+  std::vector<std::uint64_t> m_residues;
+};
+
+/// @brief Returns the residues of the value at index of encoded if encoded
+/// matches cipher, else nullptr, in which case the value must be encoded
+inline const std::uint64_t* find_encoded_value(
+    const EncodedScalars* encoded, size_t index,
+    const SealCiphertextWrapper& cipher) {
+  if (encoded == nullptr || !encoded->matches(cipher)) {
+    return nullptr;
+  }
+  return encoded->residues(index);
+}
+
+/// \brief A plaintext constant of a compiled function, materialized once and
+/// kept along with its encodings at every (parms_id, scale) it is used at, so
+/// repeated calls neither rebuild nor re-encode it
+class EncodedConstant {
+ public:
+  /// @param tensor Constant values, which must all be single values
+  explicit EncodedConstant(std::shared_ptr<HEPlainTensor> tensor)
+      : m_tensor(std::move(tensor)) {}
+
+  EncodedConstant(const EncodedConstant&) = delete;
+  EncodedConstant& operator=(const EncodedConstant&) = delete;
+
+  const std::shared_ptr<HEPlainTensor>& tensor() const { return m_tensor; }
+
+  /// @brief Returns the constant encoded at parms_id and scale, encoding it
+  /// on first use. Thread-safe
+  std::shared_ptr<const EncodedScalars> encode(
+      const seal::parms_id_type& parms_id, double scale,
+      const HESealBackend& he_seal_backend);
+
+  /// @brief Returns the encoding at the parms_id and scale of the first
+  /// ciphertext of ciphers which is not a known value, or nullptr if there is
+  /// none
+  std::shared_ptr<const EncodedScalars> encode(
+      const std::vector<std::shared_ptr<SealCiphertextWrapper>>& ciphers,
+      const HESealBackend& he_seal_backend);
+
+  /// @brief Returns the number of (parms_id, scale) pairs encoded so far
+  size_t num_encodings() const;
+
+ private:
+  std::shared_ptr<HEPlainTensor> m_tensor;
+
+  std::map<std::pair<seal::parms_id_type, double>,
+           std::shared_ptr<const EncodedScalars>>
+      m_encodings;
+  mutable std::mutex m_mutex;
+};
+}  // namespace he
+}  // namespace ngraph
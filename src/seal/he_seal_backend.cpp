@@ -24,6 +24,7 @@
 #include "seal/he_seal_executable.hpp"
 #include "seal/seal.h"
 #include "seal/seal_util.hpp"
+#include "seal/util.hpp"
 
 extern "C" ngraph::runtime::BackendConstructor*
 get_backend_constructor_pointer() {
@@ -47,6 +48,16 @@ ngraph::he::HESealBackend::HESealBackend()
 ngraph::he::HESealBackend::HESealBackend(
     const ngraph::he::HESealEncryptionParameters& parms)
     : m_encryption_params(parms) {
+  // Unless set, the pool uses all hardware threads
+  size_t num_threads =
+      ngraph::he::positive_size_from_env("NGRAPH_HE_NUM_THREADS", 0);
+  m_thread_pool =
+      std::make_unique<ngraph::he::ThreadPool>(num_threads, m_pin_threads);
+
+  const char* key_cache_dir = std::getenv("NGRAPH_HE_KEY_CACHE_DIR");
+  m_key_cache = std::make_unique<ngraph::he::KeyCache>(
+      key_cache_dir == nullptr ? "" : key_cache_dir);
+
   seal::sec_level_type sec_level = seal::sec_level_type::none;
   if (parms.security_level() == 128) {
     sec_level = seal::sec_level_type::tc128;
@@ -19,6 +19,7 @@
 #include <functional>
 #include <memory>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "he_plaintext.hpp"
@@ -40,9 +41,11 @@
 #include "ngraph/util.hpp"
 #include "node_wrapper.hpp"
 #include "seal/he_seal_encryption_parameters.hpp"
+#include "seal/key_cache.hpp"
 #include "seal/seal.h"
 #include "seal/seal_ciphertext_wrapper.hpp"
 #include "seal/seal_plaintext_wrapper.hpp"
+#include "seal/thread_pool.hpp"
 #include "seal/util.hpp"
 
 namespace ngraph {
@@ -163,11 +166,19 @@ class HESealBackend : public ngraph::runtime::Backend {
   }
 
   void set_relin_keys(const seal::RelinKeys& keys) {
-    m_relin_keys = std::make_shared<seal::RelinKeys>(keys);
+    set_relin_keys(std::make_shared<seal::RelinKeys>(keys));
+  }
+
+  void set_relin_keys(std::shared_ptr<seal::RelinKeys> keys) {
+    m_relin_keys = std::move(keys);
   }
 
   void set_public_key(const seal::PublicKey& key) {
-    m_public_key = std::make_shared<seal::PublicKey>(key);
+    set_public_key(std::make_shared<seal::PublicKey>(key));
+  }
+
+  void set_public_key(std::shared_ptr<seal::PublicKey> key) {
+    m_public_key = std::move(key);
     m_encryptor = std::make_shared<seal::Encryptor>(m_context, *m_public_key);
   }
 
@@ -185,8 +196,21 @@ class HESealBackend : public ngraph::runtime::Backend {
     return m_barrett64_ratio_map;
   }
 
+  /// @brief Returns the thread pool used to parallelize kernels
+  ngraph::he::ThreadPool& get_thread_pool() const { return *m_thread_pool; }
+
+  /// @brief Returns the keys of clients which identify themselves by key id.
+  /// Kept on disk in NGRAPH_HE_KEY_CACHE_DIR if set
+  ngraph::he::KeyCache& get_key_cache() const { return *m_key_cache; }
+
   void set_pack_data(bool pack) { m_pack_data = pack; }
 
+  void set_encrypt_model(bool encrypt_model) {
+    NGRAPH_CHECK(!(encrypt_model && m_complex_packing),
+                 "Model encryption is incompatible with complex packing");
+    m_encrypt_model = encrypt_model;
+  }
+
   bool complex_packing() const { return m_complex_packing; }
   bool& complex_packing() { return m_complex_packing; }
 
@@ -211,6 +235,8 @@ class HESealBackend : public ngraph::runtime::Backend {
       ngraph::he::flag_to_bool(std::getenv("NAIVE_RESCALING"))};
   bool m_enable_client{
       ngraph::he::flag_to_bool(std::getenv("NGRAPH_ENABLE_CLIENT"))};
+  bool m_pin_threads{
+      ngraph::he::flag_to_bool(std::getenv("NGRAPH_HE_PIN_THREADS"))};
 
   std::shared_ptr<seal::SecretKey> m_secret_key;
   std::shared_ptr<seal::PublicKey> m_public_key;
@@ -227,6 +253,11 @@ class HESealBackend : public ngraph::runtime::Backend {
 
   // Stores Barrett64 ratios for moduli under 30 bits
   std::unordered_map<std::uint64_t, std::uint64_t> m_barrett64_ratio_map;
+
+  // Persistent workers shared by all executables of the backend
+  std::unique_ptr<ngraph::he::ThreadPool> m_thread_pool;
+
+  std::unique_ptr<ngraph::he::KeyCache> m_key_cache;
 };
 
 }  // namespace he
@@ -30,10 +30,11 @@ ngraph::he::HESealCipherTensor::HESealCipherTensor(
   m_num_elements = m_descriptor->get_tensor_layout()->get_size() / m_batch_size;
   m_ciphertexts.resize(m_num_elements);
 
-#pragma omp parallel for
-  for (size_t i = 0; i < m_num_elements; ++i) {
+  auto create_ciphertext = [&](size_t i) {
     m_ciphertexts[i] = he_seal_backend.create_empty_ciphertext();
-  }
+  };
+  he_seal_backend.get_thread_pool().parallel_for(0, m_num_elements,
+                                                 create_ciphertext);
 }
 
 void ngraph::he::HESealCipherTensor::write(const void* source, size_t n) {
@@ -54,8 +55,7 @@ void ngraph::he::HESealCipherTensor::write(const void* source, size_t n) {
     auto plaintext = HEPlaintext(values);
     m_he_seal_backend.encrypt(m_ciphertexts[0], plaintext, complex_packing);
   } else {
-#pragma omp parallel for
-    for (size_t i = 0; i < num_elements_to_write; ++i) {
+    auto encrypt_element = [&](size_t i) {
       const void* src_with_offset = static_cast<const void*>(
           static_cast<const char*>(source) + i * type_byte_size * m_batch_size);
 
@@ -83,7 +83,9 @@ void ngraph::he::HESealCipherTensor::write(const void* source, size_t n) {
         plaintext.values() = values;
       }
       m_he_seal_backend.encrypt(m_ciphertexts[i], plaintext, complex_packing);
-    }
+    };
+    m_he_seal_backend.get_thread_pool().parallel_for(0, num_elements_to_write,
+                                                     encrypt_element);
   }
 }
 
@@ -100,8 +102,7 @@ void ngraph::he::HESealCipherTensor::read(void* target, size_t n) const {
     m_he_seal_backend.decrypt(p, *cipher);
     m_he_seal_backend.decode(dst_with_offset, p, element_type, m_batch_size);
   } else {
-#pragma omp parallel for
-    for (size_t i = 0; i < num_elements_to_read; ++i) {
+    auto decrypt_element = [&](size_t i) {
       void* dst = ngraph::ngraph_malloc(type_byte_size * m_batch_size);
       auto cipher = m_ciphertexts[i];
       auto p = HEPlaintext();
@@ -117,7 +118,9 @@ void ngraph::he::HESealCipherTensor::read(void* target, size_t n) const {
         memcpy(dst_with_offset, src, type_byte_size);
       }
       ngraph::ngraph_free(dst);
-    }
+    };
+    m_he_seal_backend.get_thread_pool().parallel_for(0, num_elements_to_read,
+                                                     decrypt_element);
   }
 }
 
@@ -14,21 +14,28 @@
 // limitations under the License.
 //*****************************************************************************
 
+#include <sys/stat.h>
 #include <algorithm>
 #include <boost/asio.hpp>
+#include <fstream>
 #include <functional>
+#include <iomanip>
 #include <iostream>
+#include <limits>
 #include <memory>
 #include <numeric>
+#include <sstream>
 #include <string>
 #include <vector>
 
 #include "ngraph/log.hpp"
 #include "seal/he_seal_client.hpp"
+#include "seal/key_cache.hpp"
 #include "seal/seal.h"
 #include "seal/seal_util.hpp"
 #include "tcp/tcp_client.hpp"
 #include "tcp/tcp_message.hpp"
+#include "tcp/transport.hpp"
 
 ngraph::he::HESealClient::HESealClient(const std::string& hostname,
                                        const size_t port,
@@ -40,29 +47,50 @@ ngraph::he::HESealClient::HESealClient(const std::string& hostname,
       m_inputs{inputs},
       m_complex_packing(complex_packing) {
   boost::asio::io_context io_context;
-  tcp::resolver resolver(io_context);
-  auto endpoints = resolver.resolve(hostname, std::to_string(port));
+  auto endpoints =
+      client_endpoints(io_context, transport_from_env(), hostname, port);
 
-  auto client_callback = [this](const ngraph::he::TCPMessage& message) {
-    return handle_message(message);
+  auto client_callback = [this](ngraph::he::TCPMessage&& message) {
+    return handle_message(std::move(message));
   };
 
-  m_tcp_client = std::make_shared<ngraph::he::TCPClient>(io_context, endpoints,
-                                                         client_callback);
+  m_channel = std::make_shared<ngraph::he::TCPClient>(io_context, endpoints,
+                                                      client_callback);
 
   io_context.run();
 }
 
+ngraph::he::HESealClient::HESealClient(
+    const std::shared_ptr<LoopbackChannel>& channel, const size_t batch_size,
+    const std::vector<float>& inputs, bool complex_packing)
+    : m_channel{channel},
+      m_batch_size{batch_size},
+      m_is_done(false),
+      m_inputs{inputs},
+      m_complex_packing(complex_packing) {
+  channel->start([this](ngraph::he::TCPMessage&& message) {
+    return handle_message(std::move(message));
+  });
+}
+
 void ngraph::he::HESealClient::set_seal_context() {
   m_context = seal::SEALContext::Create(m_encryption_params, true,
                                         seal::sec_level_type::none);
 
   print_seal_context(*m_context);
 
-  m_keygen = std::make_shared<seal::KeyGenerator>(m_context);
-  m_relin_keys = std::make_shared<seal::RelinKeys>(m_keygen->relin_keys());
-  m_public_key = std::make_shared<seal::PublicKey>(m_keygen->public_key());
-  m_secret_key = std::make_shared<seal::SecretKey>(m_keygen->secret_key());
+  // With NGRAPH_HE_KEY_DIR set, keys are reused across connections
+  const char* key_dir = std::getenv("NGRAPH_HE_KEY_DIR");
+  if (key_dir == nullptr || !load_keys(key_dir)) {
+    m_keygen = std::make_shared<seal::KeyGenerator>(m_context);
+    m_relin_keys = std::make_shared<seal::RelinKeys>(m_keygen->relin_keys());
+    m_public_key = std::make_shared<seal::PublicKey>(m_keygen->public_key());
+    m_secret_key = std::make_shared<seal::SecretKey>(m_keygen->secret_key());
+    if (key_dir != nullptr) {
+      m_key_id = ngraph::he::key_id_from_public_key(*m_public_key);
+      save_keys(key_dir);
+    }
+  }
   m_encryptor = std::make_shared<seal::Encryptor>(m_context, *m_public_key);
   m_decryptor = std::make_shared<seal::Decryptor>(m_context, *m_secret_key);
 
@@ -75,10 +103,34 @@ void ngraph::he::HESealClient::set_seal_context() {
   // TODO: pick better scale?
   m_scale = ngraph::he::choose_scale(m_encryption_params.coeff_modulus());
   NGRAPH_INFO << "Client scale " << m_scale;
+
+  // Results of relu and max requests are encoded at the level the server
+  // requests, so pool levels are added as requests arrive
+  size_t zero_pool_size = default_zero_pool_size;
+  if (const char* pool_size_str = std::getenv("NGRAPH_HE_ZERO_POOL_SIZE")) {
+    zero_pool_size = std::stoul(pool_size_str);
+  }
+  m_zero_pool = std::make_unique<ngraph::he::ZeroCiphertextPool>(
+      m_context, m_secret_key, zero_pool_size);
+}
+
+seal::parms_id_type ngraph::he::HESealClient::result_parms_id(
+    const ngraph::he::TCPMessage& request) {
+  size_t chain_index = request.result_chain_index();
+  auto context_data = m_context->first_context_data();
+  while (context_data != nullptr && context_data->chain_index() > chain_index) {
+    context_data = context_data->next_context_data();
+  }
+  NGRAPH_CHECK(
+      context_data != nullptr && context_data->chain_index() == chain_index,
+      "Invalid result chain index ", chain_index, " in ",
+      message_type_to_string(request.message_type()));
+  m_zero_pool->add_level(context_data->parms_id());
+  return context_data->parms_id();
 }
 
 void ngraph::he::HESealClient::handle_message(
-    const ngraph::he::TCPMessage& message) {
+    ngraph::he::TCPMessage&& message) {
   ngraph::he::MessageType msg_type = message.message_type();
 
   NGRAPH_DEBUG << "Client received message type: "
@@ -88,7 +140,14 @@ void ngraph::he::HESealClient::handle_message(
     case ngraph::he::MessageType::parameter_size: {
       // Number of (packed) ciphertexts to perform inference on
       size_t parameter_size;
-      std::memcpy(&parameter_size, message.data_ptr(), message.data_size());
+      std::memcpy(&parameter_size, message.data_ptr(), sizeof(parameter_size));
+
+      // The server requests a streamed input in spatial order by appending
+      // the input shape
+      size_t stream_rank = message.data_size() / sizeof(size_t) - 1;
+      std::vector<size_t> stream_shape(stream_rank);
+      std::memcpy(stream_shape.data(), message.data_ptr() + sizeof(size_t),
+                  stream_shape.size() * sizeof(size_t));
 
       NGRAPH_INFO << "Parameter size " << parameter_size;
       NGRAPH_INFO << "Client batch size " << m_batch_size;
@@ -102,11 +161,15 @@ void ngraph::he::HESealClient::handle_message(
                     << ") * m_batch_size (" << m_batch_size << ")";
       }
 
-      std::vector<seal::Ciphertext> ciphers(parameter_size);
-#pragma omp parallel for
-      for (size_t data_idx = 0; data_idx < parameter_size; ++data_idx) {
+      std::vector<ngraph::he::SeededCiphertext> ciphers(parameter_size);
+      auto encrypt_input = [&](size_t cipher_idx) {
         seal::Plaintext plain;
 
+        size_t data_idx = cipher_idx;
+        if (!stream_shape.empty()) {
+          data_idx = ngraph::he::spatial_stream_index(cipher_idx, stream_shape);
+        }
+
         size_t batch_start_idx = data_idx * m_batch_size;
         size_t batch_end_idx = batch_start_idx + m_batch_size;
 
@@ -119,41 +182,52 @@ void ngraph::he::HESealClient::handle_message(
         } else {
           m_ckks_encoder->encode(real_vals, m_scale, plain);
         }
-        m_encryptor->encrypt(plain, ciphers[data_idx]);
-      }
-      NGRAPH_INFO << "Creating execute message";
-      auto execute_message =
-          TCPMessage(ngraph::he::MessageType::execute, ciphers);
+        ngraph::he::encrypt_symmetric_seeded(
+            plain, *m_secret_key, m_context, ciphers[cipher_idx],
+            ngraph::he::ThreadPool::memory_pool());
+      };
+      m_thread_pool.parallel_for(0, parameter_size, encrypt_input);
       NGRAPH_INFO << "Sending execute message with " << parameter_size
                   << " ciphertexts";
-      write_message(std::move(execute_message));
+      TCPMessage::encode_frames(
+          ngraph::he::MessageType::execute, ciphers, 1, m_thread_pool,
+          [this](TCPMessage&& frame) { write_message(std::move(frame)); });
       break;
     }
     case ngraph::he::MessageType::result: {
-      size_t result_count = message.count();
-      size_t element_size = message.element_size();
+      // Results arrive as a sequence of frames, decrypted as they arrive
+      size_t element_offset = message.element_offset();
+      size_t total_count = message.total_count();
+      if (element_offset == 0) {
+        m_results.assign(total_count * m_batch_size, 0);
+        m_result_count = 0;
+      }
+      NGRAPH_CHECK(total_count * m_batch_size == m_results.size() &&
+                       element_offset + message.count() <= total_count,
+                   "Result frame of ", message.count(), " elements at offset ",
+                   element_offset, " does not fit ", total_count, " results");
 
       std::vector<seal::Ciphertext> result;
-      m_results.reserve(result_count * m_batch_size);
-      for (size_t result_idx = 0; result_idx < result_count; ++result_idx) {
-        seal::Ciphertext cipher;
-        std::stringstream cipher_stream;
-        cipher_stream.write(message.data_ptr() + result_idx * element_size,
-                            element_size);
-        cipher.load(m_context, cipher_stream);
-
-        result.push_back(cipher);
+      message.load_ciphertexts(result, m_context, m_thread_pool);
+      NGRAPH_CHECK(result.size() == message.count(), "Expected ",
+                   message.count(), " result ciphertexts, got ",
+                   result.size());
+      for (size_t result_idx = 0; result_idx < result.size(); ++result_idx) {
         seal::Plaintext plain;
-        m_decryptor->decrypt(cipher, plain);
+        m_decryptor->decrypt(result[result_idx], plain);
 
         std::vector<double> outputs;
         decode_to_real_vec(plain, outputs, complex_packing());
         NGRAPH_CHECK(outputs.size() >= m_batch_size, "outputs.size() ",
                      outputs.size(), " < m_batch_size ", m_batch_size);
-        m_results.insert(m_results.end(), outputs.begin(),
-                         outputs.begin() + m_batch_size);
+        size_t result_start = (element_offset + result_idx) * m_batch_size;
+        std::copy(outputs.begin(), outputs.begin() + m_batch_size,
+                  m_results.begin() + result_start);
+      }
+      m_result_count += result.size();
+      if (m_result_count == total_count) {
+        close_connection();
       }
-      close_connection();
       break;
     }
 
@@ -170,99 +244,90 @@ void ngraph::he::HESealClient::handle_message(
 
       set_seal_context();
 
-      // Send public key
-      std::stringstream pk_stream;
-      m_public_key->save(pk_stream);
-      auto pk_message = TCPMessage(ngraph::he::MessageType::public_key, 1,
-                                   std::move(pk_stream));
-      NGRAPH_INFO << "Sending public key";
-      write_message(std::move(pk_message));
-
-      // Send evaluation key
-      std::stringstream evk_stream;
-      m_relin_keys->save(evk_stream);
-      auto evk_message = TCPMessage(ngraph::he::MessageType::eval_key, 1,
-                                    std::move(evk_stream));
-      NGRAPH_INFO << "Sending evaluation key";
-      write_message(std::move(evk_message));
+      if (m_key_id.empty()) {
+        send_keys();
+      } else {
+        // The server requests the keys if it has not cached them
+        NGRAPH_INFO << "Sending key id " << m_key_id;
+        write_message(TCPMessage(ngraph::he::MessageType::key_id, 1,
+                                 m_key_id.size(), m_key_id.data()));
+      }
 
       break;
     }
-    case ngraph::he::MessageType::relu6_request: {
-      handle_relu_request(message);
+    case ngraph::he::MessageType::key_request: {
+      send_keys();
       break;
     }
+
+    case ngraph::he::MessageType::relu6_request:
     case ngraph::he::MessageType::relu_request: {
-      handle_relu_request(message);
+      // Handle the request off the I/O thread, so further requests are read
+      // and earlier results written meanwhile. The server matches results to
+      // requests by id, so they may be sent in any order
+      auto request = std::make_shared<TCPMessage>(std::move(message));
+      m_thread_pool.submit(
+          [this, request]() { handle_relu_request(*request); });
       break;
     }
 
     case ngraph::he::MessageType::max_request: {
+      // Each element of the message is a window of equally many ciphertexts
       size_t complex_pack_factor = complex_packing() ? 2 : 1;
-      size_t cipher_count = message.count();
-      size_t element_size = message.element_size();
-
-      std::vector<std::vector<double>> input_cipher_values(
-          m_batch_size * complex_pack_factor,
-          std::vector<double>(cipher_count, 0));
-
-      std::vector<double> max_values(m_batch_size * complex_pack_factor,
-                                     std::numeric_limits<double>::lowest());
-
-#pragma omp parallel for
-      for (size_t cipher_idx = 0; cipher_idx < cipher_count; ++cipher_idx) {
-        seal::Ciphertext pre_sort_cipher;
-        seal::Plaintext pre_sort_plain;
-
-        // Load cipher from stream
-        std::stringstream pre_sort_cipher_stream;
-        pre_sort_cipher_stream.write(
-            message.data_ptr() + cipher_idx * element_size, element_size);
-        pre_sort_cipher.load(m_context, pre_sort_cipher_stream);
-
-        // Decrypt cipher
-        m_decryptor->decrypt(pre_sort_cipher, pre_sort_plain);
-        std::vector<double> pre_max_value;
-        decode_to_real_vec(pre_sort_plain, pre_max_value, complex_packing());
-
-        for (size_t batch_idx = 0;
-             batch_idx < m_batch_size * complex_pack_factor; ++batch_idx) {
-          input_cipher_values[batch_idx][cipher_idx] = pre_max_value[batch_idx];
+      size_t slot_count = m_batch_size * complex_pack_factor;
+      size_t window_count = message.count();
+      std::vector<seal::Ciphertext> pre_max_ciphers;
+      message.load_ciphertexts(pre_max_ciphers, m_context, m_thread_pool);
+      size_t window_size = pre_max_ciphers.size() / window_count;
+      seal::parms_id_type parms_id = result_parms_id(message);
+
+      std::vector<ngraph::he::SeededCiphertext> max_ciphers(window_count);
+      auto compute_max = [&](size_t window_idx) {
+        std::vector<double> max_values(slot_count,
+                                       std::numeric_limits<double>::lowest());
+
+        for (size_t cipher_idx = 0; cipher_idx < window_size; ++cipher_idx) {
+          seal::Plaintext pre_sort_plain;
+
+          // Decrypt cipher
+          m_decryptor->decrypt(
+              pre_max_ciphers[window_idx * window_size + cipher_idx],
+              pre_sort_plain);
+          std::vector<double> pre_max_value;
+          decode_to_real_vec(pre_sort_plain, pre_max_value, complex_packing());
+
+          for (size_t batch_idx = 0; batch_idx < slot_count; ++batch_idx) {
+            max_values[batch_idx] =
+                std::max(max_values[batch_idx], pre_max_value[batch_idx]);
+          }
         }
-      }
-
-      // Get max of each vector of values
-      for (size_t batch_idx = 0; batch_idx < m_batch_size * complex_pack_factor;
-           ++batch_idx) {
-        max_values[batch_idx] =
-            *std::max_element(input_cipher_values[batch_idx].begin(),
-                              input_cipher_values[batch_idx].end());
-      }
-
-      // Encrypt maximum values
-      seal::Ciphertext cipher_max;
-      seal::Plaintext plain_max;
-      std::stringstream max_stream;
 
-      if (complex_packing()) {
-        assert(max_values.size() % 2 == 0);
-        std::vector<std::complex<double>> max_complex_vals;
-        real_vec_to_complex_vec(max_complex_vals, max_values);
-        m_ckks_encoder->encode(max_complex_vals, m_scale, plain_max);
-      } else {
-        m_ckks_encoder->encode(max_values, m_scale, plain_max);
-      }
-      m_encryptor->encrypt(plain_max, cipher_max);
-      cipher_max.save(max_stream);
-
-      auto max_result_msg = TCPMessage(ngraph::he::MessageType::max_result, 1,
-                                       std::move(max_stream));
+        // Encrypt maximum values
+        seal::Plaintext plain_max;
+        if (complex_packing()) {
+          assert(max_values.size() % 2 == 0);
+          std::vector<std::complex<double>> max_complex_vals;
+          real_vec_to_complex_vec(max_complex_vals, max_values);
+          m_ckks_encoder->encode(max_complex_vals, parms_id, m_scale,
+                                 plain_max);
+        } else {
+          m_ckks_encoder->encode(max_values, parms_id, m_scale, plain_max);
+        }
+        m_zero_pool->encrypt(plain_max, max_ciphers[window_idx],
+                             ngraph::he::ThreadPool::memory_pool());
+      };
+      m_thread_pool.parallel_for(0, window_count, compute_max);
+
+      auto max_result_msg = TCPMessage(ngraph::he::MessageType::max_result,
+                                       max_ciphers, m_thread_pool);
+      max_result_msg.set_request_id(message.request_id());
       write_message(std::move(max_result_msg));
 
       break;
     }
     case ngraph::he::MessageType::execute:
     case ngraph::he::MessageType::eval_key:
+    case ngraph::he::MessageType::key_id:
     case ngraph::he::MessageType::max_result:
     case ngraph::he::MessageType::minimum_request:
     case ngraph::he::MessageType::minimum_result:
@@ -276,9 +341,81 @@ void ngraph::he::HESealClient::handle_message(
   }
 }
 
+void ngraph::he::HESealClient::send_keys() {
+  // Keys are sent as frames of bytes, since relinearization keys of large
+  // parameters exceed a frame
+  auto write_frame = [this](TCPMessage&& frame) {
+    write_message(std::move(frame));
+  };
+
+  // Send public key
+  std::stringstream pk_stream;
+  m_public_key->save(pk_stream);
+  NGRAPH_INFO << "Sending public key";
+  TCPMessage::encode_frames(ngraph::he::MessageType::public_key,
+                            pk_stream.str(), write_frame);
+
+  // Send evaluation key
+  std::stringstream evk_stream;
+  m_relin_keys->save(evk_stream);
+  NGRAPH_INFO << "Sending evaluation key";
+  TCPMessage::encode_frames(ngraph::he::MessageType::eval_key,
+                            evk_stream.str(), write_frame);
+}
+
+std::string ngraph::he::HESealClient::key_path(
+    const std::string& key_dir) const {
+  // Keys are only valid for the encryption parameters they were created with
+  std::stringstream ss;
+  ss << key_dir << "/client_" << std::hex << std::setfill('0');
+  for (uint64_t parms_id_word : m_context->key_parms_id()) {
+    ss << std::setw(16) << parms_id_word;
+  }
+  ss << ".keys";
+  return ss.str();
+}
+
+bool ngraph::he::HESealClient::load_keys(const std::string& key_dir) {
+  std::ifstream key_file(key_path(key_dir), std::ios::binary);
+  if (!key_file) {
+    return false;
+  }
+  auto secret_key = std::make_shared<seal::SecretKey>();
+  auto public_key = std::make_shared<seal::PublicKey>();
+  auto relin_keys = std::make_shared<seal::RelinKeys>();
+  try {
+    secret_key->load(m_context, key_file);
+    public_key->load(m_context, key_file);
+    relin_keys->load(m_context, key_file);
+  } catch (const std::exception& e) {
+    NGRAPH_INFO << "Cannot load keys from " << key_path(key_dir) << ": "
+                << e.what();
+    return false;
+  }
+  m_key_id = ngraph::he::key_id_from_public_key(*public_key);
+  NGRAPH_INFO << "Loaded keys " << m_key_id;
+  m_secret_key = secret_key;
+  m_public_key = public_key;
+  m_relin_keys = relin_keys;
+  return true;
+}
+
+void ngraph::he::HESealClient::save_keys(const std::string& key_dir) const {
+  std::stringstream key_stream;
+  m_secret_key->save(key_stream);
+  m_public_key->save(key_stream);
+  m_relin_keys->save(key_stream);
+  // The file holds the secret key, so it is only ever readable by the user
+  if (!ngraph::he::write_file_atomically(key_path(key_dir), key_stream.str(),
+                                         S_IRUSR | S_IWUSR)) {
+    NGRAPH_INFO << "Cannot save keys to " << key_path(key_dir);
+  }
+}
+
 void ngraph::he::HESealClient::close_connection() {
   NGRAPH_INFO << "Closing connection";
-  m_tcp_client->close();
+  m_channel->close();
+  MessageBufferPool::global()->trim();
   m_is_done = true;
 }
 
@@ -298,24 +435,21 @@ void ngraph::he::HESealClient::handle_relu_request(
   }
 
   size_t result_count = message.count();
-  size_t element_size = message.element_size();
-  NGRAPH_INFO << "Received Relu request with " << result_count << " elements"
-              << " of size " << element_size;
-
-  std::vector<seal::Ciphertext> post_relu_ciphers(result_count);
-#pragma omp parallel for
-  for (size_t result_idx = 0; result_idx < result_count; ++result_idx) {
-    seal::Ciphertext pre_relu_cipher;
-    seal::Plaintext relu_plain;
+  NGRAPH_INFO << "Received Relu request with " << result_count << " elements";
+
+  std::vector<seal::Ciphertext> pre_relu_ciphers;
+  message.load_ciphertexts(pre_relu_ciphers, m_context, m_thread_pool);
+  NGRAPH_CHECK(pre_relu_ciphers.size() == result_count, "Relu request with ",
+               result_count, " elements has ", pre_relu_ciphers.size(),
+               " ciphertexts");
+  seal::parms_id_type parms_id = result_parms_id(message);
 
-    // Load cipher from stream
-    std::stringstream pre_relu_cipher_stream;
-    pre_relu_cipher_stream.write(message.data_ptr() + result_idx * element_size,
-                                 element_size);
-    pre_relu_cipher.load(m_context, pre_relu_cipher_stream);
+  std::vector<ngraph::he::SeededCiphertext> post_relu_ciphers(result_count);
+  auto compute_relu = [&](size_t result_idx) {
+    seal::Plaintext relu_plain;
 
     // Decrypt cipher
-    m_decryptor->decrypt(pre_relu_cipher, relu_plain);
+    m_decryptor->decrypt(pre_relu_ciphers[result_idx], relu_plain);
 
     std::vector<double> relu_vals;
     decode_to_real_vec(relu_plain, relu_vals, complex_packing());
@@ -326,14 +460,18 @@ void ngraph::he::HESealClient::handle_relu_request(
     if (complex_packing()) {
       std::vector<std::complex<double>> complex_relu_vals;
       real_vec_to_complex_vec(complex_relu_vals, post_relu_vals);
-      m_ckks_encoder->encode(complex_relu_vals, m_scale, relu_plain);
+      m_ckks_encoder->encode(complex_relu_vals, parms_id, m_scale,
+                             relu_plain);
     } else {
-      m_ckks_encoder->encode(post_relu_vals, m_scale, relu_plain);
+      m_ckks_encoder->encode(post_relu_vals, parms_id, m_scale, relu_plain);
     }
-    m_encryptor->encrypt(relu_plain, post_relu_ciphers[result_idx]);
-  }
-  auto relu_result_msg =
-      TCPMessage(ngraph::he::MessageType::relu_result, post_relu_ciphers);
+    m_zero_pool->encrypt(relu_plain, post_relu_ciphers[result_idx],
+                         ngraph::he::ThreadPool::memory_pool());
+  };
+  m_thread_pool.parallel_for(0, result_count, compute_relu);
+  auto relu_result_msg = TCPMessage(ngraph::he::MessageType::relu_result,
+                                    post_relu_ciphers, m_thread_pool);
+  relu_result_msg.set_request_id(message.request_id());
 
   write_message(std::move(relu_result_msg));
   return;
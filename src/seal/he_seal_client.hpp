@@ -23,7 +23,11 @@
 #include <vector>
 
 #include "seal/seal.h"
+#include "seal/thread_pool.hpp"
 #include "seal/util.hpp"
+#include "seal/zero_ciphertext_pool.hpp"
+#include "tcp/loopback_channel.hpp"
+#include "tcp/message_channel.hpp"
 #include "tcp/tcp_client.hpp"
 #include "tcp/tcp_message.hpp"
 
@@ -31,19 +35,32 @@ namespace ngraph {
 namespace he {
 class HESealClient {
  public:
+  /// @brief Number of encryptions of zero kept ready for relu and max results,
+  /// unless set by NGRAPH_HE_ZERO_POOL_SIZE
+  enum { default_zero_pool_size = 128 };
+
   HESealClient(
       const std::string& hostname, const size_t port, const size_t batch_size,
       const std::vector<float>& inputs,
       bool complex_packing = flag_to_bool(std::getenv("NGRAPH_ENCRYPT_DATA")));
 
+  /// @brief Creates a client embedded in the server process. Does not block;
+  /// use is_done() to wait for the results
+  /// @param channel Client end of the channel returned by
+  /// HESealExecutable::enable_loopback_client()
+  HESealClient(
+      const std::shared_ptr<LoopbackChannel>& channel, const size_t batch_size,
+      const std::vector<float>& inputs,
+      bool complex_packing = flag_to_bool(std::getenv("NGRAPH_ENCRYPT_DATA")));
+
   void set_seal_context();
 
-  void handle_message(const ngraph::he::TCPMessage& message);
+  void handle_message(ngraph::he::TCPMessage&& message);
 
   void handle_relu_request(const ngraph::he::TCPMessage& message);
 
   inline void write_message(ngraph::he::TCPMessage&& message) {
-    m_tcp_client->write_message(std::move(message));
+    m_channel->write_message(std::move(message));
   }
 
   inline bool is_done() { return m_is_done; }
@@ -52,6 +69,9 @@ class HESealClient {
 
   void close_connection();
 
+  /// @brief Sends the public key and relinearization keys to the server
+  void send_keys();
+
   bool complex_packing() const { return m_complex_packing; }
   bool& complex_packing() { return m_complex_packing; }
 
@@ -59,7 +79,23 @@ class HESealClient {
                           std::vector<double>& output, bool complex);
 
  private:
-  std::shared_ptr<TCPClient> m_tcp_client;
+  /// @brief Returns the path of the key file for the current encryption
+  /// parameters in key_dir
+  std::string key_path(const std::string& key_dir) const;
+
+  /// @brief Loads the keys saved by save_keys(), and derives the key id from
+  /// the public key
+  /// @return false if key_dir holds no valid keys for the current encryption
+  /// parameters
+  bool load_keys(const std::string& key_dir);
+
+  void save_keys(const std::string& key_dir) const;
+
+  /// @brief Returns the parms_id at which the result of request is encrypted,
+  /// and starts keeping encryptions of zero at its level
+  seal::parms_id_type result_parms_id(const ngraph::he::TCPMessage& request);
+
+  std::shared_ptr<MessageChannel> m_channel;
   seal::EncryptionParameters m_encryption_params{seal::scheme_type::CKKS};
   std::shared_ptr<seal::PublicKey> m_public_key;
   std::shared_ptr<seal::SecretKey> m_secret_key;
@@ -70,13 +106,20 @@ class HESealClient {
   std::shared_ptr<seal::Evaluator> m_evaluator;
   std::shared_ptr<seal::KeyGenerator> m_keygen;
   std::shared_ptr<seal::RelinKeys> m_relin_keys;
+  std::unique_ptr<ngraph::he::ZeroCiphertextPool> m_zero_pool;
+  // Identifies keys reused across connections, which the server may cache.
+  // Empty if keys are generated for each connection
+  std::string m_key_id;
   double m_scale;
   size_t m_batch_size;
   bool m_is_done;
   std::vector<float> m_inputs;   // Function inputs
   std::vector<float> m_results;  // Function outputs
+  size_t m_result_count{0};      // Result elements received so far
 
   bool m_complex_packing;
+
+  ngraph::he::ThreadPool m_thread_pool;
 };  // namespace he
 }  // namespace he
 }  // namespace ngraph
@@ -98,6 +98,18 @@ inline ngraph::he::HESealEncryptionParameters default_ckks_parameters() {
   return params;
 }
 
+/// @brief Returns the JSON configuration of parms, of the form read from
+/// NGRAPH_HE_SEAL_CONFIG
+inline std::string config_json(
+    const ngraph::he::HESealEncryptionParameters& parms) {
+  nlohmann::json js;
+  js["scheme_name"] = parms.scheme_name();
+  js["poly_modulus_degree"] = parms.poly_modulus_degree();
+  js["security_level"] = parms.security_level();
+  js["coeff_modulus"] = parms.coeff_modulus_bits();
+  return js.dump(4);
+}
+
 inline ngraph::he::HESealEncryptionParameters parse_config_or_use_default(
     const std::string& scheme_name) {
   std::unordered_set<std::string> valid_scheme_names{"HE_SEAL"};
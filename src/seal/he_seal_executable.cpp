@@ -14,8 +14,16 @@
 // limitations under the License.
 //*****************************************************************************
 
+#include <algorithm>
+#include <cstdio>
+#include <exception>
+#include <fstream>
 #include <functional>
 #include <limits>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
 #include <unordered_set>
 
 #include "he_plain_tensor.hpp"
@@ -70,15 +78,42 @@
 #include "ngraph/runtime/backend.hpp"
 #include "ngraph/util.hpp"
 #include "op/bounded_relu.hpp"
+#include "pass/he_batch_norm_folding.hpp"
 #include "pass/he_fusion.hpp"
 #include "pass/he_liveness.hpp"
 #include "seal/he_seal_backend.hpp"
 #include "seal/he_seal_executable.hpp"
+#include "seal/parameter_selection.hpp"
 #include "seal/seal_ciphertext_wrapper.hpp"
 #include "seal/seal_util.hpp"
+#include "seal/util.hpp"
 
 using ngraph::descriptor::layout::DenseTensorLayout;
 
+namespace {
+// Encrypted model files store the public key their constants are encrypted
+// under, which is compared byte for byte on load
+std::string serialize_public_key(const seal::PublicKey& public_key) {
+  std::stringstream ss;
+  public_key.save(ss);
+  return ss.str();
+}
+
+template <typename T>
+std::vector<size_t> sorted_keys(const std::unordered_map<size_t, T>& map) {
+  std::vector<size_t> keys;
+  for (const auto& entry : map) {
+    keys.emplace_back(entry.first);
+  }
+  std::sort(keys.begin(), keys.end());
+  return keys;
+}
+}  // namespace
+
+constexpr size_t ngraph::he::HESealExecutable::max_client_requests_in_flight;
+constexpr size_t ngraph::he::HESealExecutable::default_client_message_size;
+constexpr size_t ngraph::he::HESealExecutable::unplanned_level;
+
 ngraph::he::HESealExecutable::HESealExecutable(
     const std::shared_ptr<Function>& function,
     bool enable_performance_collection, HESealBackend& he_seal_backend,
@@ -94,12 +129,13 @@ ngraph::he::HESealExecutable::HESealExecutable(
       m_client_setup(false),
       m_batch_size(1),
       m_port(34000),
-      m_relu_done(false),
-      m_max_done(false),
       m_session_started(false),
       m_client_inputs_received(false) {
   m_context = he_seal_backend.get_context();
 
+  m_client_message_size = ngraph::he::positive_size_from_env(
+      "NGRAPH_HE_CLIENT_MESSAGE_SIZE", default_client_message_size);
+
   if (std::getenv("NGRAPH_VOPS") != nullptr) {
     std::string verbose_ops_str(std::getenv("NGRAPH_VOPS"));
     verbose_ops_str = ngraph::to_lower(verbose_ops_str);
@@ -127,18 +163,23 @@ ngraph::he::HESealExecutable::HESealExecutable(
   pass_manager.run_passes(function);
 
   ngraph::pass::Manager pass_manager_he;
+  pass_manager_he.register_pass<ngraph::he::pass::HEBatchNormFolding>();
   pass_manager_he.register_pass<ngraph::he::pass::HEFusion>();
-  // Run liveness pass after all other passes (otherwise BoundedRelu nodes won't
-  // have liveness_free_list set)
-  pass_manager_he.register_pass<ngraph::he::pass::HELiveness>();
-  // pass_manager_he.register_pass<ngraph::pass::Liveness>();
+  // Run after all other passes, so tensors of nodes they create get slots
+  auto liveness = pass_manager_he.register_pass<ngraph::he::pass::HELiveness>();
   pass_manager_he.run_passes(function);
 
-  for (const std::shared_ptr<Node>& node : function->get_ordered_ops()) {
-    m_wrapped_nodes.emplace_back(node);
-  }
   set_parameters_and_results(*function);
 
+  // Otherwise the depth limit is only reached while running
+  size_t depth = ngraph::he::multiplicative_depth(*function, m_encrypt_model);
+  size_t levels = m_context->first_context_data()->chain_index();
+  if (depth > levels) {
+    NGRAPH_WARN << "Multiplicative depth " << depth << " exceeds the "
+                << levels << " levels of the encryption parameters. Use "
+                << "select_parameters to choose larger parameters";
+  }
+
   // Constant, for example, cannot be packed
   if (get_parameters().size() > 0) {
     const Shape& shape = (get_parameters()[0])->get_shape();
@@ -147,12 +188,570 @@ ngraph::he::HESealExecutable::HESealExecutable(
     }
   }
 
+  build_execution_plan(function, *liveness);
+  materialize_constants();
+
   if (m_enable_client) {
     NGRAPH_INFO << "Setting up client in constructor";
     client_setup();
   }
 }
 
+void ngraph::he::HESealExecutable::build_execution_plan(
+    const std::shared_ptr<Function>& function,
+    const ngraph::he::pass::HELiveness& liveness) {
+  const std::unordered_map<const descriptor::Tensor*, size_t>& slot_map =
+      liveness.get_tensor_slots();
+  m_execution_plan.clear();
+  m_tensor_slots.clear();
+  m_tensor_slots.resize(slot_map.size());
+  m_parameter_slots.clear();
+  m_result_slots.clear();
+
+  for (const std::shared_ptr<Node>& node : function->get_ordered_ops()) {
+    ExecutionStep step{NodeWrapper(node)};
+
+    for (size_t arg_idx = 0; arg_idx < node->get_input_size(); ++arg_idx) {
+      const descriptor::Tensor* tensor = &node->input(arg_idx).get_tensor();
+      auto it = slot_map.find(tensor);
+      NGRAPH_CHECK(it != slot_map.end(), "Input tensor ", tensor->get_name(),
+                   " of ", node->get_name(),
+                   " is not produced by a previous op");
+      step.input_slots.emplace_back(it->second);
+
+      Shape arg_shape = node->get_input_shape(arg_idx);
+      step.unpacked_arg_shapes.emplace_back(arg_shape);
+      if (m_batch_data) {
+        arg_shape = ngraph::he::HETensor::pack_shape(arg_shape);
+      }
+      step.packed_arg_shapes.emplace_back(arg_shape);
+    }
+
+    if (node->get_output_size() > 0) {
+      NGRAPH_CHECK(node->get_output_size() == 1,
+                   "Only support single-output functions");
+      step.out_shape = node->get_output_shape(0);
+      step.packed_out_shape = step.out_shape;
+      if (m_batch_data) {
+        step.packed_out_shape =
+            ngraph::he::HETensor::pack_shape(step.packed_out_shape);
+      }
+    }
+
+    for (size_t i = 0; i < node->get_output_size(); ++i) {
+      const descriptor::Tensor* tensor = &node->output(i).get_tensor();
+      size_t slot_idx = slot_map.at(tensor);
+      TensorSlot& slot = m_tensor_slots[slot_idx];
+      slot.name = tensor->get_name();
+      slot.shape = node->get_output_shape(i);
+      slot.element_type = node->get_output_element_type(i);
+      step.output_slots.emplace_back(slot_idx);
+    }
+
+    if (node->get_inputs().empty()) {
+      step.base_type = node->get_element_type();
+    } else {
+      step.base_type = node->get_inputs().at(0).get_tensor().get_element_type();
+    }
+    step.verbose = verbose_op(*node);
+    switch (step.node_wrapper.get_typeid()) {
+      case OP_TYPEID::BoundedRelu:
+      case OP_TYPEID::MaxPool:
+      case OP_TYPEID::Relu:
+        step.client_op = true;
+        break;
+      default:
+        break;
+    }
+    m_execution_plan.emplace_back(std::move(step));
+  }
+
+  for (const auto& param : function->get_parameters()) {
+    m_parameter_slots.emplace_back(
+        slot_map.at(param->get_output_tensor_ptr(0).get()));
+  }
+  for (const auto& result : function->get_results()) {
+    size_t slot_idx = slot_map.at(result->get_output_tensor_ptr(0).get());
+    m_result_slots.emplace_back(slot_idx);
+    m_tensor_slots[slot_idx].persistent = true;
+  }
+  m_step_timers.assign(m_execution_plan.size(), stopwatch());
+
+  // Dependencies between steps, and number of uses of each slot
+  std::vector<size_t> slot_producers(m_tensor_slots.size());
+  for (size_t step_idx = 0; step_idx < m_execution_plan.size(); ++step_idx) {
+    ExecutionStep& step = m_execution_plan[step_idx];
+    for (size_t slot_idx : step.output_slots) {
+      slot_producers[slot_idx] = step_idx;
+    }
+    std::set<size_t> producers;
+    for (size_t slot_idx : step.input_slots) {
+      m_tensor_slots[slot_idx].use_count++;
+      producers.insert(slot_producers[slot_idx]);
+    }
+    step.dependency_count = producers.size();
+    for (size_t producer_idx : producers) {
+      m_execution_plan[producer_idx].dependents.emplace_back(step_idx);
+    }
+    step.estimated_cost = estimate_cost(step);
+  }
+
+  // Resolve kinds for the inputs we expect, so the common case need not
+  // re-resolve at call time
+  bool cipher_params = m_enable_client || m_encrypt_data;
+  std::vector<std::pair<TensorKind, bool>> signature;
+  for (size_t i = 0; i < m_parameter_slots.size(); ++i) {
+    signature.emplace_back(
+        cipher_params ? TensorKind::cipher : TensorKind::plain, m_batch_data);
+  }
+  for (size_t i = 0; i < m_result_slots.size(); ++i) {
+    signature.emplace_back(TensorKind::plain, m_batch_data);
+  }
+  resolve_tensor_kinds(signature);
+  plan_levels({});
+}
+
+void ngraph::he::HESealExecutable::materialize_constants() {
+  m_constants.clear();
+  m_encrypted_constants.clear();
+  for (const ExecutionStep& step : m_execution_plan) {
+    if (step.node_wrapper.get_typeid() != OP_TYPEID::Constant) {
+      continue;
+    }
+    size_t slot_idx = step.output_slots[0];
+    const TensorSlot& slot = m_tensor_slots[slot_idx];
+    if (slot.kind != TensorKind::plain) {
+      // Encrypted by the first call, once the keys are known
+      m_encrypted_constants[slot_idx] = nullptr;
+      continue;
+    }
+    const auto& constant =
+        static_cast<const op::Constant&>(*step.node_wrapper.get_node());
+    auto tensor = std::make_shared<HEPlainTensor>(
+        slot.element_type, slot.shape, m_he_seal_backend, slot.packed,
+        slot.name);
+    ngraph::he::constant_seal(tensor->get_elements(), step.base_type,
+                              constant.get_data_ptr(), m_he_seal_backend,
+                              tensor->get_batched_element_count());
+    m_constants[slot_idx] = std::make_shared<EncodedConstant>(tensor);
+  }
+}
+
+bool ngraph::he::HESealExecutable::prepare_encrypted_constants() {
+  if (m_encrypted_constants_key != m_he_seal_backend.get_public_key()) {
+    for (auto& entry : m_encrypted_constants) {
+      entry.second = nullptr;
+    }
+    m_encrypted_constants_key = m_he_seal_backend.get_public_key();
+  }
+  auto encrypted = [this]() {
+    return std::all_of(
+        m_encrypted_constants.begin(), m_encrypted_constants.end(),
+        [](const auto& entry) { return entry.second != nullptr; });
+  };
+  if (encrypted()) {
+    return true;
+  }
+  if (const char* path = std::getenv("NGRAPH_HE_ENCRYPTED_MODEL")) {
+    if (load_encrypted_constants(path)) {
+      NGRAPH_INFO << "Loaded encrypted model from " << path;
+    }
+  }
+  return encrypted();
+}
+
+void ngraph::he::HESealExecutable::save_encrypted_constants(
+    const std::string& path) const {
+  NGRAPH_CHECK(m_encrypted_constants_key != nullptr,
+               "Model constants have not been encrypted");
+  // Written to a temporary file first, so readers never see a partial file
+  std::string tmp_path = path + ".tmp";
+  std::ofstream file(tmp_path, std::ios::binary);
+  NGRAPH_CHECK(file, "Cannot open ", tmp_path);
+
+  auto write_uint64 = [&file](uint64_t value) {
+    file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+  };
+  std::string public_key = serialize_public_key(*m_encrypted_constants_key);
+  write_uint64(public_key.size());
+  file.write(public_key.data(), public_key.size());
+  std::vector<size_t> slots = sorted_keys(m_encrypted_constants);
+  write_uint64(slots.size());
+  for (size_t slot_idx : slots) {
+    const auto& tensor = m_encrypted_constants.at(slot_idx);
+    NGRAPH_CHECK(tensor != nullptr, "Model constant ",
+                 m_tensor_slots[slot_idx].name, " has not been encrypted");
+    const std::string& name = m_tensor_slots[slot_idx].name;
+    write_uint64(name.size());
+    file.write(name.data(), name.size());
+    write_uint64(tensor->num_ciphertexts());
+    for (const auto& cipher : tensor->get_elements()) {
+      char known_value = cipher->known_value() ? 1 : 0;
+      float value = cipher->value();
+      file.write(&known_value, sizeof(known_value));
+      file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+      if (!cipher->known_value()) {
+        cipher->save(file);
+      }
+    }
+  }
+  file.close();
+  if (!file) {
+    std::remove(tmp_path.c_str());
+    throw ngraph_error("Cannot write encrypted model to " + tmp_path);
+  }
+  if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+    std::remove(tmp_path.c_str());
+    throw ngraph_error("Cannot rename encrypted model to " + path);
+  }
+}
+
+bool ngraph::he::HESealExecutable::load_encrypted_constants(
+    const std::string& path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file || m_he_seal_backend.get_public_key() == nullptr) {
+    return false;
+  }
+  auto read_uint64 = [&file]() {
+    uint64_t value = 0;
+    file.read(reinterpret_cast<char*>(&value), sizeof(value));
+    return value;
+  };
+  // Lengths read from the file are checked before anything is allocated
+  std::string public_key =
+      serialize_public_key(*m_he_seal_backend.get_public_key());
+  std::string saved_public_key;
+  if (read_uint64() == public_key.size()) {
+    saved_public_key.resize(public_key.size());
+    file.read(&saved_public_key[0], saved_public_key.size());
+  }
+  if (!file || saved_public_key != public_key) {
+    NGRAPH_INFO << "Encrypted model " << path
+                << " was saved for another public key";
+    return false;
+  }
+  std::vector<size_t> slots = sorted_keys(m_encrypted_constants);
+  if (read_uint64() != slots.size()) {
+    NGRAPH_INFO << "Encrypted model " << path << " is for another function";
+    return false;
+  }
+
+  std::unordered_map<size_t, std::shared_ptr<HESealCipherTensor>> loaded;
+  try {
+    for (size_t slot_idx : slots) {
+      const TensorSlot& slot = m_tensor_slots[slot_idx];
+      std::string name(slot.name.size(), '\0');
+      bool name_matches = read_uint64() == name.size();
+      if (name_matches) {
+        file.read(&name[0], name.size());
+        name_matches = name == slot.name;
+      }
+      auto tensor = std::make_shared<HESealCipherTensor>(
+          slot.element_type, slot.shape, m_he_seal_backend, slot.packed,
+          slot.name);
+      if (!file || !name_matches ||
+          read_uint64() != tensor->num_ciphertexts()) {
+        NGRAPH_INFO << "Encrypted model " << path
+                    << " is for another function";
+        return false;
+      }
+      for (auto& cipher : tensor->get_elements()) {
+        char known_value = 0;
+        float value = 0;
+        file.read(&known_value, sizeof(known_value));
+        file.read(reinterpret_cast<char*>(&value), sizeof(value));
+        cipher = std::make_shared<SealCiphertextWrapper>();
+        cipher->known_value() = known_value != 0;
+        cipher->value() = value;
+        if (!cipher->known_value()) {
+          cipher->ciphertext().load(m_context, file);
+        }
+      }
+      loaded[slot_idx] = tensor;
+    }
+  } catch (const std::exception& e) {
+    NGRAPH_INFO << "Cannot load encrypted model " << path << ": " << e.what();
+    return false;
+  }
+  if (!file) {
+    NGRAPH_INFO << "Encrypted model " << path << " is truncated";
+    return false;
+  }
+  m_encrypted_constants = std::move(loaded);
+  m_encrypted_constants_key = m_he_seal_backend.get_public_key();
+  return true;
+}
+
+std::shared_ptr<const ngraph::he::EncodedScalars>
+ngraph::he::HESealExecutable::encoded_constant(
+    size_t slot_idx,
+    const std::vector<std::shared_ptr<SealCiphertextWrapper>>& ciphers) {
+  auto it = m_constants.find(slot_idx);
+  if (it == m_constants.end()) {
+    return nullptr;
+  }
+  return it->second->encode(ciphers, m_he_seal_backend);
+}
+
+void ngraph::he::HESealExecutable::resolve_tensor_kinds(
+    const std::vector<std::pair<TensorKind, bool>>& signature) {
+  NGRAPH_CHECK(
+      signature.size() == m_parameter_slots.size() + m_result_slots.size(),
+      "Signature size ", signature.size(), " does not match number of "
+      "parameters and results");
+
+  for (size_t i = 0; i < m_parameter_slots.size(); ++i) {
+    TensorSlot& slot = m_tensor_slots[m_parameter_slots[i]];
+    slot.kind = signature[i].first;
+    slot.packed = signature[i].second;
+  }
+  for (size_t i = 0; i < m_result_slots.size(); ++i) {
+    TensorSlot& slot = m_tensor_slots[m_result_slots[i]];
+    slot.kind = signature[m_parameter_slots.size() + i].first;
+    slot.packed = signature[m_parameter_slots.size() + i].second;
+  }
+
+  for (const ExecutionStep& step : m_execution_plan) {
+    auto type_id = step.node_wrapper.get_typeid();
+    if (type_id == OP_TYPEID::Parameter || type_id == OP_TYPEID::Result) {
+      continue;
+    }
+    const Node& node = *step.node_wrapper.get_node();
+
+    // Plaintext output only if all inputs are plaintext
+    bool plain_out = std::all_of(
+        step.input_slots.begin(), step.input_slots.end(),
+        [this](size_t slot_idx) {
+          return m_tensor_slots[slot_idx].kind == TensorKind::plain;
+        });
+    if (node.is_constant()) {
+      plain_out = !m_encrypt_model;
+    }
+    bool packed_out = std::any_of(
+        step.input_slots.begin(), step.input_slots.end(),
+        [this](size_t slot_idx) { return m_tensor_slots[slot_idx].packed; });
+
+    for (size_t slot_idx : step.output_slots) {
+      TensorSlot& slot = m_tensor_slots[slot_idx];
+      // Avoid broadcasting from constant to output with batch size first
+      // dimension This happens because not every constant is packed, for
+      // examples convolution kernels.
+      bool packed_broadcast = m_batch_data && slot.shape.size() > 0 &&
+                              slot.shape[0] == m_batch_size &&
+                              type_id == OP_TYPEID::Broadcast;
+      slot.kind = plain_out ? TensorKind::plain : TensorKind::cipher;
+      slot.packed = packed_out || packed_broadcast;
+    }
+  }
+  m_plan_signature = signature;
+}
+
+void ngraph::he::HESealExecutable::plan_levels(
+    const std::unordered_map<size_t, size_t>& source_levels) {
+  if (m_chain_parms_ids.empty()) {
+    auto context_data = m_context->first_context_data();
+    m_chain_parms_ids.resize(context_data->chain_index() + 1);
+    for (; context_data != nullptr;
+         context_data = context_data->next_context_data()) {
+      m_chain_parms_ids[context_data->chain_index()] = context_data->parms_id();
+    }
+  }
+  const size_t first_level = m_chain_parms_ids.size() - 1;
+  m_planned_source_levels = source_levels;
+
+  for (TensorSlot& slot : m_tensor_slots) {
+    slot.level = unplanned_level;
+  }
+  for (ExecutionStep& step : m_execution_plan) {
+    step.input_level = unplanned_level;
+    step.switched_args.clear();
+    step.rescale_output = false;
+    // With naive rescaling, some kernels rescale each product, so levels are
+    // matched at runtime instead
+    if (m_he_seal_backend.naive_rescaling()) {
+      continue;
+    }
+
+    auto type_id = step.node_wrapper.get_typeid();
+    size_t out_level = unplanned_level;
+    if (type_id == OP_TYPEID::Parameter || type_id == OP_TYPEID::Constant) {
+      auto it = source_levels.find(step.output_slots[0]);
+      out_level = (it == source_levels.end()) ? first_level : it->second;
+    } else {
+      for (size_t slot_idx : step.input_slots) {
+        const TensorSlot& slot = m_tensor_slots[slot_idx];
+        if (slot.kind == TensorKind::cipher && slot.level < step.input_level) {
+          step.input_level = slot.level;
+        }
+      }
+      out_level = step.input_level;
+    }
+    if (step.input_level != unplanned_level) {
+      for (size_t arg_idx = 0; arg_idx < step.input_slots.size(); ++arg_idx) {
+        const TensorSlot& slot = m_tensor_slots[step.input_slots[arg_idx]];
+        if (slot.kind == TensorKind::cipher && slot.level > step.input_level) {
+          step.switched_args.emplace_back(arg_idx);
+        }
+      }
+    }
+
+    switch (type_id) {
+      case OP_TYPEID::AvgPool:
+      case OP_TYPEID::Convolution:
+      case OP_TYPEID::Dot:
+      case OP_TYPEID::Multiply:
+        // Rescaling to chain index 0 is skipped, which leaves no level for
+        // further multiplications anyway
+        if (out_level != unplanned_level && out_level > 1) {
+          step.rescale_output = true;
+          out_level--;
+        }
+        break;
+      case OP_TYPEID::BoundedRelu:
+      case OP_TYPEID::MaxPool:
+      case OP_TYPEID::Relu:
+        // The client returns results at the level of the inputs, while the
+        // server re-encrypts them at the first level
+        if (!is_client_step(step) && out_level != unplanned_level) {
+          out_level = first_level;
+        }
+        break;
+      default:
+        break;
+    }
+    for (size_t slot_idx : step.output_slots) {
+      TensorSlot& slot = m_tensor_slots[slot_idx];
+      if (slot.kind == TensorKind::cipher) {
+        slot.level = out_level;
+      }
+    }
+  }
+}
+
+std::unordered_map<size_t, size_t>
+ngraph::he::HESealExecutable::source_levels(
+    const std::vector<std::shared_ptr<HETensor>>& tensor_slots) const {
+  const size_t first_level = m_chain_parms_ids.size() - 1;
+  std::unordered_map<size_t, size_t> levels;
+  // The level of a tensor is that of its first ciphertext which is not a
+  // known value
+  auto add_level = [&](size_t slot_idx,
+                       const std::shared_ptr<HETensor>& tensor) {
+    if (tensor == nullptr ||
+        m_tensor_slots[slot_idx].kind != TensorKind::cipher) {
+      return;
+    }
+    auto cipher_tensor = std::static_pointer_cast<HESealCipherTensor>(tensor);
+    for (const auto& cipher : cipher_tensor->get_elements()) {
+      if (!cipher->known_value()) {
+        size_t level = ngraph::he::get_chain_index(*cipher, m_he_seal_backend);
+        if (level != first_level) {
+          levels[slot_idx] = level;
+        }
+        return;
+      }
+    }
+  };
+  // Client inputs are encrypted at the first level, and may still be
+  // arriving
+  if (!m_enable_client) {
+    for (size_t slot_idx : m_parameter_slots) {
+      add_level(slot_idx, tensor_slots[slot_idx]);
+    }
+  }
+  for (const auto& entry : m_encrypted_constants) {
+    add_level(entry.first, entry.second);
+  }
+  return levels;
+}
+
+void ngraph::he::HESealExecutable::switch_input_levels(
+    const ExecutionStep& step,
+    std::vector<std::shared_ptr<HETensor>>& op_inputs) const {
+  if (step.switched_args.empty()) {
+    return;
+  }
+  const seal::parms_id_type& parms_id = m_chain_parms_ids[step.input_level];
+
+  // Whether to rescale or mod-switch is decided against the scale of an
+  // input which is already at the input level
+  double scale = 0;
+  for (size_t arg_idx = 0; arg_idx < op_inputs.size() && scale == 0;
+       ++arg_idx) {
+    const TensorSlot& slot = m_tensor_slots[step.input_slots[arg_idx]];
+    if (slot.kind != TensorKind::cipher || slot.level != step.input_level) {
+      continue;
+    }
+    auto cipher_tensor =
+        std::static_pointer_cast<HESealCipherTensor>(op_inputs[arg_idx]);
+    for (const auto& cipher : cipher_tensor->get_elements()) {
+      if (!cipher->known_value()) {
+        scale = cipher->scale();
+        break;
+      }
+    }
+  }
+
+  for (size_t arg_idx : step.switched_args) {
+    // The streamed input is still arriving, so the kernel matches it
+    if (step.streams_input && arg_idx == 0) {
+      continue;
+    }
+    const TensorSlot& slot = m_tensor_slots[step.input_slots[arg_idx]];
+    if (step.verbose) {
+      NGRAPH_INFO << "Switching " << slot.name << " from chain index "
+                  << slot.level << " to " << step.input_level;
+    }
+    auto arg = std::static_pointer_cast<HESealCipherTensor>(op_inputs[arg_idx]);
+    auto switched = std::make_shared<HESealCipherTensor>(
+        slot.element_type, slot.shape, m_he_seal_backend, slot.packed,
+        slot.name);
+    auto& ciphers = arg->get_elements();
+    auto& switched_ciphers = switched->get_elements();
+    m_he_seal_backend.get_thread_pool().parallel_for(
+        0, ciphers.size(), [&](size_t cipher_idx) {
+          const auto& cipher = ciphers[cipher_idx];
+          if (cipher->known_value()) {
+            switched_ciphers[cipher_idx] = cipher;
+            return;
+          }
+          ngraph::he::match_parms_id(
+              *cipher, *switched_ciphers[cipher_idx], parms_id,
+              scale == 0 ? cipher->scale() : scale, m_he_seal_backend,
+              ngraph::he::ThreadPool::memory_pool());
+        });
+    op_inputs[arg_idx] = switched;
+  }
+}
+
+void ngraph::he::HESealExecutable::rescale_to_next(
+    HESealCipherTensor& cipher_tensor, bool verbose) const {
+  if (verbose) {
+    NGRAPH_INFO << "Rescaling " << cipher_tensor.num_ciphertexts()
+                << " ciphertexts";
+  }
+  typedef std::chrono::high_resolution_clock Clock;
+  auto t1 = Clock::now();
+
+  auto rescale_cipher = [&](size_t i) {
+    auto& cipher = cipher_tensor.get_element(i);
+    if (!cipher->known_value()) {
+      m_he_seal_backend.get_evaluator()->rescale_to_next_inplace(
+          cipher->ciphertext());
+    }
+  };
+  m_he_seal_backend.get_thread_pool().parallel_for(
+      0, cipher_tensor.num_ciphertexts(), rescale_cipher);
+  if (verbose) {
+    auto t2 = Clock::now();
+    NGRAPH_INFO << "Rescale_xxx took "
+                << std::chrono::duration_cast<std::chrono::milliseconds>(t2 -
+                                                                         t1)
+                       .count()
+                << "ms";
+  }
+}
+
 void ngraph::he::HESealExecutable::check_client_supports_function() {
   NGRAPH_CHECK(get_parameters().size() == 1,
                "HESealExecutable only supports parameter size 1 (got ",
@@ -164,14 +763,53 @@ void ngraph::he::HESealExecutable::check_client_supports_function() {
                get_results().size(), "");
 }
 
+void ngraph::he::HESealExecutable::plan_input_streaming() {
+  m_stream_input_shape.clear();
+  for (ExecutionStep& step : m_execution_plan) {
+    step.streams_input = false;
+  }
+  if (!flag_to_bool(std::getenv("NGRAPH_HE_STREAM_INPUT")) ||
+      m_parameter_slots.size() != 1) {
+    return;
+  }
+
+  size_t param_slot = m_parameter_slots[0];
+  if (m_tensor_slots[param_slot].use_count != 1) {
+    return;
+  }
+  for (ExecutionStep& step : m_execution_plan) {
+    if (step.node_wrapper.get_typeid() != OP_TYPEID::Convolution ||
+        step.input_slots[0] != param_slot) {
+      continue;
+    }
+    const auto& conv =
+        static_cast<const op::Convolution&>(*step.node_wrapper.get_node());
+    const Shape& in_shape = step.packed_arg_shapes[0];
+    if (in_shape.size() >= 3 && conv.get_data_dilation_strides()[0] == 1) {
+      NGRAPH_INFO << "Streaming client input of shape {" << join(in_shape)
+                  << "} to " << conv.get_name();
+      step.streams_input = true;
+      m_stream_input_shape = in_shape;
+    }
+  }
+}
+
 void ngraph::he::HESealExecutable::client_setup() {
   if (!m_client_setup) {
     NGRAPH_INFO << "Enable client";
     check_client_supports_function();
+    plan_input_streaming();
+    // Client steps return results at the level of their inputs
+    plan_levels(m_planned_source_levels);
 
-    // Start server
-    NGRAPH_INFO << "Starting server";
-    start_server();
+    if (m_loopback) {
+      NGRAPH_INFO << "Connecting in-process client";
+      connect_loopback_client();
+    } else {
+      // Start server
+      NGRAPH_INFO << "Starting server";
+      start_server();
+    }
 
     // Send encryption parameters
     std::stringstream param_stream;
@@ -183,7 +821,7 @@ void ngraph::he::HESealExecutable::client_setup() {
     std::unique_lock<std::mutex> mlock(m_session_mutex);
     m_session_cond.wait(mlock,
                         std::bind(&HESealExecutable::session_started, this));
-    m_session->do_write(std::move(parms_message));
+    m_session->write_message(std::move(parms_message));
 
     m_client_setup = true;
   } else {
@@ -196,13 +834,15 @@ void ngraph::he::HESealExecutable::accept_connection() {
   auto server_callback = bind(&ngraph::he::HESealExecutable::handle_message,
                               this, std::placeholders::_1);
 
-  m_acceptor->async_accept([this, server_callback](boost::system::error_code ec,
-                                                   tcp::socket socket) {
+  m_acceptor->async_accept([this, server_callback](
+                               boost::system::error_code ec,
+                               stream_protocol::socket socket) {
     if (!ec) {
       NGRAPH_INFO << "Connection accepted";
-      m_session =
+      auto session =
           std::make_shared<TCPSession>(std::move(socket), server_callback);
-      m_session->start();
+      session->start();
+      m_session = session;
       NGRAPH_INFO << "Session started";
 
       std::lock_guard<std::mutex> guard(m_session_mutex);
@@ -216,9 +856,13 @@ void ngraph::he::HESealExecutable::accept_connection() {
 }
 
 void ngraph::he::HESealExecutable::start_server() {
-  tcp::resolver resolver(m_io_context);
-  tcp::endpoint server_endpoints(tcp::v4(), m_port);
-  m_acceptor = std::make_unique<tcp::acceptor>(m_io_context, server_endpoints);
+  Transport transport = transport_from_env();
+  if (transport == Transport::unix_socket) {
+    // Remove the socket file left by a previous server
+    std::remove(unix_socket_path(m_port).c_str());
+  }
+  m_acceptor = std::make_unique<stream_acceptor>(
+      m_io_context, server_endpoint(transport, m_port));
   boost::asio::socket_base::reuse_address option(true);
   m_acceptor->set_option(option);
 
@@ -226,195 +870,195 @@ void ngraph::he::HESealExecutable::start_server() {
   m_thread = std::thread([this]() { m_io_context.run(); });
 }
 
+void ngraph::he::HESealExecutable::connect_loopback_client() {
+  auto channels = LoopbackChannel::create_pair();
+  channels.first->start(bind(&ngraph::he::HESealExecutable::handle_message,
+                             this, std::placeholders::_1));
+  m_loopback_client = channels.second;
+
+  std::lock_guard<std::mutex> guard(m_session_mutex);
+  m_session = channels.first;
+  m_session_started = true;
+  m_session_cond.notify_one();
+}
+
+void ngraph::he::HESealExecutable::send_parameter_size() {
+  const ParameterVector& input_parameters = get_parameters();
+  size_t num_param_elements = 0;
+  for (const auto& param : input_parameters) {
+    auto& shape = param->get_shape();
+    num_param_elements += shape_size(shape);
+    NGRAPH_INFO << "Parameter shape " << join(shape, "x");
+  }
+
+  if (m_batch_data) {
+    NGRAPH_DEBUG << "num_param_elements before batch size divide "
+                 << num_param_elements;
+    num_param_elements /= m_batch_size;
+    NGRAPH_DEBUG << "num_param_elements after batch size divide "
+                 << num_param_elements;
+  }
+
+  NGRAPH_DEBUG << "Requesting total of " << num_param_elements
+               << " parameter elements";
+  // A streamed input is requested in spatial order by appending its shape
+  std::vector<size_t> parameter_data{num_param_elements};
+  parameter_data.insert(parameter_data.end(), m_stream_input_shape.begin(),
+                        m_stream_input_shape.end());
+  ngraph::he::TCPMessage parameter_message{
+      MessageType::parameter_size, 1, parameter_data.size() * sizeof(size_t),
+      reinterpret_cast<char*>(parameter_data.data())};
+
+  NGRAPH_DEBUG << "Server sending message of type: parameter_size";
+  m_session->write_message(std::move(parameter_message));
+}
+
 void ngraph::he::HESealExecutable::handle_message(
-    const ngraph::he::TCPMessage& message) {
+    ngraph::he::TCPMessage&& message) {
   MessageType msg_type = message.message_type();
 
   NGRAPH_DEBUG << "Server received message type: "
                << message_type_to_string(msg_type);
 
   if (msg_type == MessageType::execute) {
+    // Inputs arrive as a sequence of frames, which are loaded as they arrive
     size_t count = message.count();
-    size_t ciphertext_size = message.element_size();
+    size_t element_offset = message.element_offset();
+    size_t total_count = message.total_count();
 
     NGRAPH_CHECK(m_context != nullptr);
+    if (element_offset == 0) {
+      check_client_supports_function();
 
-    NGRAPH_INFO << "Loading " << count << " ciphertexts";
-    std::vector<seal::Ciphertext> ciphertexts(count);
-#pragma omp parallel for
-    for (size_t i = 0; i < count; ++i) {
-      seal::MemoryPoolHandle pool = seal::MemoryPoolHandle::ThreadLocal();
-      std::stringstream stream;
-      stream.write(message.data_ptr() + i * ciphertext_size, ciphertext_size);
-      seal::Ciphertext c(pool);
-      c.load(m_context, stream);
-      ciphertexts[i] = c;
-    }
-    NGRAPH_INFO << "Done loading " << count << " ciphertexts";
-    std::vector<std::shared_ptr<ngraph::he::SealCiphertextWrapper>>
-        he_cipher_inputs(ciphertexts.size());
-#pragma omp parallel for
-    for (size_t cipher_idx = 0; cipher_idx < ciphertexts.size(); ++cipher_idx) {
-      auto wrapper = std::make_shared<ngraph::he::SealCiphertextWrapper>(
-          ciphertexts[cipher_idx]);
-      he_cipher_inputs[cipher_idx] = wrapper;
+      size_t num_param_elements = 0;
+      for (auto input_param : get_parameters()) {
+        num_param_elements += shape_size(input_param->get_shape());
+      }
+      num_param_elements /= m_batch_size;
+      NGRAPH_CHECK(total_count == num_param_elements, "Count ", total_count,
+                   " does not match number of parameter elements ( ",
+                   num_param_elements, ")");
+
+      m_client_input_ciphers.assign(total_count, nullptr);
+      m_client_input_count = 0;
+      if (!m_stream_input_shape.empty()) {
+        // Execution starts while the remaining inputs are received
+        set_client_inputs();
+      }
     }
-
-    // only support parameter size 1 for now
-    NGRAPH_CHECK(get_parameters().size() == 1,
-                 "HESealExecutable only supports parameter size 1 (got ",
-                 get_parameters().size(), ")");
-
-    // only support function output size 1 for now
-    NGRAPH_CHECK(get_results().size() == 1,
-                 "HESealExecutable only supports output size 1 (got ",
-                 get_results().size(), "");
-
-    // Load function with parameters
-    size_t num_param_elements = 0;
-    const ParameterVector& input_parameters = get_parameters();
-    for (auto input_param : input_parameters) {
-      num_param_elements += shape_size(input_param->get_shape());
+    NGRAPH_CHECK(total_count == m_client_input_ciphers.size() &&
+                     element_offset + count <= total_count,
+                 "Execute frame of ", count, " elements at offset ",
+                 element_offset, " does not fit ",
+                 m_client_input_ciphers.size(), " client inputs");
+
+    NGRAPH_DEBUG << "Loading " << count << " ciphertexts at offset "
+                 << element_offset;
+    std::vector<seal::Ciphertext> ciphertexts;
+    message.load_ciphertexts(ciphertexts, m_context,
+                             m_he_seal_backend.get_thread_pool());
+    NGRAPH_CHECK(ciphertexts.size() == count, "Expected ", count,
+                 " ciphertexts in execute frame, got ", ciphertexts.size());
+
+    // Streamed inputs are stored directly in the input tensor, which is
+    // already being read
+    std::vector<std::shared_ptr<ngraph::he::SealCiphertextWrapper>>&
+        input_ciphers =
+            m_stream_input_shape.empty()
+                ? m_client_input_ciphers
+                : std::static_pointer_cast<HESealCipherTensor>(
+                      m_client_inputs[0])
+                      ->get_elements();
+    m_he_seal_backend.get_thread_pool().parallel_for(
+        0, count, [&](size_t cipher_idx) {
+          size_t element_idx = element_offset + cipher_idx;
+          if (!m_stream_input_shape.empty()) {
+            element_idx = ngraph::he::spatial_stream_index(
+                element_idx, m_stream_input_shape);
+          }
+          input_ciphers[element_idx] =
+              std::make_shared<ngraph::he::SealCiphertextWrapper>(
+                  ciphertexts[cipher_idx], m_complex_packing);
+        });
+    {
+      std::lock_guard<std::mutex> guard(m_client_inputs_mutex);
+      m_client_input_count += count;
+      m_client_inputs_cond.notify_all();
+    }
+
+    if (m_client_input_count == total_count) {
+      NGRAPH_INFO << "Done loading " << total_count << " ciphertexts";
+      if (m_stream_input_shape.empty()) {
+        set_client_inputs();
+      }
+      m_client_input_ciphers.clear();
+    }
+  } else if (msg_type == MessageType::key_id) {
+    // A returning client skips uploading its keys if they are cached
+    m_client_key_id.assign(message.data_ptr(), message.data_size());
+    KeyCache::Keys keys;
+    if (m_he_seal_backend.get_key_cache().find(m_client_key_id, m_context,
+                                               keys)) {
+      NGRAPH_INFO << "Server using cached keys " << m_client_key_id;
+      m_he_seal_backend.set_public_key(keys.public_key);
+      m_he_seal_backend.set_relin_keys(keys.relin_keys);
+      send_parameter_size();
+    } else {
+      NGRAPH_INFO << "Server requesting keys " << m_client_key_id;
+      m_session->write_message(TCPMessage(MessageType::key_request, 1,
+                                          m_client_key_id.size(),
+                                          m_client_key_id.data()));
     }
-    num_param_elements /= m_batch_size;
-    NGRAPH_CHECK(count == num_param_elements, "Count ", count,
-                 " does not match number of parameter elements ( ",
-                 num_param_elements, ")");
-
-    NGRAPH_INFO << "Setting m_client_inputs";
-    size_t parameter_size_index = 0;
-    for (auto input_param : input_parameters) {
-      const auto& shape = input_param->get_shape();
-      size_t param_size = shape_size(shape) / m_batch_size;
-      auto element_type = input_param->get_element_type();
-      auto input_tensor =
-          std::dynamic_pointer_cast<ngraph::he::HESealCipherTensor>(
-              m_he_seal_backend.create_cipher_tensor(
-                  element_type, input_param->get_shape(), m_batch_data,
-                  "client_parameter"));
-
-      std::vector<std::shared_ptr<ngraph::he::SealCiphertextWrapper>>
-          cipher_elements{
-              he_cipher_inputs.begin() + parameter_size_index,
-              he_cipher_inputs.begin() + parameter_size_index + param_size};
-
-      NGRAPH_CHECK(cipher_elements.size() == param_size,
-                   "Incorrect number of elements for parameter");
-
-      input_tensor->set_elements(cipher_elements);
-      for (auto& cipher_elem : cipher_elements) {
-        cipher_elem->complex_packing() = m_complex_packing;
-      }
-      m_client_inputs.emplace_back(input_tensor);
-      parameter_size_index += param_size;
-    }
-
-    NGRAPH_CHECK(m_client_inputs.size() == get_parameters().size(),
-                 "Client inputs size ", m_client_inputs.size(), "; expected ",
-                 get_parameters().size());
-
-    std::lock_guard<std::mutex> guard(m_client_inputs_mutex);
-    m_client_inputs_received = true;
-    m_client_inputs_cond.notify_all();
   } else if (msg_type == MessageType::public_key) {
-    seal::PublicKey key;
-    std::stringstream key_stream;
-    key_stream.write(message.data_ptr(), message.element_size());
-    key.load(m_context, key_stream);
+    if (!add_client_key_frame(message)) {
+      return;
+    }
+    auto key = std::make_shared<seal::PublicKey>();
+    std::stringstream key_stream(m_client_key_data);
+    m_client_key_data.clear();
+    key->load(m_context, key_stream);
 
+    // Keys are only cached under the id derived from them, so a client
+    // cannot replace the keys of another
+    if (!m_client_key_id.empty() &&
+        m_client_key_id != ngraph::he::key_id_from_public_key(*key)) {
+      NGRAPH_INFO << "Key id " << m_client_key_id
+                  << " does not match public key; keys are not cached";
+      m_client_key_id.clear();
+    }
+    m_client_public_key = key;
     m_he_seal_backend.set_public_key(key);
 
     NGRAPH_INFO << "Server set public key";
 
   } else if (msg_type == MessageType::eval_key) {
-    seal::RelinKeys keys;
-    std::stringstream key_stream;
-    key_stream.write(message.data_ptr(), message.element_size());
-    keys.load(m_context, key_stream);
-
-    m_he_seal_backend.set_relin_keys(keys);
-
-    // Send inference parameter shape
-    const ParameterVector& input_parameters = get_parameters();
-    size_t num_param_elements = 0;
-    for (const auto& param : input_parameters) {
-      auto& shape = param->get_shape();
-      num_param_elements += shape_size(shape);
-      NGRAPH_INFO << "Parameter shape " << join(shape, "x");
-    }
-
-    if (m_batch_data) {
-      NGRAPH_DEBUG << "num_param_elements before batch size divide "
-                   << num_param_elements;
-      num_param_elements /= m_batch_size;
-      NGRAPH_DEBUG << "num_param_elements after batch size divide "
-                   << num_param_elements;
-    }
-
-    NGRAPH_DEBUG << "Requesting total of " << num_param_elements
-                 << " parameter elements";
-    ngraph::he::TCPMessage parameter_message{
-        MessageType::parameter_size, 1, sizeof(num_param_elements),
-        reinterpret_cast<char*>(&num_param_elements)};
-
-    NGRAPH_DEBUG << "Server sending message of type: parameter_size";
-    m_session->do_write(std::move(parameter_message));
-  } else if (msg_type == MessageType::relu_result) {
-    std::lock_guard<std::mutex> guard(m_relu_mutex);
-
-    size_t element_count = message.count();
-    size_t element_size = message.element_size();
-
-#pragma omp parallel for
-    for (size_t element_idx = 0; element_idx < element_count; ++element_idx) {
-      seal::Ciphertext cipher;
-      std::stringstream cipher_stream;
-      cipher_stream.write(message.data_ptr() + element_idx * element_size,
-                          element_size);
-      cipher.load(m_context, cipher_stream);
-
-      auto new_cipher = std::make_shared<ngraph::he::SealCiphertextWrapper>(
-          cipher, m_complex_packing);
-
-      m_relu_ciphertexts[m_unknown_relu_idx[element_idx]] = new_cipher;
+    if (!add_client_key_frame(message)) {
+      return;
     }
+    auto keys = std::make_shared<seal::RelinKeys>();
+    std::stringstream key_stream(m_client_key_data);
+    m_client_key_data.clear();
+    keys->load(m_context, key_stream);
 
-    // Notify condition variable
-    m_relu_done = true;
-    m_relu_cond.notify_all();
-  } else if (msg_type == MessageType::max_result) {
-    std::lock_guard<std::mutex> guard(m_max_mutex);
-
-    size_t element_count = message.count();
-    size_t element_size = message.element_size();
-
-    for (size_t element_idx = 0; element_idx < element_count; ++element_idx) {
-      seal::Ciphertext cipher;
-      std::stringstream cipher_stream;
-      cipher_stream.write(message.data_ptr() + element_idx * element_size,
-                          element_size);
-      cipher.load(m_context, cipher_stream);
-      auto new_cipher = std::make_shared<ngraph::he::SealCiphertextWrapper>(
-          cipher, m_complex_packing);
+    m_he_seal_backend.set_relin_keys(keys);
 
-      m_max_ciphertexts.emplace_back(new_cipher);
+    if (!m_client_key_id.empty() && m_client_public_key != nullptr &&
+        !m_he_seal_backend.get_key_cache().insert(
+            m_client_key_id, KeyCache::Keys{m_client_public_key, keys})) {
+      NGRAPH_INFO << "Keys " << m_client_key_id << " already cached";
     }
-    // Notify condition variable
-    m_max_done = true;
-    m_max_cond.notify_one();
+    send_parameter_size();
+  } else if (msg_type == MessageType::relu_result ||
+             msg_type == MessageType::max_result) {
+    handle_client_result(std::move(message));
   } else if (msg_type == MessageType::minimum_result) {
     std::lock_guard<std::mutex> guard(m_minimum_mutex);
 
-    size_t element_count = message.count();
-    size_t element_size = message.element_size();
-
-    for (size_t element_idx = 0; element_idx < element_count; ++element_idx) {
-      seal::Ciphertext cipher;
-      std::stringstream cipher_stream;
-      cipher_stream.write(message.data_ptr() + element_idx * element_size,
-                          element_size);
-      cipher.load(m_context, cipher_stream);
+    std::vector<seal::Ciphertext> ciphers;
+    message.load_ciphertexts(ciphers, m_context,
+                             m_he_seal_backend.get_thread_pool());
 
+    for (const seal::Ciphertext& cipher : ciphers) {
       auto he_ciphertext = std::make_shared<ngraph::he::SealCiphertextWrapper>(
           cipher, m_complex_packing);
       m_minimum_ciphertexts.emplace_back(he_ciphertext);
@@ -430,13 +1074,327 @@ void ngraph::he::HESealExecutable::handle_message(
   }
 }
 
+bool ngraph::he::HESealExecutable::add_client_key_frame(
+    const TCPMessage& message) {
+  // Frames of a key arrive in order, each holding the following bytes
+  NGRAPH_CHECK(message.element_offset() == m_client_key_data.size(),
+               "Expected ", message_type_to_string(message.message_type()),
+               " frame at offset ", m_client_key_data.size(), ", got ",
+               message.element_offset());
+  m_client_key_data.append(message.data_ptr(), message.data_size());
+  return m_client_key_data.size() == message.total_count();
+}
+
+void ngraph::he::HESealExecutable::set_client_inputs() {
+  NGRAPH_INFO << "Setting m_client_inputs";
+  size_t parameter_size_index = 0;
+  for (auto input_param : get_parameters()) {
+    const auto& shape = input_param->get_shape();
+    size_t param_size = shape_size(shape) / m_batch_size;
+    auto element_type = input_param->get_element_type();
+    auto input_tensor =
+        std::dynamic_pointer_cast<ngraph::he::HESealCipherTensor>(
+            m_he_seal_backend.create_cipher_tensor(
+                element_type, input_param->get_shape(), m_batch_data,
+                "client_parameter"));
+
+    std::vector<std::shared_ptr<ngraph::he::SealCiphertextWrapper>>
+        cipher_elements{
+            m_client_input_ciphers.begin() + parameter_size_index,
+            m_client_input_ciphers.begin() + parameter_size_index + param_size};
+
+    NGRAPH_CHECK(cipher_elements.size() == param_size,
+                 "Incorrect number of elements for parameter");
+
+    input_tensor->set_elements(cipher_elements);
+    m_client_inputs.emplace_back(input_tensor);
+    parameter_size_index += param_size;
+  }
+
+  NGRAPH_CHECK(m_client_inputs.size() == get_parameters().size(),
+               "Client inputs size ", m_client_inputs.size(), "; expected ",
+               get_parameters().size());
+
+  std::lock_guard<std::mutex> guard(m_client_inputs_mutex);
+  m_client_inputs_received = true;
+  m_client_inputs_cond.notify_all();
+}
+
+size_t ngraph::he::HESealExecutable::wait_for_client_input_rows(size_t rows) {
+  size_t row_size = shape_size(m_stream_input_shape) / m_stream_input_shape[2];
+  std::unique_lock<std::mutex> lock(m_client_inputs_mutex);
+  m_client_inputs_cond.wait(
+      lock, [&]() { return m_client_input_count >= rows * row_size; });
+  return m_client_input_count / row_size;
+}
+
+void ngraph::he::HESealExecutable::streaming_convolution(
+    const op::Convolution& conv,
+    const std::vector<std::shared_ptr<SealCiphertextWrapper>>& arg0,
+    std::vector<std::shared_ptr<SealCiphertextWrapper>>& out,
+    const Shape& arg0_shape, const Shape& arg1_shape, const Shape& out_shape,
+    const BandConvolution& convolve_band, bool verbose) {
+  // Rows are along axis 2, the first spatial axis. Each row holds
+  // outer_size * inner_size elements, and is contiguous in stream order
+  size_t in_rows = arg0_shape[2];
+  size_t out_rows = out_shape[2];
+  size_t outer_size = arg0_shape[0] * arg0_shape[1];
+  size_t in_inner_size = shape_size(arg0_shape) / (outer_size * in_rows);
+  size_t out_outer_size = out_shape[0] * out_shape[1];
+  size_t out_inner_size = shape_size(out_shape) / (out_outer_size * out_rows);
+
+  auto stride = static_cast<std::ptrdiff_t>(
+      conv.get_window_movement_strides()[0]);
+  std::ptrdiff_t window_rows =
+      (arg1_shape[2] - 1) * conv.get_window_dilation_strides()[0] + 1;
+  std::ptrdiff_t padding_below = conv.get_padding_below()[0];
+  // Input rows [first_in_row(r), end_in_row(r)) are read by output row r,
+  // including padding rows
+  auto first_in_row = [&](size_t out_row) {
+    return static_cast<std::ptrdiff_t>(out_row) * stride - padding_below;
+  };
+  auto end_in_row = [&](size_t out_row) {
+    return first_in_row(out_row) + window_rows;
+  };
+  auto in_rows_needed = [&](size_t out_row) {
+    return static_cast<size_t>(std::max(
+        std::min(end_in_row(out_row), static_cast<std::ptrdiff_t>(in_rows)),
+        std::ptrdiff_t(1)));
+  };
+
+  size_t band_start = 0;
+  while (band_start < out_rows) {
+    size_t rows_received =
+        wait_for_client_input_rows(in_rows_needed(band_start));
+    size_t band_end = band_start + 1;
+    while (band_end < out_rows && in_rows_needed(band_end) <= rows_received) {
+      band_end++;
+    }
+
+    Shape band_out_shape = out_shape;
+    band_out_shape[2] = band_end - band_start;
+    std::vector<std::shared_ptr<SealCiphertextWrapper>> band_out(
+        shape_size(band_out_shape));
+
+    // Convolve the input rows read by the band, padding the rows outside the
+    // input as the full convolution does
+    std::ptrdiff_t band_first = first_in_row(band_start);
+    std::ptrdiff_t band_last = end_in_row(band_end - 1);
+    std::ptrdiff_t in_start = std::max(band_first, std::ptrdiff_t(0));
+    std::ptrdiff_t in_end =
+        std::min(band_last, static_cast<std::ptrdiff_t>(in_rows));
+    if (in_start < in_end) {
+      CoordinateDiff band_padding_below = conv.get_padding_below();
+      CoordinateDiff band_padding_above = conv.get_padding_above();
+      band_padding_below[0] = in_start - band_first;
+      band_padding_above[0] = band_last - in_end;
+
+      Shape band_in_shape = arg0_shape;
+      band_in_shape[2] = in_end - in_start;
+      std::vector<std::shared_ptr<SealCiphertextWrapper>> band_in;
+      band_in.reserve(shape_size(band_in_shape));
+      for (size_t outer_idx = 0; outer_idx < outer_size; ++outer_idx) {
+        auto row_begin = arg0.begin() +
+                         (outer_idx * in_rows + in_start) * in_inner_size;
+        band_in.insert(band_in.end(), row_begin,
+                       row_begin + (in_end - in_start) * in_inner_size);
+      }
+
+      convolve_band(band_in, band_in_shape, band_out, band_out_shape,
+                    band_padding_below, band_padding_above);
+    } else {
+      // The band reads only padding
+      for (auto& cipher : band_out) {
+        cipher = std::make_shared<SealCiphertextWrapper>();
+        cipher->known_value() = true;
+        cipher->value() = 0;
+      }
+    }
+
+    size_t band_row_size = (band_end - band_start) * out_inner_size;
+    for (size_t outer_idx = 0; outer_idx < out_outer_size; ++outer_idx) {
+      std::copy(band_out.begin() + outer_idx * band_row_size,
+                band_out.begin() + (outer_idx + 1) * band_row_size,
+                out.begin() +
+                    (outer_idx * out_rows + band_start) * out_inner_size);
+    }
+    if (verbose) {
+      NGRAPH_INFO << "Computed output rows " << band_start << " to "
+                  << band_end << " of " << out_rows;
+    }
+    band_start = band_end;
+  }
+}
+
+void ngraph::he::HESealExecutable::mod_switch_for_client(
+    std::vector<seal::Ciphertext>& ciphers) {
+  // Messages store ciphertexts at a single level, so all ciphertexts are
+  // switched to the lowest level which suits each of them, but no lower than
+  // the lowest current level
+  size_t chain_index = 0;
+  size_t min_chain_index = std::numeric_limits<size_t>::max();
+  for (const seal::Ciphertext& cipher : ciphers) {
+    chain_index = std::max(
+        chain_index, ngraph::he::lowest_chain_index(cipher, m_he_seal_backend));
+    min_chain_index = std::min(
+        min_chain_index, m_context->get_context_data(cipher.parms_id())
+                             ->chain_index());
+  }
+  chain_index = std::min(chain_index, min_chain_index);
+  m_he_seal_backend.get_thread_pool().parallel_for(
+      0, ciphers.size(), [&](size_t cipher_idx) {
+        ngraph::he::mod_switch_to_chain_index_inplace(
+            ciphers[cipher_idx], chain_index, m_he_seal_backend,
+            ngraph::he::ThreadPool::memory_pool());
+      });
+}
+
+size_t ngraph::he::HESealExecutable::client_request_elements(
+    const seal::Ciphertext& cipher, size_t ciphers_per_element) const {
+  // Ciphertexts are stored with their scale
+  size_t element_size =
+      ciphers_per_element *
+      (sizeof(double) + cipher.uint64_count() * sizeof(uint64_t));
+  size_t elements =
+      std::min(m_client_message_size / ciphers_per_element,
+               static_cast<size_t>(TCPMessage::max_frame_size) / element_size);
+  return std::max(elements, size_t(1));
+}
+
+void ngraph::he::HESealExecutable::check_result_chain_index(
+    const std::vector<seal::Ciphertext>& ciphers, size_t chain_index) const {
+  // Ciphertexts of a message share their parms_id
+  NGRAPH_CHECK(!ciphers.empty(), "Client result without ciphertexts");
+  auto context_data = m_context->get_context_data(ciphers[0].parms_id());
+  NGRAPH_CHECK(context_data != nullptr,
+               "Client result parms_id not in context");
+  NGRAPH_CHECK(context_data->chain_index() == chain_index,
+               "Expected client result at chain index ", chain_index, ", got ",
+               context_data->chain_index());
+}
+
+void ngraph::he::HESealExecutable::send_client_request(
+    TCPMessage&& message, ClientRequest request) {
+  NGRAPH_CHECK(request.client_op != nullptr, "Client request without op");
+  {
+    std::lock_guard<std::mutex> guard(m_client_request_mutex);
+    uint64_t request_id = m_next_request_id++;
+    message.set_request_id(request_id);
+    m_client_requests.emplace(request_id, std::move(request));
+  }
+  m_session->write_message(std::move(message));
+}
+
+void ngraph::he::HESealExecutable::handle_client_result(
+    TCPMessage&& message) {
+  ClientRequest request;
+  {
+    std::lock_guard<std::mutex> guard(m_client_request_mutex);
+    auto request_it = m_client_requests.find(message.request_id());
+    NGRAPH_CHECK(request_it != m_client_requests.end(), "Received ",
+                 message_type_to_string(message.message_type()),
+                 " for unknown request id ", message.request_id());
+    request = std::move(request_it->second);
+    m_client_requests.erase(request_it);
+  }
+
+  // Results are decoded on the thread pool, so the decode thread can move on
+  // to the next message. Errors are reported to the requesting step
+  auto result = std::make_shared<TCPMessage>(std::move(message));
+  m_he_seal_backend.get_thread_pool().submit(
+      [request = std::move(request), result]() {
+        std::exception_ptr error = nullptr;
+        try {
+          NGRAPH_CHECK(request.result_type == result->message_type(),
+                       "Expected ", message_type_to_string(request.result_type),
+                       " but received ",
+                       message_type_to_string(result->message_type()));
+          request.handle_result(*result);
+        } catch (...) {
+          error = std::current_exception();
+        }
+        request.client_op->finish_request(error);
+      });
+}
+
+void ngraph::he::HESealExecutable::ClientOp::send_request(SendFunction send) {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  NGRAPH_CHECK(m_sending, "Cannot add request to finished client op");
+  if (m_error != nullptr) {
+    return;
+  }
+  if (m_outstanding_requests >= m_max_outstanding) {
+    m_pending_sends.emplace_back(std::move(send));
+    return;
+  }
+  m_outstanding_requests++;
+  lock.unlock();
+  run_send(send);
+}
+
+void ngraph::he::HESealExecutable::ClientOp::run_send(
+    const SendFunction& send) {
+  try {
+    send(shared_from_this());
+  } catch (...) {
+    finish_request(std::current_exception());
+  }
+}
+
+void ngraph::he::HESealExecutable::ClientOp::finish_request(
+    std::exception_ptr error) {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  if (error != nullptr && m_error == nullptr) {
+    m_error = error;
+  }
+  m_outstanding_requests--;
+  if (m_error != nullptr) {
+    m_pending_sends.clear();
+  } else if (!m_pending_sends.empty()) {
+    // The answered request's place goes to the next queued one
+    SendFunction send = std::move(m_pending_sends.front());
+    m_pending_sends.pop_front();
+    m_outstanding_requests++;
+    lock.unlock();
+    run_send(send);
+    return;
+  }
+  complete_if_done(lock);
+}
+
+void ngraph::he::HESealExecutable::ClientOp::finish_sending(
+    std::exception_ptr error) {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  if (error != nullptr && m_error == nullptr) {
+    m_error = error;
+  }
+  if (m_error != nullptr) {
+    m_pending_sends.clear();
+  }
+  m_sending = false;
+  complete_if_done(lock);
+}
+
+void ngraph::he::HESealExecutable::ClientOp::complete_if_done(
+    std::unique_lock<std::mutex>& lock) {
+  if (m_sending || m_outstanding_requests > 0) {
+    return;
+  }
+  std::exception_ptr error = m_error;
+  lock.unlock();
+  m_on_complete(error);
+}
+
 std::vector<ngraph::runtime::PerformanceCounter>
 ngraph::he::HESealExecutable::get_performance_data() const {
   std::vector<runtime::PerformanceCounter> rc;
-  for (const std::pair<std::shared_ptr<const Node>, stopwatch> p :
-       m_timer_map) {
-    rc.emplace_back(p.first, p.second.get_total_microseconds(),
-                    p.second.get_call_count());
+  for (size_t step_idx = 0; step_idx < m_execution_plan.size(); ++step_idx) {
+    const stopwatch& timer = m_step_timers[step_idx];
+    if (timer.get_call_count() == 0) {
+      continue;
+    }
+    rc.emplace_back(m_execution_plan[step_idx].node_wrapper.get_node(),
+                    timer.get_total_microseconds(), timer.get_call_count());
   }
   return rc;
 }
@@ -495,181 +1453,101 @@ bool ngraph::he::HESealExecutable::call(
     he_outputs.push_back(std::static_pointer_cast<ngraph::he::HETensor>(tv));
   }
 
-  std::unordered_map<ngraph::descriptor::Tensor*,
-                     std::shared_ptr<ngraph::he::HETensor>>
-      tensor_map;
-
-  // map function params -> HETensor
-  size_t input_count = 0;
-  for (auto param : get_parameters()) {
-    for (size_t param_idx = 0; param_idx < param->get_output_size();
-         ++param_idx) {
-      descriptor::Tensor* tv = param->get_output_tensor_ptr(param_idx).get();
-
-      if (!m_enable_client && m_encrypt_data) {
-        NGRAPH_DEBUG << "Encrypting parameter " << param_idx;
-        auto plain_input = std::dynamic_pointer_cast<ngraph::he::HEPlainTensor>(
-            he_inputs[input_count]);
-        NGRAPH_CHECK(plain_input != nullptr, "Input is not plain tensor");
-        std::string name = tv->get_name();
-
-        auto cipher_input = std::dynamic_pointer_cast<HESealCipherTensor>(
-            m_he_seal_backend.create_cipher_tensor(
-                plain_input->get_element_type(), plain_input->get_shape(),
-                m_batch_data, name));
-
-#pragma omp parallel for
-        for (size_t plain_idx = 0;
-             plain_idx < plain_input->get_batched_element_count();
-             ++plain_idx) {
-          m_he_seal_backend.encrypt(cipher_input->get_element(plain_idx),
-                                    plain_input->get_element(plain_idx),
-                                    m_complex_packing);
-        }
-        NGRAPH_DEBUG << "Done encrypting parameter";
-        plain_input->reset();
-        tensor_map.insert({tv, cipher_input});
-        input_count++;
-      } else {
-        tensor_map.insert({tv, he_inputs[input_count++]});
-      }
+  // Kind and packing of the parameters and results for this call
+  std::vector<std::pair<TensorKind, bool>> signature;
+  for (size_t input_idx = 0; input_idx < m_parameter_slots.size();
+       ++input_idx) {
+    if (!m_enable_client && m_encrypt_data) {
+      signature.emplace_back(TensorKind::cipher, m_batch_data);
+    } else {
+      auto& he_input = he_inputs[input_idx];
+      bool is_cipher =
+          std::dynamic_pointer_cast<HESealCipherTensor>(he_input) != nullptr;
+      signature.emplace_back(
+          is_cipher ? TensorKind::cipher : TensorKind::plain,
+          he_input->is_packed());
     }
   }
-
-  // map function outputs -> HostTensor
-  for (size_t output_count = 0; output_count < get_results().size();
-       ++output_count) {
-    auto output = get_results()[output_count];
-    if (!std::dynamic_pointer_cast<op::Result>(output)) {
-      throw ngraph_error("One of function's outputs isn't op::Result");
-    }
-    ngraph::descriptor::Tensor* tv = output->get_output_tensor_ptr(0).get();
-    tensor_map.insert({tv, he_outputs[output_count++]});
+  for (auto& he_output : he_outputs) {
+    bool is_cipher =
+        std::dynamic_pointer_cast<HESealCipherTensor>(he_output) != nullptr;
+    signature.emplace_back(is_cipher ? TensorKind::cipher : TensorKind::plain,
+                           he_output->is_packed());
+  }
+  bool kinds_changed = signature != m_plan_signature;
+  if (kinds_changed) {
+    NGRAPH_DEBUG << "Re-resolving tensor kinds for new input / output types";
+    resolve_tensor_kinds(signature);
   }
 
-  // for each ordered op in the graph
-  for (const NodeWrapper& wrapped : m_wrapped_nodes) {
-    auto op = wrapped.get_node();
-    auto type_id = wrapped.get_typeid();
-    bool verbose = verbose_op(*op);
+  std::vector<std::shared_ptr<ngraph::he::HETensor>> tensor_slots(
+      m_tensor_slots.size());
 
-    if (verbose) {
-      NGRAPH_INFO << "\033[1;32m"
-                  << "[ " << op->get_name() << " ]"
-                  << "\033[0m";
-      if (type_id == OP_TYPEID::Constant) {
-        NGRAPH_INFO << "Constant shape {" << join(op->get_shape()) << "}";
-      }
+  // map function params -> HETensor
+  for (size_t input_idx = 0; input_idx < m_parameter_slots.size();
+       ++input_idx) {
+    size_t slot_idx = m_parameter_slots[input_idx];
+    if (!m_enable_client && m_encrypt_data) {
+      NGRAPH_DEBUG << "Encrypting parameter " << input_idx;
+      auto plain_input = std::dynamic_pointer_cast<ngraph::he::HEPlainTensor>(
+          he_inputs[input_idx]);
+      NGRAPH_CHECK(plain_input != nullptr, "Input is not plain tensor");
+      const std::string& name = m_tensor_slots[slot_idx].name;
+
+      auto cipher_input = std::dynamic_pointer_cast<HESealCipherTensor>(
+          m_he_seal_backend.create_cipher_tensor(
+              plain_input->get_element_type(), plain_input->get_shape(),
+              m_batch_data, name));
+
+      auto encrypt_element = [&](size_t plain_idx) {
+        m_he_seal_backend.encrypt(cipher_input->get_element(plain_idx),
+                                  plain_input->get_element(plain_idx),
+                                  m_complex_packing);
+      };
+      m_he_seal_backend.get_thread_pool().parallel_for(
+          0, plain_input->get_batched_element_count(), encrypt_element);
+      NGRAPH_DEBUG << "Done encrypting parameter";
+      plain_input->reset();
+      tensor_slots[slot_idx] = cipher_input;
+    } else {
+      tensor_slots[slot_idx] = he_inputs[input_idx];
     }
+  }
 
-    if (type_id == OP_TYPEID::Parameter) {
-      if (verbose) {
-        NGRAPH_INFO << "Parameter shape {" << join(op->get_shape()) << "}";
-      }
-      continue;
-    }
-    m_timer_map[op].start();
-
-    // get op inputs from map
-    std::vector<std::shared_ptr<ngraph::he::HETensor>> op_inputs;
-    for (auto input : op->inputs()) {
-      descriptor::Tensor* tensor = &input.get_tensor();
-      op_inputs.push_back(tensor_map.at(tensor));
-    }
-
-    if (m_enable_client && type_id == OP_TYPEID::Result) {
-      // Client outputs remain ciphertexts, so don't perform result op on them
-      NGRAPH_INFO << "Setting client outputs";
-      m_client_outputs = op_inputs;
-    }
-
-    // get op outputs from map or create
-    std::vector<std::shared_ptr<ngraph::he::HETensor>> op_outputs;
-    for (size_t i = 0; i < op->get_output_size(); ++i) {
-      auto tensor = &op->output(i).get_tensor();
-      auto it = tensor_map.find(tensor);
-      if (it == tensor_map.end()) {
-        // The output tensor is not in the tensor map so create a new tensor
-        const Shape& shape = op->get_output_shape(i);
-        const element::Type& element_type = op->get_output_element_type(i);
-        std::string name = op->output(i).get_tensor().get_name();
-
-        // Plaintext output only if all inputs are plaintext
-        bool plain_out = all_of(
-            op_inputs.begin(), op_inputs.end(),
-            [](std::shared_ptr<ngraph::he::HETensor> op_input) {
-              return std::dynamic_pointer_cast<HEPlainTensor>(op_input) !=
-                     nullptr;
-            });
-        if (op->is_constant()) {
-          plain_out = !m_encrypt_model;
-        }
-        bool packed_out =
-            std::any_of(op_inputs.begin(), op_inputs.end(),
-                        [](std::shared_ptr<ngraph::he::HETensor> he_tensor) {
-                          return he_tensor->is_packed();
-                        });
-        // Avoid broadcasting from constant to output with batch size first
-        // dimension This happens because not every constant is packed, for
-        // examples convolution kernels.
-        if (m_batch_data && shape.size() > 0 && shape[0] == m_batch_size &&
-            op->description() == "Broadcast") {
-          packed_out = true;
-        }
+  // map function outputs -> HETensor
+  for (size_t output_idx = 0; output_idx < m_result_slots.size();
+       ++output_idx) {
+    tensor_slots[m_result_slots[output_idx]] = he_outputs[output_idx];
+  }
 
-        if (plain_out) {
-          auto out_tensor = std::make_shared<ngraph::he::HEPlainTensor>(
-              element_type, shape, m_he_seal_backend, packed_out, name);
-          tensor_map.insert({tensor, out_tensor});
-        } else {
-          auto out_tensor = std::make_shared<ngraph::he::HESealCipherTensor>(
-              element_type, shape, m_he_seal_backend, packed_out, name);
-          tensor_map.insert({tensor, out_tensor});
-        }
-      }
-      op_outputs.push_back(tensor_map.at(tensor));
-    }
+  bool encrypting_model = false;
+  if (m_encrypt_model) {
+    encrypting_model = !prepare_encrypted_constants();
+  }
 
-    // get op type
-    element::Type base_type;
-    if (op->get_inputs().empty()) {
-      base_type = op->get_element_type();
-    } else {
-      base_type = op->get_inputs().at(0).get_tensor().get_element_type();
-    }
+  // Levels are planned for the levels of the cipher inputs, which differ
+  // from the first level only if the caller passes inputs at lower levels
+  std::unordered_map<size_t, size_t> levels = source_levels(tensor_slots);
+  if (kinds_changed || levels != m_planned_source_levels) {
+    NGRAPH_DEBUG << "Re-planning levels for new input levels";
+    plan_levels(levels);
+  }
 
-    generate_calls(base_type, wrapped, op_outputs, op_inputs);
-    m_timer_map[op].stop();
+  stopwatch plan_timer;
+  plan_timer.start();
+  run_execution_plan(tensor_slots);
+  plan_timer.stop();
 
-    // delete any obsolete tensors
-    for (const descriptor::Tensor* t : op->liveness_free_list) {
-      bool erased = false;
-      for (auto it = tensor_map.begin(); it != tensor_map.end(); ++it) {
-        const std::string& it_name = it->second->get_name();
-        if (it_name == t->get_name()) {
-          tensor_map.erase(it);
-          erased = true;
-          break;
-        }
-      }
-      if (!erased) {
-        NGRAPH_DEBUG << "Failed to erase " << t->get_name()
-                     << " from tensor map";
-      }
-    }
-    if (verbose) {
-      NGRAPH_INFO << "\033[1;31m" << op->get_name() << " took "
-                  << m_timer_map[op].get_milliseconds() << "ms"
-                  << "\033[0m";
-    }
-  }
-  size_t total_time = 0;
-  for (const auto& elem : m_timer_map) {
-    total_time += elem.second.get_milliseconds();
+  // Constants are saved after the call, at the levels they are used at
+  const char* encrypted_model_path = std::getenv("NGRAPH_HE_ENCRYPTED_MODEL");
+  if (encrypting_model && encrypted_model_path != nullptr) {
+    NGRAPH_INFO << "Saving encrypted model to " << encrypted_model_path;
+    save_encrypted_constants(encrypted_model_path);
   }
   if (verbose_op("total")) {
     NGRAPH_INFO << "\033[1;32m"
-                << "Total time " << total_time << " (ms) \033[0m";
+                << "Total time " << plan_timer.get_milliseconds()
+                << " (ms) \033[0m";
   }
 
   // Send outputs to client.
@@ -690,151 +1568,387 @@ bool ngraph::he::HESealExecutable::call(
     NGRAPH_CHECK(output_cipher_tensor != nullptr,
                  "Client outputs are not HESealCipherTensor");
 
-    std::stringstream cipher_stream;
-    output_cipher_tensor->save_elements(cipher_stream);
-    auto result_message = TCPMessage(MessageType::result, output_shape_size,
-                                     std::move(cipher_stream));
-
-    // auto result_message =
-    //    TCPMessage(MessageType::result, output_cipher_tensor->get_elements());
+    const auto& output_elements = output_cipher_tensor->get_elements();
+    seal_output.reserve(output_elements.size());
+    for (const auto& output_element : output_elements) {
+      seal_output.emplace_back(output_element->ciphertext());
+    }
+    mod_switch_for_client(seal_output);
 
     NGRAPH_INFO << "Writing Result message with " << output_shape_size
                 << " ciphertexts ";
-    m_session->do_write(std::move(result_message));
+    TCPMessage::encode_frames(
+        MessageType::result, seal_output, 1,
+        m_he_seal_backend.get_thread_pool(), [this](TCPMessage&& frame) {
+          m_session->write_message(std::move(frame));
+        });
+  }
+  // Message buffers of this call are not needed until the next one
+  MessageBufferPool::global()->trim();
+  return true;
+}
 
-    std::unique_lock<std::mutex> mlock(m_result_mutex);
+double ngraph::he::HESealExecutable::estimate_cost(
+    const ExecutionStep& step) const {
+  const Node& node = *step.node_wrapper.get_node();
+  double out_size = shape_size(step.packed_out_shape);
 
-    // Wait until message is written
-    std::condition_variable& writing_cond = m_session->is_writing_cond();
-    // const std::shared_ptr<TCPSession> const_m_session = m_session;
-    writing_cond.wait(mlock, [this] { return !m_session->is_writing(); });
+  switch (step.node_wrapper.get_typeid()) {
+    case OP_TYPEID::Convolution: {
+      // Each output is a dot product over input channels and window
+      const Shape& filter_shape = step.unpacked_arg_shapes[1];
+      return out_size * shape_size(filter_shape) / filter_shape[0];
+    }
+    case OP_TYPEID::Dot: {
+      const op::Dot* dot = static_cast<const op::Dot*>(&node);
+      const Shape& arg1_shape = step.unpacked_arg_shapes[1];
+      size_t reduction_size = 1;
+      for (size_t i = 0; i < dot->get_reduction_axes_count(); ++i) {
+        reduction_size *= arg1_shape[i];
+      }
+      return out_size * reduction_size;
+    }
+    case OP_TYPEID::AvgPool: {
+      const op::AvgPool* avg_pool = static_cast<const op::AvgPool*>(&node);
+      return out_size * shape_size(avg_pool->get_window_shape());
+    }
+    case OP_TYPEID::MaxPool: {
+      const op::MaxPool* max_pool = static_cast<const op::MaxPool*>(&node);
+      return out_size * shape_size(max_pool->get_window_shape());
+    }
+    case OP_TYPEID::Sum:
+      return shape_size(step.packed_arg_shapes[0]);
+    case OP_TYPEID::Parameter:
+      return 0;
+    default:
+      return out_size;
   }
-  return true;
 }
 
-void ngraph::he::HESealExecutable::generate_calls(
-    const element::Type& type, const NodeWrapper& node_wrapper,
-    const std::vector<std::shared_ptr<HETensor>>& out,
-    const std::vector<std::shared_ptr<HETensor>>& args) {
-  const Node& node = *node_wrapper.get_node();
-  bool verbose = verbose_op(node);
-  std::string node_op = node.description();
-  std::shared_ptr<HESealCipherTensor> arg0_cipher = nullptr;
-  std::shared_ptr<HEPlainTensor> arg0_plain = nullptr;
-  std::shared_ptr<HESealCipherTensor> arg1_cipher = nullptr;
-  std::shared_ptr<HEPlainTensor> arg1_plain = nullptr;
-  auto out0_cipher = std::dynamic_pointer_cast<HESealCipherTensor>(out[0]);
-  auto out0_plain = std::dynamic_pointer_cast<HEPlainTensor>(out[0]);
+void ngraph::he::HESealExecutable::run_execution_plan(
+    std::vector<std::shared_ptr<HETensor>>& tensor_slots) {
+  const size_t step_count = m_execution_plan.size();
+  ThreadPool& thread_pool = m_he_seal_backend.get_thread_pool();
+  const size_t max_threads = std::max(thread_pool.num_threads(), size_t(1));
 
-  // TODO: move to static function
-  auto lazy_rescaling = [this](auto& cipher_tensor,
-                               bool verbose_rescaling = true) {
-    if (m_he_seal_backend.naive_rescaling()) {
-      return;
+  std::vector<size_t> pending_dependencies(step_count);
+  std::vector<size_t> ready_steps;
+  for (size_t step_idx = 0; step_idx < step_count; ++step_idx) {
+    pending_dependencies[step_idx] =
+        m_execution_plan[step_idx].dependency_count;
+    if (pending_dependencies[step_idx] == 0) {
+      ready_steps.emplace_back(step_idx);
     }
-    if (verbose_rescaling) {
-      NGRAPH_INFO << "Rescaling " << cipher_tensor->num_ciphertexts()
-                  << " ciphertexts";
+  }
+  std::vector<size_t> remaining_uses(m_tensor_slots.size());
+  for (size_t slot_idx = 0; slot_idx < m_tensor_slots.size(); ++slot_idx) {
+    remaining_uses[slot_idx] = m_tensor_slots[slot_idx].use_count;
+  }
+
+  std::mutex mutex;
+  std::condition_variable cond;
+  size_t completed_steps = 0;
+  size_t running_steps = 0;
+  // Steps waiting for client results. These don't occupy a thread
+  size_t client_steps = 0;
+  // Steps dispatched but not yet finished, including client steps
+  size_t active_steps = 0;
+  m_max_concurrent_steps = 0;
+  size_t free_threads = max_threads;
+  std::exception_ptr error = nullptr;
+
+  // Releases tensors which are no longer used and marks dependents whose
+  // inputs are all available as ready. Must be called with mutex held.
+  auto complete_step = [&](size_t step_idx) {
+    const ExecutionStep& step = m_execution_plan[step_idx];
+    for (size_t slot_idx : step.input_slots) {
+      if (--remaining_uses[slot_idx] == 0 &&
+          !m_tensor_slots[slot_idx].persistent) {
+        tensor_slots[slot_idx] = nullptr;
+      }
+    }
+    for (size_t slot_idx : step.output_slots) {
+      if (remaining_uses[slot_idx] == 0 &&
+          !m_tensor_slots[slot_idx].persistent) {
+        tensor_slots[slot_idx] = nullptr;
+      }
     }
+    for (size_t dependent_idx : step.dependents) {
+      if (--pending_dependencies[dependent_idx] == 0) {
+        ready_steps.emplace_back(dependent_idx);
+      }
+    }
+    completed_steps++;
+  };
+  // Must be called with mutex held
+  auto finish_step = [&](size_t step_idx, std::exception_ptr step_error) {
+    active_steps--;
+    if (step_error != nullptr) {
+      if (error == nullptr) {
+        error = step_error;
+      }
+    } else {
+      complete_step(step_idx);
+    }
+  };
+  auto step_cost = [this](size_t step_idx) {
+    return std::max(m_execution_plan[step_idx].estimated_cost, 1.0);
+  };
 
-    typedef std::chrono::high_resolution_clock Clock;
-    auto t1 = Clock::now();
-    size_t new_chain_index = std::numeric_limits<size_t>::max();
+  // Runs a step without holding mutex. Client steps only send or queue their
+  // requests here, and release their thread; the remaining requests are sent
+  // as results arrive, and the step finishes with the last result, so the
+  // round trip overlaps with other steps. Returns whether the step finished.
+  auto execute_step = [&](size_t step_idx, std::exception_ptr& step_error) {
+    std::shared_ptr<ClientOp> client_op;
+    if (is_client_step(m_execution_plan[step_idx])) {
+      client_op = std::make_shared<ClientOp>(
+          [&, step_idx](std::exception_ptr op_error) {
+            m_step_timers[step_idx].stop();
+            std::lock_guard<std::mutex> guard(mutex);
+            finish_step(step_idx, op_error);
+            client_steps--;
+            cond.notify_all();
+          },
+          max_client_requests_in_flight);
+    }
+    try {
+      run_step(step_idx, tensor_slots, client_op);
+    } catch (...) {
+      step_error = std::current_exception();
+    }
+    if (client_op == nullptr) {
+      return true;
+    }
+    client_op->finish_sending(step_error);
+    step_error = nullptr;
+    return false;
+  };
 
-    bool all_known_values = true;
-    for (size_t cipher_idx = 0; cipher_idx < cipher_tensor->num_ciphertexts();
-         ++cipher_idx) {
-      auto& cipher = cipher_tensor->get_element(cipher_idx);
-      if (!cipher->known_value()) {
-        size_t curr_chain_index =
-            get_chain_index(cipher->ciphertext(), m_he_seal_backend);
-        if (curr_chain_index == 0) {
-          new_chain_index = 0;
-        } else {
-          new_chain_index = curr_chain_index - 1;
-        }
-        all_known_values = false;
+  std::unique_lock<std::mutex> lock(mutex);
+  while (completed_steps < step_count && error == nullptr) {
+    if (ready_steps.empty() || free_threads == 0) {
+      if (running_steps == 0 && client_steps == 0) {
+        error = std::make_exception_ptr(
+            ngraph_error("No step of the execution plan is ready"));
         break;
       }
+      cond.wait(lock);
+      continue;
     }
 
-    if (all_known_values) {
-      if (verbose_rescaling) {
-        NGRAPH_INFO << "Skipping rescaling because all values are known";
+    // Most expensive ready step last
+    std::sort(ready_steps.begin(), ready_steps.end(),
+              [&step_cost](size_t step_a, size_t step_b) {
+                return step_cost(step_a) < step_cost(step_b);
+              });
+
+    // Split the free threads between the ready steps by estimated cost
+    double ready_cost = 0;
+    for (size_t step_idx : ready_steps) {
+      ready_cost += step_cost(step_idx);
+    }
+    const size_t available_threads = free_threads;
+    while (!ready_steps.empty() && free_threads > 0) {
+      size_t step_idx = ready_steps.back();
+      ready_steps.pop_back();
+
+      size_t step_threads = static_cast<size_t>(
+          available_threads * step_cost(step_idx) / ready_cost);
+      step_threads = std::min(std::max(step_threads, size_t(1)), free_threads);
+      free_threads -= step_threads;
+      running_steps++;
+      active_steps++;
+      m_max_concurrent_steps = std::max(m_max_concurrent_steps, active_steps);
+      if (is_client_step(m_execution_plan[step_idx])) {
+        client_steps++;
       }
-      return;
+
+      thread_pool.submit([&, step_idx, step_threads]() {
+        // The worker's settings are restored, since it runs other tasks later
+        size_t worker_parallelism = ThreadPool::max_parallelism();
+        ThreadPool::set_max_parallelism(step_threads);
+        std::exception_ptr step_error = nullptr;
+        bool finished = execute_step(step_idx, step_error);
+        ThreadPool::set_max_parallelism(worker_parallelism);
+        std::lock_guard<std::mutex> guard(mutex);
+        if (finished) {
+          finish_step(step_idx, step_error);
+        }
+        free_threads += step_threads;
+        running_steps--;
+        cond.notify_all();
+      });
     }
+  }
 
-    NGRAPH_CHECK(new_chain_index != std::numeric_limits<size_t>::max(),
-                 "Lazy rescaling called on cipher tensor of all known values");
-    if (new_chain_index == 0) {
-      if (verbose_rescaling) {
-        NGRAPH_INFO << "Skipping rescaling to chain index 0";
-      }
+  // Wait for running steps and outstanding client requests, e.g. if a step
+  // failed
+  cond.wait(lock, [&running_steps, &client_steps] {
+    return running_steps == 0 && client_steps == 0;
+  });
+  lock.unlock();
+  if (error != nullptr) {
+    std::rethrow_exception(error);
+  }
+}
+
+bool ngraph::he::HESealExecutable::is_client_step(
+    const ExecutionStep& step) const {
+  return m_enable_client && step.client_op &&
+         m_tensor_slots[step.input_slots[0]].kind == TensorKind::cipher;
+}
+
+void ngraph::he::HESealExecutable::run_step(
+    size_t step_idx, std::vector<std::shared_ptr<HETensor>>& tensor_slots,
+    const std::shared_ptr<ClientOp>& client_op) {
+  const ExecutionStep& step = m_execution_plan[step_idx];
+  const auto& op = step.node_wrapper.get_node();
+  auto type_id = step.node_wrapper.get_typeid();
+  bool verbose = step.verbose;
+
+  if (verbose) {
+    NGRAPH_INFO << "\033[1;32m"
+                << "[ " << op->get_name() << " ]"
+                << "\033[0m";
+    if (type_id == OP_TYPEID::Constant) {
+      NGRAPH_INFO << "Constant shape {" << join(step.out_shape) << "}";
+    }
+  }
+
+  if (type_id == OP_TYPEID::Parameter) {
+    if (verbose) {
+      NGRAPH_INFO << "Parameter shape {" << join(step.out_shape) << "}";
+    }
+    return;
+  }
+  // Materialized and encrypted constants are reused. The slot's map entry
+  // exists before the call, so steps only modify their own entry
+  auto encrypted_constant = m_encrypted_constants.end();
+  if (type_id == OP_TYPEID::Constant) {
+    auto it = m_constants.find(step.output_slots[0]);
+    if (it != m_constants.end()) {
+      tensor_slots[step.output_slots[0]] = it->second->tensor();
       return;
     }
-    if (verbose_rescaling) {
-      NGRAPH_INFO << "New chain index " << new_chain_index;
+    encrypted_constant = m_encrypted_constants.find(step.output_slots[0]);
+    if (encrypted_constant != m_encrypted_constants.end() &&
+        encrypted_constant->second != nullptr) {
+      tensor_slots[step.output_slots[0]] = encrypted_constant->second;
+      return;
     }
+  }
+  stopwatch& timer = m_step_timers[step_idx];
+  timer.start();
+
+  // get op inputs from slots
+  std::vector<std::shared_ptr<ngraph::he::HETensor>> op_inputs;
+  op_inputs.reserve(step.input_slots.size());
+  for (size_t slot_idx : step.input_slots) {
+    op_inputs.emplace_back(tensor_slots[slot_idx]);
+  }
+  switch_input_levels(step, op_inputs);
 
-#pragma omp parallel for
-    for (size_t i = 0; i < cipher_tensor->num_ciphertexts(); ++i) {
-      auto cipher = cipher_tensor->get_element(i);
-      if (!cipher->known_value()) {
-        m_he_seal_backend.get_evaluator()->rescale_to_next_inplace(
-            cipher->ciphertext());
+  if (m_enable_client && type_id == OP_TYPEID::Result) {
+    // Client outputs remain ciphertexts, so don't perform result op on them
+    NGRAPH_INFO << "Setting client outputs";
+    m_client_outputs = op_inputs;
+  }
+
+  // get op outputs from slots or create
+  std::vector<std::shared_ptr<ngraph::he::HETensor>> op_outputs;
+  op_outputs.reserve(step.output_slots.size());
+  for (size_t slot_idx : step.output_slots) {
+    std::shared_ptr<ngraph::he::HETensor>& out_tensor = tensor_slots[slot_idx];
+    if (out_tensor == nullptr) {
+      const TensorSlot& slot = m_tensor_slots[slot_idx];
+      if (slot.kind == TensorKind::plain) {
+        out_tensor = std::make_shared<ngraph::he::HEPlainTensor>(
+            slot.element_type, slot.shape, m_he_seal_backend, slot.packed,
+            slot.name);
+      } else {
+        out_tensor = std::make_shared<ngraph::he::HESealCipherTensor>(
+            slot.element_type, slot.shape, m_he_seal_backend, slot.packed,
+            slot.name);
       }
     }
-    if (verbose_rescaling) {
-      auto t2 = Clock::now();
-      NGRAPH_INFO << "Rescale_xxx took "
-                  << std::chrono::duration_cast<std::chrono::milliseconds>(t2 -
-                                                                           t1)
-                         .count()
-                  << "ms";
-    }
-  };
+    op_outputs.emplace_back(out_tensor);
+  }
 
-  std::vector<Shape> packed_arg_shapes{};
-  std::vector<Shape> unpacked_arg_shapes{};
-  for (size_t arg_idx = 0; arg_idx < args.size(); ++arg_idx) {
-    Shape arg_shape = node.get_input_shape(arg_idx);
-    unpacked_arg_shapes.emplace_back(arg_shape);
-    if (m_batch_data) {
-      arg_shape = ngraph::he::HETensor::pack_shape(arg_shape);
-    }
-    packed_arg_shapes.emplace_back(arg_shape);
+  generate_calls(step, op_outputs, op_inputs, client_op);
+  if (encrypted_constant != m_encrypted_constants.end()) {
+    encrypted_constant->second =
+        std::static_pointer_cast<HESealCipherTensor>(op_outputs[0]);
   }
 
-  Shape out_shape{};
-  Shape packed_out_shape{};
-  if (node.get_output_size() > 0) {
-    NGRAPH_CHECK(node.get_output_size() == 1,
-                 "Only support single-output functions");
-    out_shape = node.get_output_shape(0);
-    packed_out_shape = out_shape;
-    if (m_batch_data) {
-      packed_out_shape = ngraph::he::HETensor::pack_shape(packed_out_shape);
+  // Client steps are timed until their results arrive
+  if (client_op == nullptr) {
+    timer.stop();
+    if (verbose) {
+      NGRAPH_INFO << "\033[1;31m" << op->get_name() << " took "
+                  << timer.get_milliseconds() << "ms"
+                  << "\033[0m";
     }
   }
+}
+
+void ngraph::he::HESealExecutable::generate_calls(
+    const ExecutionStep& step,
+    const std::vector<std::shared_ptr<HETensor>>& out,
+    const std::vector<std::shared_ptr<HETensor>>& args,
+    const std::shared_ptr<ClientOp>& client_op) {
+  const NodeWrapper& node_wrapper = step.node_wrapper;
+  const Node& node = *node_wrapper.get_node();
+  const element::Type& type = step.base_type;
+  bool verbose = step.verbose;
+  std::shared_ptr<HESealCipherTensor> arg0_cipher = nullptr;
+  std::shared_ptr<HEPlainTensor> arg0_plain = nullptr;
+  std::shared_ptr<HESealCipherTensor> arg1_cipher = nullptr;
+  std::shared_ptr<HEPlainTensor> arg1_plain = nullptr;
+  std::shared_ptr<HESealCipherTensor> out0_cipher = nullptr;
+  std::shared_ptr<HEPlainTensor> out0_plain = nullptr;
 
+  // Tensor kinds are resolved in the execution plan, so static casts suffice
+  auto slot_is_cipher = [this](size_t slot_idx) {
+    return m_tensor_slots[slot_idx].kind == TensorKind::cipher;
+  };
+  if (out.size() > 0) {
+    if (slot_is_cipher(step.output_slots[0])) {
+      out0_cipher = std::static_pointer_cast<HESealCipherTensor>(out[0]);
+    } else {
+      out0_plain = std::static_pointer_cast<HEPlainTensor>(out[0]);
+    }
+  }
   if (args.size() > 0) {
-    arg0_cipher = std::dynamic_pointer_cast<HESealCipherTensor>(args[0]);
-    arg0_plain = std::dynamic_pointer_cast<HEPlainTensor>(args[0]);
-    NGRAPH_CHECK(arg0_cipher == nullptr || arg0_plain == nullptr,
-                 "arg0 is neither cipher nor plain");
-    NGRAPH_CHECK(!(arg0_cipher != nullptr && arg0_plain != nullptr),
-                 "arg0 is both cipher and plain?");
+    if (slot_is_cipher(step.input_slots[0])) {
+      arg0_cipher = std::static_pointer_cast<HESealCipherTensor>(args[0]);
+    } else {
+      arg0_plain = std::static_pointer_cast<HEPlainTensor>(args[0]);
+    }
   }
   if (args.size() > 1) {
-    arg1_cipher = std::dynamic_pointer_cast<HESealCipherTensor>(args[1]);
-    arg1_plain = std::dynamic_pointer_cast<HEPlainTensor>(args[1]);
-    NGRAPH_CHECK(arg1_cipher == nullptr || arg1_plain == nullptr,
-                 "arg1 is neither cipher nor plain");
-    NGRAPH_CHECK(!(arg1_cipher != nullptr && arg1_plain != nullptr),
-                 "arg1 is both cipher and plain?");
+    if (slot_is_cipher(step.input_slots[1])) {
+      arg1_cipher = std::static_pointer_cast<HESealCipherTensor>(args[1]);
+    } else {
+      arg1_plain = std::static_pointer_cast<HEPlainTensor>(args[1]);
+    }
   }
 
+  // Outputs are rescaled where plan_levels() planned, so their chain index is
+  // not looked up here
+  auto lazy_rescaling =
+      [this, &step](const std::shared_ptr<HESealCipherTensor>& cipher_tensor,
+                    bool verbose_rescaling) {
+        if (step.rescale_output) {
+          rescale_to_next(*cipher_tensor, verbose_rescaling);
+        }
+      };
+
+  const std::vector<Shape>& packed_arg_shapes = step.packed_arg_shapes;
+  const std::vector<Shape>& unpacked_arg_shapes = step.unpacked_arg_shapes;
+  const Shape& out_shape = step.out_shape;
+  const Shape& packed_out_shape = step.packed_out_shape;
+
   if (verbose) {
     std::stringstream ss;
     ss << "Inputs: ";
@@ -849,13 +1963,10 @@ void ngraph::he::HESealExecutable::generate_calls(
       ss << ", Plain";
     }
     for (size_t arg_ind = 2; arg_ind < args.size(); ++arg_ind) {
-      auto arg = args[arg_ind];
-      if (std::dynamic_pointer_cast<HESealCipherTensor>(arg) != nullptr) {
+      if (slot_is_cipher(step.input_slots[arg_ind])) {
         ss << ", Cipher";
-      } else if (std::dynamic_pointer_cast<HEPlainTensor>(arg) != nullptr) {
-        ss << ", Plain";
       } else {
-        throw ngraph_error("argument is neither plain nor cipher tensor");
+        ss << ", Plain";
       }
     }
 
@@ -886,16 +1997,20 @@ void ngraph::he::HESealExecutable::generate_calls(
             out0_cipher->get_batched_element_count());
       } else if (arg0_cipher != nullptr && arg1_plain != nullptr &&
                  out0_cipher != nullptr) {
+        auto encoded_arg1 = encoded_constant(step.input_slots[1],
+                                             arg0_cipher->get_elements());
         ngraph::he::add_seal(
             arg0_cipher->get_elements(), arg1_plain->get_elements(),
             out0_cipher->get_elements(), type, m_he_seal_backend,
-            out0_cipher->get_batched_element_count());
+            out0_cipher->get_batched_element_count(), encoded_arg1.get());
       } else if (arg0_plain != nullptr && arg1_cipher != nullptr &&
                  out0_cipher != nullptr) {
+        auto encoded_arg0 = encoded_constant(step.input_slots[0],
+                                             arg1_cipher->get_elements());
         ngraph::he::add_seal(
             arg0_plain->get_elements(), arg1_cipher->get_elements(),
             out0_cipher->get_elements(), type, m_he_seal_backend,
-            out0_cipher->get_batched_element_count());
+            out0_cipher->get_batched_element_count(), encoded_arg0.get());
       } else if (arg0_plain != nullptr && arg1_plain != nullptr &&
                  out0_plain != nullptr) {
         ngraph::he::add_seal(
@@ -1005,7 +2120,8 @@ void ngraph::he::HESealExecutable::generate_calls(
       NGRAPH_CHECK(alpha == 6.0f,
                    "Client supports BoundeRelu(6) only; got BoundedRelu(",
                    alpha, ")");
-      handle_server_relu_op(arg0_cipher, out0_cipher, node_wrapper);
+      handle_server_relu_op(arg0_cipher, out0_cipher, node_wrapper,
+                            client_op);
       break;
     }
     case OP_TYPEID::Broadcast: {
@@ -1101,8 +2217,45 @@ void ngraph::he::HESealExecutable::generate_calls(
       Shape in_shape0 = packed_arg_shapes[0];
       Shape in_shape1 = unpacked_arg_shapes[1];
 
-      if (arg0_cipher != nullptr && arg1_cipher != nullptr &&
+      if (step.streams_input && arg0_cipher != nullptr &&
           out0_cipher != nullptr) {
+        auto convolve_band =
+            [&](const std::vector<std::shared_ptr<SealCiphertextWrapper>>&
+                    band_in,
+                const Shape& band_in_shape,
+                std::vector<std::shared_ptr<SealCiphertextWrapper>>& band_out,
+                const Shape& band_out_shape,
+                const CoordinateDiff& band_padding_below,
+                const CoordinateDiff& band_padding_above) {
+              if (arg1_plain != nullptr) {
+                // Encoded at the level of the received rows
+                auto encoded_arg1 =
+                    encoded_constant(step.input_slots[1], band_in);
+                ngraph::he::convolution_seal(
+                    band_in, arg1_plain->get_elements(), band_out,
+                    band_in_shape, in_shape1, band_out_shape,
+                    window_movement_strides, window_dilation_strides,
+                    band_padding_below, band_padding_above,
+                    data_dilation_strides, 0, 1, 1, 0, 0, 1, false, type,
+                    m_batch_size, m_he_seal_backend, verbose,
+                    encoded_arg1.get());
+              } else {
+                ngraph::he::convolution_seal(
+                    band_in, arg1_cipher->get_elements(), band_out,
+                    band_in_shape, in_shape1, band_out_shape,
+                    window_movement_strides, window_dilation_strides,
+                    band_padding_below, band_padding_above,
+                    data_dilation_strides, 0, 1, 1, 0, 0, 1, false, type,
+                    m_batch_size, m_he_seal_backend, verbose);
+              }
+            };
+        streaming_convolution(*c, arg0_cipher->get_elements(),
+                              out0_cipher->get_elements(), in_shape0,
+                              in_shape1, packed_out_shape, convolve_band,
+                              verbose);
+        lazy_rescaling(out0_cipher, verbose);
+      } else if (arg0_cipher != nullptr && arg1_cipher != nullptr &&
+                 out0_cipher != nullptr) {
         ngraph::he::convolution_seal(
             arg0_cipher->get_elements(), arg1_cipher->get_elements(),
             out0_cipher->get_elements(), in_shape0, in_shape1, packed_out_shape,
@@ -1112,21 +2265,25 @@ void ngraph::he::HESealExecutable::generate_calls(
         lazy_rescaling(out0_cipher, verbose);
       } else if (arg0_cipher != nullptr && arg1_plain != nullptr &&
                  out0_cipher != nullptr) {
+        auto encoded_arg1 = encoded_constant(step.input_slots[1],
+                                             arg0_cipher->get_elements());
         ngraph::he::convolution_seal(
             arg0_cipher->get_elements(), arg1_plain->get_elements(),
             out0_cipher->get_elements(), in_shape0, in_shape1, packed_out_shape,
             window_movement_strides, window_dilation_strides, padding_below,
             padding_above, data_dilation_strides, 0, 1, 1, 0, 0, 1, false, type,
-            m_batch_size, m_he_seal_backend, verbose);
+            m_batch_size, m_he_seal_backend, verbose, encoded_arg1.get());
         lazy_rescaling(out0_cipher, verbose);
       } else if (arg0_plain != nullptr && arg1_cipher != nullptr &&
                  out0_cipher != nullptr) {
+        auto encoded_arg0 = encoded_constant(step.input_slots[0],
+                                             arg1_cipher->get_elements());
         ngraph::he::convolution_seal(
             arg0_plain->get_elements(), arg1_cipher->get_elements(),
             out0_cipher->get_elements(), in_shape0, in_shape1, packed_out_shape,
             window_movement_strides, window_dilation_strides, padding_below,
             padding_above, data_dilation_strides, 0, 1, 1, 0, 0, 1, false, type,
-            m_batch_size, m_he_seal_backend, verbose);
+            m_batch_size, m_he_seal_backend, verbose, encoded_arg0.get());
         lazy_rescaling(out0_cipher, verbose);
       } else if (arg0_plain != nullptr && arg1_plain != nullptr &&
                  out0_plain != nullptr) {
@@ -1158,17 +2315,23 @@ void ngraph::he::HESealExecutable::generate_calls(
         lazy_rescaling(out0_cipher, verbose);
       } else if (arg0_cipher != nullptr && arg1_plain != nullptr &&
                  out0_cipher != nullptr) {
+        auto encoded_arg1 = encoded_constant(step.input_slots[1],
+                                             arg0_cipher->get_elements());
         ngraph::he::dot_seal(
             arg0_cipher->get_elements(), arg1_plain->get_elements(),
             out0_cipher->get_elements(), in_shape0, in_shape1, packed_out_shape,
-            dot->get_reduction_axes_count(), type, m_he_seal_backend);
+            dot->get_reduction_axes_count(), type, m_he_seal_backend,
+            encoded_arg1.get());
         lazy_rescaling(out0_cipher, verbose);
       } else if (arg0_plain != nullptr && arg1_cipher != nullptr &&
                  out0_cipher != nullptr) {
+        auto encoded_arg0 = encoded_constant(step.input_slots[0],
+                                             arg1_cipher->get_elements());
         ngraph::he::dot_seal(
             arg0_plain->get_elements(), arg1_cipher->get_elements(),
             out0_cipher->get_elements(), in_shape0, in_shape1, packed_out_shape,
-            dot->get_reduction_axes_count(), type, m_he_seal_backend);
+            dot->get_reduction_axes_count(), type, m_he_seal_backend,
+            encoded_arg0.get());
         lazy_rescaling(out0_cipher, verbose);
       } else if (arg0_plain != nullptr && arg1_plain != nullptr &&
                  out0_plain != nullptr) {
@@ -1194,7 +2357,7 @@ void ngraph::he::HESealExecutable::generate_calls(
         break;
       }
       if (arg0_cipher == nullptr || out0_cipher == nullptr) {
-        throw ngraph_error("Relu types not supported");
+        throw ngraph_error("MaxPool supports only Cipher, Cipher");
       }
 
       if (!m_enable_client) {
@@ -1215,13 +2378,7 @@ void ngraph::he::HESealExecutable::generate_calls(
         break;
       }
 
-      if (arg0_cipher == nullptr || out0_cipher == nullptr) {
-        NGRAPH_INFO << "MaxPool types not supported ";
-        throw ngraph_error("MaxPool supports only Cipher, Cipher");
-      }
-
-      m_max_ciphertexts.clear();
-      m_max_done = false;
+      NGRAPH_CHECK(client_op != nullptr, "MaxPool requires a client op");
 
       std::vector<std::vector<size_t>> maximize_list =
           ngraph::he::max_pool_seal(packed_arg_shapes[0], packed_out_shape,
@@ -1230,44 +2387,101 @@ void ngraph::he::HESealExecutable::generate_calls(
                                     max_pool->get_padding_below(),
                                     max_pool->get_padding_above());
 
-      size_t window_shape = ngraph::shape_size(max_pool->get_window_shape());
-
-      std::vector<seal::Ciphertext> maxpool_ciphers;
-      maxpool_ciphers.reserve(window_shape);
-      for (size_t list_ind = 0; list_ind < maximize_list.size(); list_ind++) {
-        size_t cipher_cnt = 0;
-        for (const size_t max_ind : maximize_list[list_ind]) {
-          auto& cipher = arg0_cipher->get_element(max_ind);
-          if (cipher->known_value()) {
-            // TODO: parallelize with 0s removed
-            NGRAPH_INFO << "Got max(known_value) at index " << max_ind;
-            throw ngraph_error("max(known_value) not allowed");
-          }
-          maxpool_ciphers.emplace_back(cipher->ciphertext());
-          cipher_cnt++;
+      // Windows are padded to a common size by repeating their first element,
+      // which leaves their maximum unchanged. Each window is then one element
+      // of a max_request, and many windows are sent in a single request.
+      size_t window_size = 0;
+      for (const std::vector<size_t>& window : maximize_list) {
+        NGRAPH_CHECK(!window.empty(), "MaxPool window lies in padding");
+        window_size = std::max(window_size, window.size());
+      }
+      // Requests hold about as many ciphertexts as Relu requests
+      const size_t windows_per_message = client_request_elements(
+          arg0_cipher->get_element(maximize_list[0][0])->ciphertext(),
+          window_size);
+
+      // Results are returned at the lowest level of the inputs
+      size_t result_chain_index = std::numeric_limits<size_t>::max();
+      for (const auto& cipher : arg0_cipher->get_elements()) {
+        if (!cipher->known_value()) {
+          result_chain_index = std::min(
+              result_chain_index,
+              ngraph::he::get_chain_index(*cipher, m_he_seal_backend));
         }
+      }
 
-        // Send list of ciphertexts to maximize over to client
-        if (verbose) {
-          NGRAPH_INFO << "Sending " << cipher_cnt
-                      << " Maxpool ciphertexts to client";
+      // Windows are shared by the requests, which are sent as earlier ones
+      // are answered
+      auto windows = std::make_shared<const std::vector<std::vector<size_t>>>(
+          std::move(maximize_list));
+      for (size_t window_start = 0; window_start < windows->size();
+           window_start += windows_per_message) {
+        size_t window_end =
+            std::min(window_start + windows_per_message, windows->size());
+        for (size_t list_ind = window_start; list_ind < window_end;
+             ++list_ind) {
+          for (size_t max_ind : (*windows)[list_ind]) {
+            if (arg0_cipher->get_element(max_ind)->known_value()) {
+              // TODO: parallelize with 0s removed
+              NGRAPH_INFO << "Got max(known_value) at index " << max_ind;
+              throw ngraph_error("max(known_value) not allowed");
+            }
+          }
         }
-        auto max_message =
-            TCPMessage(MessageType::max_request, maxpool_ciphers);
-
-        m_session->do_write(std::move(max_message));
-
-        // Acquire lock
-        std::unique_lock<std::mutex> mlock(m_max_mutex);
 
-        // Wait until max is done
-        m_max_cond.wait(mlock, std::bind(&HESealExecutable::max_done, this));
+        client_op->send_request([this, arg0_cipher, out0_cipher, windows,
+                                 window_start, window_end, window_size,
+                                 result_chain_index,
+                                 verbose](const std::shared_ptr<ClientOp>& op) {
+          std::vector<seal::Ciphertext> maxpool_ciphers;
+          maxpool_ciphers.reserve((window_end - window_start) * window_size);
+          for (size_t list_ind = window_start; list_ind < window_end;
+               ++list_ind) {
+            const std::vector<size_t>& window = (*windows)[list_ind];
+            for (size_t window_idx = 0; window_idx < window_size;
+                 ++window_idx) {
+              size_t max_ind =
+                  window[window_idx < window.size() ? window_idx : 0];
+              maxpool_ciphers.emplace_back(
+                  arg0_cipher->get_element(max_ind)->ciphertext());
+            }
+          }
 
-        // Reset for next max call
-        m_max_done = false;
-        maxpool_ciphers.clear();
+          // Send windows of ciphertexts to maximize over to client
+          if (verbose) {
+            NGRAPH_INFO << "Sending " << window_end - window_start
+                        << " Maxpool windows of size " << window_size
+                        << " to client";
+          }
+          ClientRequest request;
+          request.result_type = MessageType::max_result;
+          request.client_op = op;
+          request.handle_result = [this, out0_cipher, window_start, window_end,
+                                   result_chain_index](
+                                      const TCPMessage& message) {
+            std::vector<seal::Ciphertext> ciphers;
+            message.load_ciphertexts(ciphers, m_context,
+                                     m_he_seal_backend.get_thread_pool());
+            NGRAPH_CHECK(ciphers.size() == window_end - window_start,
+                         "Expected ", window_end - window_start,
+                         " max results, got ", ciphers.size());
+            check_result_chain_index(ciphers, result_chain_index);
+
+            auto store_cipher = [&](size_t cipher_idx) {
+              out0_cipher->get_element(window_start + cipher_idx) =
+                  std::make_shared<ngraph::he::SealCiphertextWrapper>(
+                      ciphers[cipher_idx], m_complex_packing);
+            };
+            m_he_seal_backend.get_thread_pool().parallel_for(
+                0, ciphers.size(), store_cipher);
+          };
+          mod_switch_for_client(maxpool_ciphers);
+          TCPMessage message(MessageType::max_request, maxpool_ciphers,
+                             window_size, m_he_seal_backend.get_thread_pool());
+          message.set_result_chain_index(result_chain_index);
+          send_client_request(std::move(message), std::move(request));
+        });
       }
-      out0_cipher->set_elements(m_max_ciphertexts);
       break;
     }
     case OP_TYPEID::Minimum: {
@@ -1291,17 +2505,21 @@ void ngraph::he::HESealExecutable::generate_calls(
         lazy_rescaling(out0_cipher, verbose);
       } else if (arg0_cipher != nullptr && arg1_plain != nullptr &&
                  out0_cipher != nullptr) {
+        auto encoded_arg1 = encoded_constant(step.input_slots[1],
+                                             arg0_cipher->get_elements());
         ngraph::he::multiply_seal(
             arg0_cipher->get_elements(), arg1_plain->get_elements(),
             out0_cipher->get_elements(), type, m_he_seal_backend,
-            out0_cipher->get_batched_element_count());
+            out0_cipher->get_batched_element_count(), encoded_arg1.get());
         lazy_rescaling(out0_cipher, verbose);
       } else if (arg0_plain != nullptr && arg1_cipher != nullptr &&
                  out0_cipher != nullptr) {
+        auto encoded_arg0 = encoded_constant(step.input_slots[0],
+                                             arg1_cipher->get_elements());
         ngraph::he::multiply_seal(
             arg0_plain->get_elements(), arg1_cipher->get_elements(),
             out0_cipher->get_elements(), type, m_he_seal_backend,
-            out0_cipher->get_batched_element_count());
+            out0_cipher->get_batched_element_count(), encoded_arg0.get());
         lazy_rescaling(out0_cipher, verbose);
       } else if (arg0_plain != nullptr && arg1_plain != nullptr &&
                  out0_plain != nullptr) {
@@ -1397,7 +2615,8 @@ void ngraph::he::HESealExecutable::generate_calls(
         break;
       }
 
-      handle_server_relu_op(arg0_cipher, out0_cipher, node_wrapper);
+      handle_server_relu_op(arg0_cipher, out0_cipher, node_wrapper,
+                            client_op);
       break;
     }
     case OP_TYPEID::Reshape: {
@@ -1465,7 +2684,7 @@ void ngraph::he::HESealExecutable::generate_calls(
 
     case OP_TYPEID::Reverse: {
       const op::Reverse* reverse = static_cast<const op::Reverse*>(&node);
-      Shape in_shape = node.get_input_shape(0);
+      const Shape& in_shape = unpacked_arg_shapes[0];
 
       if (arg0_cipher != nullptr && out0_cipher != nullptr) {
         ngraph::he::reverse_seal(arg0_cipher->get_elements(),
@@ -1484,7 +2703,7 @@ void ngraph::he::HESealExecutable::generate_calls(
       break;
     case OP_TYPEID::Slice: {
       const op::Slice* slice = static_cast<const op::Slice*>(&node);
-      Shape& in_shape = packed_arg_shapes[0];
+      Shape in_shape = packed_arg_shapes[0];
       Coordinate lower_bounds = slice->get_lower_bounds();
       Coordinate upper_bounds = slice->get_upper_bounds();
 
@@ -1659,7 +2878,8 @@ void ngraph::he::HESealExecutable::generate_calls(
 void ngraph::he::HESealExecutable::handle_server_relu_op(
     std::shared_ptr<HESealCipherTensor>& arg_cipher,
     std::shared_ptr<HESealCipherTensor>& out_cipher,
-    const NodeWrapper& node_wrapper) {
+    const NodeWrapper& node_wrapper,
+    const std::shared_ptr<ClientOp>& client_op) {
   const Node& node = *node_wrapper.get_node();
   bool verbose = verbose_op(node);
   size_t element_count = shape_size(node.get_output_shape(0)) / m_batch_size;
@@ -1668,6 +2888,7 @@ void ngraph::he::HESealExecutable::handle_server_relu_op(
     NGRAPH_INFO << "Relu types not supported ";
     throw ngraph_error("Relu types not supported.");
   }
+  NGRAPH_CHECK(client_op != nullptr, "Relu requires a client op");
 
   size_t smallest_ind = ngraph::he::match_to_smallest_chain_index(
       arg_cipher->get_elements(), m_he_seal_backend);
@@ -1675,27 +2896,39 @@ void ngraph::he::HESealExecutable::handle_server_relu_op(
   if (verbose) {
     NGRAPH_INFO << "Matched moduli to chain ind " << smallest_ind;
   }
-  m_relu_ciphertexts.clear();
-  m_relu_ciphertexts.resize(element_count);
 
-  // TODO: tune
-  const size_t max_relu_message_cnt = 10000;
+  auto message_type = MessageType::none;
+  if (node_wrapper.get_typeid() == OP_TYPEID::BoundedRelu) {
+    message_type = MessageType::relu6_request;
+    const op::BoundedRelu* bounded_relu =
+        static_cast<const op::BoundedRelu*>(&node);
+    float alpha = bounded_relu->get_alpha();
+    NGRAPH_CHECK(alpha == 6.0f, "BoundedRelu supports only value 6.0f, got",
+                 alpha);
+  } else if (node_wrapper.get_typeid() == OP_TYPEID::Relu) {
+    message_type = MessageType::relu_request;
+  }
 
-  m_unknown_relu_idx.clear();
-  m_unknown_relu_idx.reserve(max_relu_message_cnt);
+  // Ciphertexts share their size once matched to the same level
+  size_t message_size = m_client_message_size;
+  for (const auto& cipher : arg_cipher->get_elements()) {
+    if (!cipher->known_value()) {
+      message_size = client_request_elements(cipher->ciphertext(), 1);
+      break;
+    }
+  }
 
-  size_t num_relu_batches = element_count / max_relu_message_cnt;
-  if (element_count % max_relu_message_cnt != 0) {
+  size_t num_relu_batches = element_count / message_size;
+  if (element_count % message_size != 0) {
     num_relu_batches++;
   }
-  std::vector<seal::Ciphertext> relu_ciphers;
-  relu_ciphers.reserve(max_relu_message_cnt);
   for (size_t relu_batch = 0; relu_batch < num_relu_batches; ++relu_batch) {
-    relu_ciphers.clear();
-    m_unknown_relu_idx.clear();
+    // Shared by the request and its result handler
+    auto unknown_relu_idx = std::make_shared<std::vector<size_t>>();
+    unknown_relu_idx->reserve(message_size);
 
-    size_t relu_start_idx = relu_batch * max_relu_message_cnt;
-    size_t relu_end_idx = (relu_batch + 1) * max_relu_message_cnt;
+    size_t relu_start_idx = relu_batch * message_size;
+    size_t relu_end_idx = (relu_batch + 1) * message_size;
     if (relu_end_idx > element_count) {
       relu_end_idx = element_count;
     }
@@ -1711,45 +2944,59 @@ void ngraph::he::HESealExecutable::handle_server_relu_op(
         auto known_cipher = std::make_shared<SealCiphertextWrapper>();
         known_cipher->known_value() = true;
         known_cipher->value() = relu_val;
-        m_relu_ciphertexts[relu_idx] = known_cipher;
+        out_cipher->get_element(relu_idx) = known_cipher;
       } else {
-        m_unknown_relu_idx.emplace_back(relu_idx);
-        relu_ciphers.emplace_back(cipher->ciphertext());
+        unknown_relu_idx->emplace_back(relu_idx);
       }
     }
     // All relu values known
-    if (relu_ciphers.size() == 0) {
+    if (unknown_relu_idx->empty()) {
       continue;
     }
 
-    auto message_type = MessageType::none;
-
-    if (node_wrapper.get_typeid() == OP_TYPEID::BoundedRelu) {
-      message_type = MessageType::relu6_request;
-      const op::BoundedRelu* bounded_relu =
-          static_cast<const op::BoundedRelu*>(&node);
-      float alpha = bounded_relu->get_alpha();
-      NGRAPH_CHECK(alpha == 6.0f, "BoundedRelu supports only value 6.0f, got",
-                   alpha);
-    } else if (node_wrapper.get_typeid() == OP_TYPEID::Relu) {
-      message_type = MessageType::relu_request;
-    }
-
-    if (verbose) {
-      NGRAPH_INFO << "Sending relu request size " << relu_ciphers.size();
-    }
-
-    auto relu_message = TCPMessage(message_type, relu_ciphers);
-    m_session->do_write(std::move(relu_message));
-
-    // Acquire lock
-    std::unique_lock<std::mutex> mlock(m_relu_mutex);
+    // Sent once fewer than max_client_requests_in_flight requests of the op
+    // await a result
+    client_op->send_request([this, arg_cipher, out_cipher, smallest_ind,
+                             message_type, verbose, unknown_relu_idx](
+                                const std::shared_ptr<ClientOp>& op) {
+      std::vector<seal::Ciphertext> relu_ciphers;
+      relu_ciphers.reserve(unknown_relu_idx->size());
+      for (size_t relu_idx : *unknown_relu_idx) {
+        relu_ciphers.emplace_back(
+            arg_cipher->get_element(relu_idx)->ciphertext());
+      }
 
-    // Wait until Relu is done
-    m_relu_cond.wait(mlock, std::bind(&HESealExecutable::relu_done, this));
+      if (verbose) {
+        NGRAPH_INFO << "Sending relu request size " << relu_ciphers.size();
+      }
 
-    // Reset for next Relu call
-    m_relu_done = false;
+      ClientRequest request;
+      request.result_type = MessageType::relu_result;
+      request.client_op = op;
+      request.handle_result = [this, out_cipher, smallest_ind,
+                               unknown_relu_idx](const TCPMessage& message) {
+        std::vector<seal::Ciphertext> ciphers;
+        message.load_ciphertexts(ciphers, m_context,
+                                 m_he_seal_backend.get_thread_pool());
+        NGRAPH_CHECK(ciphers.size() == unknown_relu_idx->size(), "Expected ",
+                     unknown_relu_idx->size(), " relu results, got ",
+                     ciphers.size());
+        check_result_chain_index(ciphers, smallest_ind);
+
+        auto store_cipher = [&](size_t cipher_idx) {
+          out_cipher->get_element((*unknown_relu_idx)[cipher_idx]) =
+              std::make_shared<ngraph::he::SealCiphertextWrapper>(
+                  ciphers[cipher_idx], m_complex_packing);
+        };
+        m_he_seal_backend.get_thread_pool().parallel_for(0, ciphers.size(),
+                                                         store_cipher);
+      };
+      mod_switch_for_client(relu_ciphers);
+      // Results are returned at the level of the inputs
+      TCPMessage message(message_type, relu_ciphers,
+                         m_he_seal_backend.get_thread_pool());
+      message.set_result_chain_index(smallest_ind);
+      send_client_request(std::move(message), std::move(request));
+    });
   }
-  out_cipher->set_elements(m_relu_ciphertexts);
 }
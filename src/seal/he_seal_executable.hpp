@@ -20,21 +20,34 @@
 #include <boost/asio.hpp>
 #include <chrono>
 #include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <limits>
 #include <memory>
 #include <mutex>
 #include <set>
+#include <string>
 #include <thread>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "he_tensor.hpp"
+#include "ngraph/op/convolution.hpp"
 #include "ngraph/runtime/backend.hpp"
 #include "ngraph/util.hpp"
 #include "node_wrapper.hpp"
+#include "pass/he_liveness.hpp"
+#include "seal/encoded_constant.hpp"
 #include "seal/he_seal_backend.hpp"
 #include "seal/seal.h"
 #include "seal/seal_ciphertext_wrapper.hpp"
+#include "tcp/loopback_channel.hpp"
+#include "tcp/message_channel.hpp"
 #include "tcp/tcp_message.hpp"
 #include "tcp/tcp_session.hpp"
+#include "tcp/transport.hpp"
 
 using boost::asio::ip::tcp;
 
@@ -42,6 +55,15 @@ namespace ngraph {
 namespace he {
 class HESealExecutable : public runtime::Executable {
  public:
+  /// @brief Requests of a client op awaiting a result at once, so the client
+  /// processes one while others are in transit. Bounds the memory held by
+  /// queued requests
+  static constexpr size_t max_client_requests_in_flight = 4;
+
+  /// @brief Elements of a Relu or MaxPool request, unless set by
+  /// NGRAPH_HE_CLIENT_MESSAGE_SIZE. A MaxPool element is a window
+  static constexpr size_t default_client_message_size = 10000;
+
   HESealExecutable(const std::shared_ptr<Function>& function,
                    bool enable_performance_collection,
                    ngraph::he::HESealBackend& he_seal_backend,
@@ -49,21 +71,29 @@ class HESealExecutable : public runtime::Executable {
                    bool complex_packing, bool enable_client);
 
   ~HESealExecutable() override {
-    if (m_enable_client) {
+    if (m_enable_client && m_acceptor != nullptr) {
       // Wait until thread finishes with m_io_context
       m_thread.join();
 
       // m_acceptor and m_io_context both free the socket? so avoid double-free
       m_acceptor->close();
       m_acceptor = nullptr;
-      m_session = nullptr;
     }
+    // Waits until the message handler, which uses this executable, returns
+    if (m_session != nullptr) {
+      m_session->close();
+    }
+    m_session = nullptr;
   }
 
   void client_setup();
 
   void start_server();
 
+  /// @brief Connects the server end of the in-process channel whose client
+  /// end is m_loopback_client
+  void connect_loopback_client();
+
   bool call(
       const std::vector<std::shared_ptr<runtime::Tensor>>& outputs,
       const std::vector<std::shared_ptr<runtime::Tensor>>& inputs) override;
@@ -73,24 +103,69 @@ class HESealExecutable : public runtime::Executable {
 
   size_t get_port() const { return m_port; }
 
-  // TODO: merge _done() methods
-  bool relu_done() const { return m_relu_done; }
-  bool max_done() const { return m_max_done; }
   bool minimum_done() const { return m_minimum_done; }
 
   bool session_started() const { return m_session_started; }
 
   bool client_inputs_received() const { return m_client_inputs_received; }
 
+  /// @brief Returns the largest number of steps in progress at once during the
+  /// last call, including steps awaiting client results
+  size_t max_concurrent_steps() const { return m_max_concurrent_steps; }
+
   void accept_connection();
 
   void check_client_supports_function();
 
-  void handle_message(const TCPMessage& message);
+  void handle_message(TCPMessage&& message);
+
+  /// \brief Client round trips issued by a single execution step. At most
+  /// max_outstanding requests await a result at once; further requests are
+  /// queued and sent as results arrive, so no thread waits for the client.
+  /// Calls the completion callback once all requests have been sent and
+  /// answered
+  class ClientOp : public std::enable_shared_from_this<ClientOp> {
+   public:
+    using Callback = std::function<void(std::exception_ptr)>;
+    /// Sends one request of the op, with send_client_request()
+    using SendFunction = std::function<void(const std::shared_ptr<ClientOp>&)>;
+
+    ClientOp(Callback on_complete, size_t max_outstanding)
+        : m_max_outstanding(max_outstanding),
+          m_on_complete(std::move(on_complete)) {}
+
+    /// @brief Calls send now if fewer than max_outstanding requests await a
+    /// result, else once a result arrives. Exceptions thrown by send are
+    /// reported to the completion callback
+    void send_request(SendFunction send);
+
+    /// @brief Marks a request as answered, and sends the next queued request
+    /// @param error Exception raised while handling the result, if any
+    void finish_request(std::exception_ptr error);
+
+    /// @brief Marks that no further requests will be added
+    /// @param error Exception raised while sending requests, if any
+    void finish_sending(std::exception_ptr error);
+
+   private:
+    // Calls send for a request already counted as outstanding
+    void run_send(const SendFunction& send);
+
+    void complete_if_done(std::unique_lock<std::mutex>& lock);
+
+    std::mutex m_mutex;
+    size_t m_outstanding_requests{0};
+    size_t m_max_outstanding;
+    std::deque<SendFunction> m_pending_sends;
+    bool m_sending{true};
+    std::exception_ptr m_error{nullptr};
+    Callback m_on_complete;
+  };
 
   void handle_server_relu_op(std::shared_ptr<HESealCipherTensor>& arg0_cipher,
                              std::shared_ptr<HESealCipherTensor>& out_cipher,
-                             const NodeWrapper& node_wrapper);
+                             const NodeWrapper& node_wrapper,
+                             const std::shared_ptr<ClientOp>& client_op);
 
   bool verbose_op(const ngraph::Node& op) {
     return m_verbose_all_ops ||
@@ -109,7 +184,94 @@ class HESealExecutable : public runtime::Executable {
     client_setup();
   }
 
+  /// @brief Enables the client, connected through an in-process channel
+  /// instead of a socket. Used to measure the protocol without network cost
+  /// @return Client end of the channel, to construct HESealClient with
+  std::shared_ptr<LoopbackChannel> enable_loopback_client() {
+    NGRAPH_CHECK(!m_client_setup, "Client already setup");
+    m_enable_client = true;
+    m_loopback = true;
+    client_setup();
+    return m_loopback_client;
+  }
+
+  /// @brief Saves the encrypted model constants to path. With
+  /// NGRAPH_ENCRYPT_MODEL, constants are encrypted by the first call
+  void save_encrypted_constants(const std::string& path) const;
+
+  /// @brief Loads encrypted model constants saved by
+  /// save_encrypted_constants(), so calls do not encrypt the model
+  /// @return false if path cannot be read, or was saved for another function
+  /// or public key
+  bool load_encrypted_constants(const std::string& path);
+
  private:
+  /// \brief Whether a tensor slot holds plaintexts or ciphertexts
+  enum class TensorKind { plain, cipher };
+
+  // Level of a slot or step which is not planned
+  static constexpr size_t unplanned_level = std::numeric_limits<size_t>::max();
+
+  /// \brief Compile-time description of a tensor used during execution
+  struct TensorSlot {
+    std::string name;
+    Shape shape;
+    element::Type element_type;
+    TensorKind kind{TensorKind::plain};
+    bool packed{false};
+    // Number of step inputs reading this slot
+    size_t use_count{0};
+    // Result tensors are owned by the caller and never released
+    bool persistent{false};
+    // Chain index of the slot's ciphertexts, planned by plan_levels()
+    size_t level{unplanned_level};
+  };
+
+  /// \brief A single op of the compiled function. Tensor slots, packed /
+  /// unpacked shapes and dependencies are resolved once at compile time, so
+  /// call() does not need to look up tensors or recompute shapes
+  struct ExecutionStep {
+    explicit ExecutionStep(const NodeWrapper& wrapper)
+        : node_wrapper(wrapper) {}
+
+    NodeWrapper node_wrapper;
+    std::vector<size_t> input_slots;
+    std::vector<size_t> output_slots;
+    // Steps consuming an output of this step
+    std::vector<size_t> dependents;
+    // Number of distinct steps producing an input of this step
+    size_t dependency_count{0};
+    // Relative amount of work, used to split threads between steps which
+    // execute concurrently
+    double estimated_cost{0};
+    std::vector<Shape> unpacked_arg_shapes;
+    std::vector<Shape> packed_arg_shapes;
+    Shape out_shape;
+    Shape packed_out_shape;
+    element::Type base_type;
+    bool verbose{false};
+    // Whether the op is evaluated by the client when its input is encrypted
+    bool client_op{false};
+    // Whether the step is a convolution of the client input, which starts
+    // while the input is still arriving
+    bool streams_input{false};
+    // Chain index all cipher inputs are at when the op runs, and the inputs
+    // which are above it and switched down to it before the op. Planned by
+    // plan_levels()
+    size_t input_level{unplanned_level};
+    std::vector<size_t> switched_args;
+    // Whether the cipher output is rescaled to the next level after the op
+    bool rescale_output{false};
+  };
+
+  /// \brief A request sent to the client which awaits its result
+  struct ClientRequest {
+    MessageType result_type{MessageType::none};
+    // Stores the result into the output tensor of the requesting step
+    std::function<void(const TCPMessage&)> handle_result;
+    std::shared_ptr<ClientOp> client_op;
+  };
+
   HESealBackend& m_he_seal_backend;
   bool m_encrypt_data;
   bool m_encrypt_model;
@@ -120,28 +282,58 @@ class HESealExecutable : public runtime::Executable {
 
   bool m_enable_client;
   bool m_client_setup;
+  bool m_loopback{false};  // Whether the client is connected in-process
   size_t m_batch_size;
   size_t m_port;  // Which port the server is hosted at
-
-  std::unordered_map<std::shared_ptr<const Node>, stopwatch> m_timer_map;
-  std::vector<NodeWrapper> m_wrapped_nodes;
-
-  std::unique_ptr<tcp::acceptor> m_acceptor;
+  // Ciphertexts per Relu or MaxPool request to the client
+  size_t m_client_message_size{default_client_message_size};
+
+  std::vector<ExecutionStep> m_execution_plan;
+  std::vector<stopwatch> m_step_timers;
+  size_t m_max_concurrent_steps{0};
+  std::vector<TensorSlot> m_tensor_slots;
+  std::vector<size_t> m_parameter_slots;
+  std::vector<size_t> m_result_slots;
+  // (kind, packed) of each parameter followed by each result, for which
+  // m_tensor_slots kinds were last resolved
+  std::vector<std::pair<TensorKind, bool>> m_plan_signature;
+  // Plaintext constants, materialized once and indexed by slot
+  std::unordered_map<size_t, std::shared_ptr<EncodedConstant>> m_constants;
+  // Encrypted constants, indexed by slot. Encrypted by the first call, then
+  // kept at the level they were encrypted or loaded at. nullptr until
+  // encrypted
+  std::unordered_map<size_t, std::shared_ptr<HESealCipherTensor>>
+      m_encrypted_constants;
+  // Public key the encrypted constants are encrypted under
+  std::shared_ptr<seal::PublicKey> m_encrypted_constants_key;
+  // parms_id at each chain index of m_context
+  std::vector<seal::parms_id_type> m_chain_parms_ids;
+  // Chain index of the cipher parameters and encrypted constants, by slot,
+  // which the levels were last planned for (see source_levels())
+  std::unordered_map<size_t, size_t> m_planned_source_levels;
+
+  std::unique_ptr<stream_acceptor> m_acceptor;
 
   // Must be shared, since TCPSession uses enable_shared_from_this()
-  std::shared_ptr<TCPSession> m_session;
+  std::shared_ptr<MessageChannel> m_session;
+  // Client end of the in-process channel, if the client is not connected
+  // through a socket
+  std::shared_ptr<LoopbackChannel> m_loopback_client;
   std::thread m_thread;
   boost::asio::io_context m_io_context;
 
   // (Encrypted) inputs to compiled function
   std::vector<std::shared_ptr<ngraph::he::HETensor>> m_client_inputs;
+  // Client input ciphertexts loaded from the execute frames received so far
+  std::vector<std::shared_ptr<ngraph::he::SealCiphertextWrapper>>
+      m_client_input_ciphers;
+  size_t m_client_input_count{0};
+  // Packed shape of the client input if it is streamed in spatial order (see
+  // spatial_stream_index()), otherwise empty
+  Shape m_stream_input_shape;
   // (Encrypted) outputs of compiled function
   std::vector<std::shared_ptr<ngraph::he::HETensor>> m_client_outputs;
 
-  std::vector<std::shared_ptr<ngraph::he::SealCiphertextWrapper>>
-      m_relu_ciphertexts;
-  std::vector<std::shared_ptr<ngraph::he::SealCiphertextWrapper>>
-      m_max_ciphertexts;
   std::vector<std::shared_ptr<ngraph::he::SealCiphertextWrapper>>
       m_minimum_ciphertexts;
 
@@ -149,26 +341,23 @@ class HESealExecutable : public runtime::Executable {
 
   std::shared_ptr<seal::SEALContext> m_context;
 
-  // To trigger when relu is done
-  std::mutex m_relu_mutex;
-  std::condition_variable m_relu_cond;
-  bool m_relu_done;
-  std::vector<size_t> m_unknown_relu_idx;
+  // Key id of a client whose keys are cached across connections, if any
+  std::string m_client_key_id;
+  std::shared_ptr<seal::PublicKey> m_client_public_key;
+  // Bytes of the key being received, which is sent as a sequence of frames
+  std::string m_client_key_data;
 
-  // To trigger when maxpool is done
-  std::mutex m_max_mutex;
-  std::condition_variable m_max_cond;
-  bool m_max_done;
+  // Requests awaiting a result, by request id. Results may arrive in any
+  // order
+  std::mutex m_client_request_mutex;
+  std::unordered_map<uint64_t, ClientRequest> m_client_requests;
+  uint64_t m_next_request_id{1};
 
   // To trigger when minimum is done
   std::mutex m_minimum_mutex;
   std::condition_variable m_minimum_cond;
   bool m_minimum_done;
 
-  // To trigger when result message has been written
-  std::mutex m_result_mutex;
-  std::condition_variable m_result_cond;
-
   // To trigger when session has started
   std::mutex m_session_mutex;
   std::condition_variable m_session_cond;
@@ -179,9 +368,149 @@ class HESealExecutable : public runtime::Executable {
   std::condition_variable m_client_inputs_cond;
   bool m_client_inputs_received;
 
-  void generate_calls(const element::Type& type, const NodeWrapper& op,
+  /// @brief Builds m_execution_plan and m_tensor_slots from the compiled
+  /// function
+  /// @param liveness HELiveness pass which has been run on function
+  void build_execution_plan(const std::shared_ptr<Function>& function,
+                            const pass::HELiveness& liveness);
+
+  /// @brief Returns the relative amount of work performed by a step
+  double estimate_cost(const ExecutionStep& step) const;
+
+  /// @brief Computes the plaintext constants of the execution plan into
+  /// m_constants, so calls do not recompute or re-encode them
+  void materialize_constants();
+
+  /// @brief Drops the encrypted constants if the public key changed since
+  /// they were encrypted, and loads missing ones from the file at
+  /// NGRAPH_HE_ENCRYPTED_MODEL, if set
+  /// @return Whether every encrypted constant is available
+  bool prepare_encrypted_constants();
+
+  /// @brief Returns the encodings of the plaintext constant in slot_idx at
+  /// the level and scale of ciphers, or nullptr if the slot does not hold a
+  /// materialized constant
+  std::shared_ptr<const EncodedScalars> encoded_constant(
+      size_t slot_idx,
+      const std::vector<std::shared_ptr<SealCiphertextWrapper>>& ciphers);
+
+  /// @brief Runs the execution plan, executing steps whose inputs are ready
+  /// concurrently
+  /// @param tensor_slots Tensors of the call, indexed by slot. Parameter and
+  /// result slots must be set
+  void run_execution_plan(
+      std::vector<std::shared_ptr<HETensor>>& tensor_slots);
+
+  /// @brief Executes a single step of the execution plan
+  /// @param client_op Tracks requests sent to the client by the step. Must be
+  /// set iff is_client_step(step)
+  void run_step(size_t step_idx,
+                std::vector<std::shared_ptr<HETensor>>& tensor_slots,
+                const std::shared_ptr<ClientOp>& client_op);
+
+  /// @brief Returns whether the step sends requests to the client, in which
+  /// case it completes once all results have been received
+  bool is_client_step(const ExecutionStep& step) const;
+
+  /// @brief Sends a request to the client without waiting for the result
+  /// @param message Request message, which is assigned a new request id
+  /// @param request Handles the result once it arrives
+  void send_client_request(TCPMessage&& message, ClientRequest request);
+
+  /// @brief Sends the number of client input elements to the client, which
+  /// then sends its encrypted inputs
+  void send_parameter_size();
+
+  /// @brief Appends a frame of a public key or eval key message to
+  /// m_client_key_data
+  /// @return Whether the key is complete
+  bool add_client_key_frame(const TCPMessage& message);
+
+  /// @brief Passes a result message to the request with the same id, which
+  /// handles it on the thread pool
+  void handle_client_result(TCPMessage&& message);
+
+  /// @brief Enables streaming of the client input if NGRAPH_HE_STREAM_INPUT
+  /// is set and the only use of the input is a convolution
+  void plan_input_streaming();
+
+  /// @brief Creates m_client_inputs from m_client_input_ciphers and signals
+  /// that the client inputs have been received
+  void set_client_inputs();
+
+  /// @brief Blocks until at least rows rows of the streamed client input
+  /// have been received
+  /// @return Number of rows received
+  size_t wait_for_client_input_rows(size_t rows);
+
+  /// @brief Convolves the input rows of one band with the filter. Takes the
+  /// band input and its shape, the band output and its shape, and the padding
+  /// below and above the band
+  using BandConvolution = std::function<void(
+      const std::vector<std::shared_ptr<SealCiphertextWrapper>>&, const Shape&,
+      std::vector<std::shared_ptr<SealCiphertextWrapper>>&, const Shape&,
+      const CoordinateDiff&, const CoordinateDiff&)>;
+
+  /// @brief Computes the convolution of a streamed client input, one band of
+  /// output rows at a time. Each band starts once the input rows in its
+  /// receptive field have been received
+  void streaming_convolution(
+      const op::Convolution& conv,
+      const std::vector<std::shared_ptr<SealCiphertextWrapper>>& arg0,
+      std::vector<std::shared_ptr<SealCiphertextWrapper>>& out,
+      const Shape& arg0_shape, const Shape& arg1_shape, const Shape& out_shape,
+      const BandConvolution& convolve_band, bool verbose);
+
+  /// @brief Mod-switches ciphertexts sent to the client, which only decrypts
+  /// them, to the lowest common level which keeps their values representable
+  void mod_switch_for_client(std::vector<seal::Ciphertext>& ciphers);
+
+  /// @brief Returns the number of elements of ciphers_per_element ciphertexts
+  /// each per Relu or MaxPool request. Requests hold at most
+  /// m_client_message_size ciphertexts and fit in a message frame, but hold at
+  /// least one element
+  /// @param cipher Ciphertext of the request, whose size all share
+  size_t client_request_elements(const seal::Ciphertext& cipher,
+                                 size_t ciphers_per_element) const;
+
+  /// @brief Checks that the client encrypted the ciphertexts of a result at
+  /// the chain index sent with its request
+  void check_result_chain_index(const std::vector<seal::Ciphertext>& ciphers,
+                                size_t chain_index) const;
+
+  /// @brief Propagates plain / cipher kind and packing through the tensor
+  /// slots, given the kind and packing of the parameters and results
+  /// @param signature (kind, packed) of each parameter followed by each result
+  void resolve_tensor_kinds(
+      const std::vector<std::pair<TensorKind, bool>>& signature);
+
+  /// @brief Plans the chain index of every cipher slot, where steps rescale
+  /// their outputs, and where they switch inputs down to the level of their
+  /// other inputs. Kernels then find their operands at matching levels, so
+  /// levels are not looked up and matched per element at runtime
+  /// @param source_levels Chain index of cipher parameters and encrypted
+  /// constants by slot. Those not listed are at the first chain index
+  void plan_levels(const std::unordered_map<size_t, size_t>& source_levels);
+
+  /// @brief Returns the chain index of the cipher parameters and encrypted
+  /// constants of a call which are below the first chain index, by slot
+  std::unordered_map<size_t, size_t> source_levels(
+      const std::vector<std::shared_ptr<HETensor>>& tensor_slots) const;
+
+  /// @brief Replaces the switched inputs of step in op_inputs by copies at
+  /// the step's input level. Inputs are not switched in place, since their
+  /// ciphertexts may be shared with other tensors which are read concurrently
+  void switch_input_levels(
+      const ExecutionStep& step,
+      std::vector<std::shared_ptr<HETensor>>& op_inputs) const;
+
+  /// @brief Rescales the ciphertexts of cipher_tensor to the next level
+  void rescale_to_next(HESealCipherTensor& cipher_tensor, bool verbose) const;
+
+  void generate_calls(const ExecutionStep& step,
                       const std::vector<std::shared_ptr<HETensor>>& outputs,
-                      const std::vector<std::shared_ptr<HETensor>>& inputs);
+                      const std::vector<std::shared_ptr<HETensor>>& inputs,
+                      const std::shared_ptr<ClientOp>& client_op);
 };
 }  // namespace he
 }  // namespace ngraph
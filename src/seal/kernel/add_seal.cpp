@@ -56,6 +56,7 @@ void ngraph::he::scalar_add_seal(
 
 void ngraph::he::scalar_add_seal(
     ngraph::he::SealCiphertextWrapper& arg0, const HEPlaintext& arg1,
+    const std::uint64_t* encoded_arg1,
     std::shared_ptr<ngraph::he::SealCiphertextWrapper>& out,
     const element::Type& element_type, const HESealBackend& he_seal_backend,
     const seal::MemoryPoolHandle& pool) {
@@ -82,10 +83,15 @@ void ngraph::he::scalar_add_seal(
     bool complex_packing = arg0.complex_packing();
     // TODO: optimize for adding single complex number
     if (arg1.is_single_value() && !complex_packing) {
-      float value = arg1.values()[0];
-      double double_val = double(value);
-      add_plain(arg0.ciphertext(), double_val, out->ciphertext(),
-                he_seal_backend);
+      if (encoded_arg1 != nullptr) {
+        out->ciphertext() = arg0.ciphertext();
+        add_plain_inplace(out->ciphertext(), encoded_arg1, he_seal_backend);
+      } else {
+        float value = arg1.values()[0];
+        double double_val = double(value);
+        add_plain(arg0.ciphertext(), double_val, out->ciphertext(),
+                  he_seal_backend);
+      }
     } else {
       auto p = SealPlaintextWrapper(complex_packing);
       he_seal_backend.encode(p, arg1, arg0.ciphertext().parms_id(),
@@ -16,10 +16,12 @@
 
 #pragma once
 
+#include <cstdint>
 #include <memory>
 #include <vector>
 
 #include "ngraph/type/element_type.hpp"
+#include "seal/encoded_constant.hpp"
 #include "seal/he_seal_backend.hpp"
 #include "seal/kernel/negate_seal.hpp"
 #include "seal/seal.h"
@@ -34,12 +36,26 @@ void scalar_add_seal(
     const element::Type& element_type, const HESealBackend& he_seal_backend,
     const seal::MemoryPoolHandle& pool = seal::MemoryManager::GetPool());
 
+/// @brief Adds arg1 to arg0
+/// @param encoded_arg1 If not nullptr, the encoding of the single value of
+/// arg1 at the parms_id and scale of arg0 (see EncodedScalars), which is used
+/// instead of encoding arg1
 void scalar_add_seal(
     SealCiphertextWrapper& arg0, const HEPlaintext& arg1,
+    const std::uint64_t* encoded_arg1,
     std::shared_ptr<SealCiphertextWrapper>& out,
     const element::Type& element_type, const HESealBackend& he_seal_backend,
     const seal::MemoryPoolHandle& pool = seal::MemoryManager::GetPool());
 
+inline void scalar_add_seal(
+    SealCiphertextWrapper& arg0, const HEPlaintext& arg1,
+    std::shared_ptr<SealCiphertextWrapper>& out,
+    const element::Type& element_type, const HESealBackend& he_seal_backend,
+    const seal::MemoryPoolHandle& pool = seal::MemoryManager::GetPool()) {
+  scalar_add_seal(arg0, arg1, nullptr, out, element_type, he_seal_backend,
+                  pool);
+}
+
 inline void scalar_add_seal(
     const HEPlaintext& arg0, SealCiphertextWrapper& arg1,
     std::shared_ptr<SealCiphertextWrapper>& out,
@@ -59,10 +75,9 @@ inline void add_seal(
     const element::Type& element_type, const HESealBackend& he_seal_backend,
     size_t count,
     const seal::MemoryPoolHandle& pool = seal::MemoryManager::GetPool()) {
-#pragma omp parallel for
-  for (size_t i = 0; i < count; ++i) {
+  he_seal_backend.get_thread_pool().parallel_for(0, count, [&](size_t i) {
     scalar_add_seal(*arg0[i], *arg1[i], out[i], element_type, he_seal_backend);
-  }
+  });
 }
 
 inline void add_seal(
@@ -70,13 +85,13 @@ inline void add_seal(
     const std::vector<HEPlaintext>& arg1,
     std::vector<std::shared_ptr<SealCiphertextWrapper>>& out,
     const element::Type& element_type, const HESealBackend& he_seal_backend,
-    size_t count,
+    size_t count, const EncodedScalars* encoded_arg1 = nullptr,
     const seal::MemoryPoolHandle& pool = seal::MemoryManager::GetPool()) {
-#pragma omp parallel for
-  for (size_t i = 0; i < count; ++i) {
-    scalar_add_seal(*arg0[i], arg1[i], out[i], element_type, he_seal_backend,
-                    pool);
-  }
+  he_seal_backend.get_thread_pool().parallel_for(0, count, [&](size_t i) {
+    scalar_add_seal(*arg0[i], arg1[i],
+                    find_encoded_value(encoded_arg1, i, *arg0[i]), out[i],
+                    element_type, he_seal_backend, pool);
+  });
 }
 
 inline void add_seal(
@@ -84,9 +99,10 @@ inline void add_seal(
     std::vector<std::shared_ptr<SealCiphertextWrapper>>& arg1,
     std::vector<std::shared_ptr<SealCiphertextWrapper>>& out,
     const element::Type& element_type, const HESealBackend& he_seal_backend,
-    size_t count,
+    size_t count, const EncodedScalars* encoded_arg0 = nullptr,
     const seal::MemoryPoolHandle& pool = seal::MemoryManager::GetPool()) {
-  add_seal(arg1, arg0, out, element_type, he_seal_backend, count, pool);
+  add_seal(arg1, arg0, out, element_type, he_seal_backend, count, encoded_arg0,
+           pool);
 }
 
 inline void add_seal(std::vector<HEPlaintext>& arg0,
@@ -94,10 +110,9 @@ inline void add_seal(std::vector<HEPlaintext>& arg0,
                      std::vector<HEPlaintext>& out,
                      const element::Type& element_type,
                      const HESealBackend& he_seal_backend, size_t count) {
-#pragma omp parallel for
-  for (size_t i = 0; i < count; ++i) {
+  he_seal_backend.get_thread_pool().parallel_for(0, count, [&](size_t i) {
     scalar_add_seal(arg0[i], arg1[i], out[i], element_type, he_seal_backend);
-  }
+  });
 }
 }  // namespace he
 }  // namespace ngraph
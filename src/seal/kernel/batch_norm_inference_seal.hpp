@@ -47,38 +47,33 @@ void batch_norm_inference_seal(
   }
   size_t input_transform_size = input_coords.size();
 
-#pragma omp parallel for
-  for (size_t i = 0; i < input_transform_size; ++i) {
-    Coordinate input_coord = input_coords[i];
-    // for (Coordinate input_coord : input_transform) {
-    auto channel_num = input_coord[1];
-    auto channel_gamma = gamma[channel_num];
-    auto channel_beta = beta[channel_num];
-    auto channel_mean = mean[channel_num];
-    auto channel_var = variance[channel_num];
-
-    auto input_index = input_transform.index(input_coord);
-
-    std::vector<float> channel_gamma_vals = channel_gamma.values();
-    std::vector<float> channel_beta_vals = channel_beta.values();
-    std::vector<float> channel_mean_vals = channel_mean.values();
-    std::vector<float> channel_var_vals = channel_var.values();
-
-    NGRAPH_CHECK(channel_gamma_vals.size() == 1);
-    NGRAPH_CHECK(channel_beta_vals.size() == 1);
-    NGRAPH_CHECK(channel_mean_vals.size() == 1);
-    NGRAPH_CHECK(channel_var_vals.size() == 1);
+  // The scale and bias of each channel are computed once, not per element
+  size_t channels = input_shape.at(1);
+  std::vector<HEPlaintext> plain_scales;
+  std::vector<HEPlaintext> plain_biases;
+  for (size_t channel_num = 0; channel_num < channels; ++channel_num) {
+    NGRAPH_CHECK(gamma[channel_num].is_single_value());
+    NGRAPH_CHECK(beta[channel_num].is_single_value());
+    NGRAPH_CHECK(mean[channel_num].is_single_value());
+    NGRAPH_CHECK(variance[channel_num].is_single_value());
+    float channel_gamma = gamma[channel_num].values()[0];
+    float channel_beta = beta[channel_num].values()[0];
+    float channel_mean = mean[channel_num].values()[0];
+    float channel_var = variance[channel_num].values()[0];
 
-    float scale = channel_gamma_vals[0] / std::sqrt(channel_var_vals[0] + eps);
-    float bias =
-        channel_beta_vals[0] - (channel_gamma_vals[0] * channel_mean_vals[0]) /
-                                   std::sqrt(channel_var_vals[0] + eps);
-
-    std::vector<float> scale_vec(batch_size, scale);
-    std::vector<float> bias_vec(batch_size, bias);
+    float scale = channel_gamma / std::sqrt(channel_var + eps);
+    float bias = channel_beta -
+                 (channel_gamma * channel_mean) / std::sqrt(channel_var + eps);
+    plain_scales.emplace_back(std::vector<float>(batch_size, scale));
+    plain_biases.emplace_back(std::vector<float>(batch_size, bias));
+  }
 
-    auto plain_scale = HEPlaintext(scale_vec);
-    auto plain_bias = HEPlaintext(bias_vec);
+  auto normalize = [&](size_t i) {
+    const Coordinate& input_coord = input_coords[i];
+    auto channel_num = input_coord[1];
+    auto input_index = input_transform.index(input_coord);
+    const HEPlaintext& plain_scale = plain_scales[channel_num];
+    const HEPlaintext& plain_bias = plain_biases[channel_num];
 
     auto output = he_seal_backend.create_empty_ciphertext();
 
@@ -88,7 +83,9 @@ void batch_norm_inference_seal(
     ngraph::he::scalar_add_seal(*output, plain_bias, output, element::f32,
                                 he_seal_backend);
     normed_input[input_index] = output;
-  }
+  };
+  he_seal_backend.get_thread_pool().parallel_for(0, input_transform_size,
+                                                 normalize);
 };
 }  // namespace he
 }  // namespace ngraph
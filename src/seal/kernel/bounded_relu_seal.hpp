@@ -74,10 +74,9 @@ inline void bounded_relu_seal(
     const std::vector<std::shared_ptr<SealCiphertextWrapper>>& arg,
     std::vector<std::shared_ptr<SealCiphertextWrapper>>& out, size_t count,
     float alpha, const HESealBackend& he_seal_backend) {
-#pragma omp parallel for
-  for (size_t i = 0; i < count; ++i) {
+  he_seal_backend.get_thread_pool().parallel_for(0, count, [&](size_t i) {
     scalar_bounded_relu_seal(*arg[i], out[i], alpha, he_seal_backend);
-  }
+  });
 }
 
 }  // namespace he
@@ -29,12 +29,11 @@ void ngraph::he::constant_seal(std::vector<ngraph::he::HEPlaintext>& out,
     throw ngraph_error("out.size() != count for constant op");
   }
 
-#pragma omp parallel for
-  for (size_t i = 0; i < count; ++i) {
+  he_seal_backend.get_thread_pool().parallel_for(0, count, [&](size_t i) {
     const void* src_with_offset = (void*)((char*)data_ptr + i * type_byte_size);
     float f = *(float*)src_with_offset;
     out[i].values() = {f};
-  }
+  });
 }
 
 void ngraph::he::constant_seal(
@@ -47,13 +46,12 @@ void ngraph::he::constant_seal(
     throw ngraph_error("out.size() != count for constant op");
   }
 
-#pragma omp parallel for
-  for (size_t i = 0; i < count; ++i) {
+  he_seal_backend.get_thread_pool().parallel_for(0, count, [&](size_t i) {
     const void* src_with_offset = (void*)((char*)data_ptr + i * type_byte_size);
 
     std::vector<float> values{*(float*)src_with_offset};
     auto plaintext = HEPlaintext(values);
     he_seal_backend.encrypt(out[i], plaintext,
                             he_seal_backend.complex_packing());
-  }
+  });
 }
@@ -21,6 +21,7 @@
 
 #include "ngraph/coordinate_transform.hpp"
 #include "ngraph/type/element_type.hpp"
+#include "seal/encoded_constant.hpp"
 #include "seal/he_seal_backend.hpp"
 #include "seal/kernel/add_seal.hpp"
 #include "seal/kernel/multiply_seal.hpp"
@@ -63,12 +64,9 @@ inline void convolution_seal(
     NGRAPH_INFO << "Convolution output size " << out_transform_size;
   }
 
-// TODO: don't create new thread for every loop index, only one per thread
-#pragma omp parallel for
-  for (size_t out_coord_idx = 0; out_coord_idx < out_transform_size;
-       ++out_coord_idx) {
-    // Init thread-local memory pool for each thread
-    seal::MemoryPoolHandle pool = seal::MemoryPoolHandle::ThreadLocal();
+  auto compute_output = [&](size_t out_coord_idx) {
+    // Memory pool owned by the worker thread
+    seal::MemoryPoolHandle pool = ngraph::he::ThreadPool::memory_pool();
 
     const Coordinate& out_coord = out_coords[out_coord_idx];
 
@@ -234,7 +232,9 @@ inline void convolution_seal(
     if (verbose && out_coord_idx % 1000 == 0 && out_coord_idx != 0) {
       NGRAPH_INFO << "Finished out coord " << out_coord_idx;
     }
-  }
+  };
+  he_seal_backend.get_thread_pool().parallel_for(0, out_transform_size,
+                                                 compute_output);
 }
 
 inline void convolution_seal(
@@ -249,7 +249,8 @@ inline void convolution_seal(
     size_t input_channel_axis_filters, size_t output_channel_axis_filters,
     size_t batch_axis_result, size_t output_channel_axis_result,
     bool rotate_filter, const element::Type& element_type, size_t batch_size,
-    const ngraph::he::HESealBackend& he_seal_backend, bool verbose = true) {
+    const ngraph::he::HESealBackend& he_seal_backend, bool verbose = true,
+    const EncodedScalars* encoded_arg1 = nullptr) {
   CoordinateTransform output_transform(out_shape);
 
   // Store output coordinates for parallelization
@@ -262,12 +263,9 @@ inline void convolution_seal(
     NGRAPH_INFO << "Convolution output size " << out_transform_size;
   }
 
-// TODO: don't create new thread for every loop index, only one per thread
-#pragma omp parallel for
-  for (size_t out_coord_idx = 0; out_coord_idx < out_transform_size;
-       ++out_coord_idx) {
-    // Init thread-local memory pool for each thread
-    seal::MemoryPoolHandle pool = seal::MemoryPoolHandle::ThreadLocal();
+  auto compute_output = [&](size_t out_coord_idx) {
+    // Memory pool owned by the worker thread
+    seal::MemoryPoolHandle pool = ngraph::he::ThreadPool::memory_pool();
 
     const Coordinate& out_coord = out_coords[out_coord_idx];
 
@@ -357,11 +355,14 @@ inline void convolution_seal(
 
       if (input_batch_transform.has_source_coordinate(input_batch_coord)) {
         auto mult_arg0 = arg0[input_batch_transform.index(input_batch_coord)];
-        auto mult_arg1 = arg1[filter_transform.index(filter_coord)];
+        size_t arg1_idx = filter_transform.index(filter_coord);
+        const HEPlaintext& mult_arg1 = arg1[arg1_idx];
         auto prod = he_seal_backend.create_empty_ciphertext(pool);
 
-        ngraph::he::scalar_multiply_seal(*mult_arg0, mult_arg1, prod,
-                                         element_type, he_seal_backend, pool);
+        ngraph::he::scalar_multiply_seal(
+            *mult_arg0, mult_arg1,
+            find_encoded_value(encoded_arg1, arg1_idx, *mult_arg0), prod,
+            element_type, he_seal_backend, pool);
         if (first_add) {
           sum = prod;
           first_add = false;
@@ -385,7 +386,9 @@ inline void convolution_seal(
     if (verbose && out_coord_idx % 1000 == 0 && out_coord_idx != 0) {
       NGRAPH_INFO << "Finished out coord " << out_coord_idx;
     }
-  }
+  };
+  he_seal_backend.get_thread_pool().parallel_for(0, out_transform_size,
+                                                 compute_output);
 }
 
 inline void convolution_seal(
@@ -400,7 +403,8 @@ inline void convolution_seal(
     size_t input_channel_axis_filters, size_t output_channel_axis_filters,
     size_t batch_axis_result, size_t output_channel_axis_result,
     bool rotate_filter, const element::Type& element_type, size_t batch_size,
-    const ngraph::he::HESealBackend& he_seal_backend, bool verbose = true) {
+    const ngraph::he::HESealBackend& he_seal_backend, bool verbose = true,
+    const EncodedScalars* encoded_arg0 = nullptr) {
   CoordinateTransform output_transform(out_shape);
 
   // Store output coordinates for parallelization
@@ -413,12 +417,9 @@ inline void convolution_seal(
     NGRAPH_INFO << "Convolution output size " << out_transform_size;
   }
 
-// TODO: don't create new thread for every loop index, only one per thread
-#pragma omp parallel for
-  for (size_t out_coord_idx = 0; out_coord_idx < out_transform_size;
-       ++out_coord_idx) {
-    // Init thread-local memory pool for each thread
-    seal::MemoryPoolHandle pool = seal::MemoryPoolHandle::ThreadLocal();
+  auto compute_output = [&](size_t out_coord_idx) {
+    // Memory pool owned by the worker thread
+    seal::MemoryPoolHandle pool = ngraph::he::ThreadPool::memory_pool();
 
     const Coordinate& out_coord = out_coords[out_coord_idx];
 
@@ -507,13 +508,16 @@ inline void convolution_seal(
       }
 
       if (input_batch_transform.has_source_coordinate(input_batch_coord)) {
-        auto mult_arg0 = arg0[input_batch_transform.index(input_batch_coord)];
+        size_t arg0_idx = input_batch_transform.index(input_batch_coord);
+        const HEPlaintext& mult_arg0 = arg0[arg0_idx];
 
         auto mult_arg1 = arg1[filter_transform.index(filter_coord)];
         auto prod = he_seal_backend.create_empty_ciphertext(pool);
 
-        ngraph::he::scalar_multiply_seal(*mult_arg1, mult_arg0, prod,
-                                         element_type, he_seal_backend, pool);
+        ngraph::he::scalar_multiply_seal(
+            *mult_arg1, mult_arg0,
+            find_encoded_value(encoded_arg0, arg0_idx, *mult_arg1), prod,
+            element_type, he_seal_backend, pool);
         if (first_add) {
           sum = prod;
           first_add = false;
@@ -537,7 +541,9 @@ inline void convolution_seal(
     if (verbose && out_coord_idx % 1000 == 0 && out_coord_idx != 0) {
       NGRAPH_INFO << "Finished out coord " << out_coord_idx;
     }
-  }
+  };
+  he_seal_backend.get_thread_pool().parallel_for(0, out_transform_size,
+                                                 compute_output);
 }
 
 inline void convolution_seal(
@@ -564,9 +570,7 @@ inline void convolution_seal(
     NGRAPH_INFO << "Convolution output size " << out_transform_size;
   }
 
-#pragma omp parallel for
-  for (size_t out_coord_idx = 0; out_coord_idx < out_transform_size;
-       ++out_coord_idx) {
+  auto compute_output = [&](size_t out_coord_idx) {
     const Coordinate& out_coord = out_coords[out_coord_idx];
 
     size_t batch_index = out_coord[batch_axis_result];
@@ -677,7 +681,9 @@ inline void convolution_seal(
       // Write the sum back.
       out[out_coord_idx] = sum;
     }
-  }
+  };
+  he_seal_backend.get_thread_pool().parallel_for(0, out_transform_size,
+                                                 compute_output);
 }
 
 }  // namespace he
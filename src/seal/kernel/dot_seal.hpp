@@ -21,6 +21,7 @@
 
 #include "he_plaintext.hpp"
 #include "ngraph/coordinate_transform.hpp"
+#include "seal/encoded_constant.hpp"
 #include "seal/he_seal_backend.hpp"
 #include "seal/kernel/add_seal.hpp"
 #include "seal/kernel/multiply_seal.hpp"
@@ -83,12 +84,9 @@ inline void dot_seal(
   size_t arg1_projected_size = arg1_projected_coords.size();
   size_t global_projected_size = arg0_projected_size * arg1_projected_size;
 
-// TODO: don't create new thread for every loop index, only one per thread
-#pragma omp parallel for
-  for (size_t global_projected_idx = 0;
-       global_projected_idx < global_projected_size; ++global_projected_idx) {
-    // Init thread-local memory pool for each thread
-    seal::MemoryPoolHandle pool = seal::MemoryPoolHandle::ThreadLocal();
+  auto compute_output = [&](size_t global_projected_idx) {
+    // Memory pool owned by the worker thread
+    seal::MemoryPoolHandle pool = ngraph::he::ThreadPool::memory_pool();
 
     // Compute outer and inner index
     size_t arg0_projected_idx = global_projected_idx / arg1_projected_size;
@@ -153,7 +151,9 @@ inline void dot_seal(
     } else {
       out[out_index] = sum;
     }
-  }
+  };
+  he_seal_backend.get_thread_pool().parallel_for(0, global_projected_size,
+                                                 compute_output);
 }
 // End CCC
 
@@ -164,7 +164,8 @@ inline void dot_seal(
     std::vector<std::shared_ptr<SealCiphertextWrapper>>& out,
     const Shape& arg0_shape, const Shape& arg1_shape, const Shape& out_shape,
     size_t reduction_axes_count, const element::Type& element_type,
-    const HESealBackend& he_seal_backend) {
+    const HESealBackend& he_seal_backend,
+    const EncodedScalars* encoded_arg0 = nullptr) {
   // Get the sizes of the dot axes. It's easiest to pull them from arg1
   // because they're right up front.
   Shape dot_axis_sizes(reduction_axes_count);
@@ -212,12 +213,9 @@ inline void dot_seal(
   size_t arg1_projected_size = arg1_projected_coords.size();
   size_t global_projected_size = arg0_projected_size * arg1_projected_size;
 
-// TODO: don't create new thread for every loop index, only one per thread
-#pragma omp parallel for
-  for (size_t global_projected_idx = 0;
-       global_projected_idx < global_projected_size; ++global_projected_idx) {
-    // Init thread-local memory pool for each thread
-    seal::MemoryPoolHandle pool = seal::MemoryPoolHandle::ThreadLocal();
+  auto compute_output = [&](size_t global_projected_idx) {
+    // Memory pool owned by the worker thread
+    seal::MemoryPoolHandle pool = ngraph::he::ThreadPool::memory_pool();
 
     // Compute outer and inner index
     size_t arg0_projected_idx = global_projected_idx / arg1_projected_size;
@@ -262,11 +260,14 @@ inline void dot_seal(
                 arg1_it);
 
       // Multiply and add to the summands.
-      auto mult_arg0 = arg0[arg0_transform.index(arg0_coord)];
+      size_t arg0_idx = arg0_transform.index(arg0_coord);
+      const HEPlaintext& mult_arg0 = arg0[arg0_idx];
       auto mult_arg1 = arg1[arg1_transform.index(arg1_coord)];
       auto prod = he_seal_backend.create_empty_ciphertext();
-      scalar_multiply_seal(mult_arg0, *mult_arg1, prod, element_type,
-                           he_seal_backend, pool);
+      scalar_multiply_seal(*mult_arg1, mult_arg0,
+                           find_encoded_value(encoded_arg0, arg0_idx,
+                                              *mult_arg1),
+                           prod, element_type, he_seal_backend, pool);
       if (first_add) {
         // TODO: std::move(prod)?
         sum = prod;
@@ -283,7 +284,9 @@ inline void dot_seal(
     } else {
       out[out_index] = sum;
     }
-  }
+  };
+  he_seal_backend.get_thread_pool().parallel_for(0, global_projected_size,
+                                                 compute_output);
 }
 
 inline void dot_seal(
@@ -292,7 +295,8 @@ inline void dot_seal(
     std::vector<std::shared_ptr<SealCiphertextWrapper>>& out,
     const Shape& arg0_shape, const Shape& arg1_shape, const Shape& out_shape,
     size_t reduction_axes_count, const element::Type& element_type,
-    const HESealBackend& he_seal_backend) {
+    const HESealBackend& he_seal_backend,
+    const EncodedScalars* encoded_arg1 = nullptr) {
   // Get the sizes of the dot axes. It's easiest to pull them from arg1
   // because they're right up front.
   Shape dot_axis_sizes(reduction_axes_count);
@@ -340,12 +344,9 @@ inline void dot_seal(
   size_t arg1_projected_size = arg1_projected_coords.size();
   size_t global_projected_size = arg0_projected_size * arg1_projected_size;
 
-// TODO: don't create new thread for every loop index, only one per thread
-#pragma omp parallel for
-  for (size_t global_projected_idx = 0;
-       global_projected_idx < global_projected_size; ++global_projected_idx) {
-    // Init thread-local memory pool for each thread
-    seal::MemoryPoolHandle pool = seal::MemoryPoolHandle::ThreadLocal();
+  auto compute_output = [&](size_t global_projected_idx) {
+    // Memory pool owned by the worker thread
+    seal::MemoryPoolHandle pool = ngraph::he::ThreadPool::memory_pool();
 
     // Compute outer and inner index
     size_t arg0_projected_idx = global_projected_idx / arg1_projected_size;
@@ -391,10 +392,13 @@ inline void dot_seal(
 
       // Multiply and add to the summands.
       auto mult_arg0 = arg0[arg0_transform.index(arg0_coord)];
-      auto mult_arg1 = arg1[arg1_transform.index(arg1_coord)];
+      size_t arg1_idx = arg1_transform.index(arg1_coord);
+      const HEPlaintext& mult_arg1 = arg1[arg1_idx];
       auto prod = he_seal_backend.create_empty_ciphertext();
-      scalar_multiply_seal(*mult_arg0, mult_arg1, prod, element_type,
-                           he_seal_backend, pool);
+      scalar_multiply_seal(*mult_arg0, mult_arg1,
+                           find_encoded_value(encoded_arg1, arg1_idx,
+                                              *mult_arg0),
+                           prod, element_type, he_seal_backend, pool);
       if (first_add) {
         // TODO: std::move(prod)?
         sum = prod;
@@ -411,7 +415,9 @@ inline void dot_seal(
     } else {
       out[out_index] = sum;
     }
-  }
+  };
+  he_seal_backend.get_thread_pool().parallel_for(0, global_projected_size,
+                                                 compute_output);
 }
 
 // PPP
@@ -469,9 +475,7 @@ inline void dot_seal(const std::vector<HEPlaintext>& arg0,
   size_t arg1_projected_size = arg1_projected_coords.size();
   size_t global_projected_size = arg0_projected_size * arg1_projected_size;
 
-#pragma omp parallel for
-  for (size_t global_projected_idx = 0;
-       global_projected_idx < global_projected_size; ++global_projected_idx) {
+  auto compute_output = [&](size_t global_projected_idx) {
     // Compute outer and inner index
     size_t arg0_projected_idx = global_projected_idx / arg1_projected_size;
     size_t arg1_projected_idx = global_projected_idx % arg1_projected_size;
@@ -529,7 +533,9 @@ inline void dot_seal(const std::vector<HEPlaintext>& arg0,
     }
     // Write the sum back.
     out[out_index] = sum;
-  }
+  };
+  he_seal_backend.get_thread_pool().parallel_for(0, global_projected_size,
+                                                 compute_output);
 }
 }  // namespace he
 }  // namespace ngraph
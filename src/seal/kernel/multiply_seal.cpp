@@ -50,10 +50,10 @@ void ngraph::he::scalar_multiply_seal(
 
   } else {
     match_modulus_and_scale_inplace(arg0, arg1, he_seal_backend, pool);
-    size_t chain_ind0 = get_chain_index(arg0, he_seal_backend);
-    size_t chain_ind1 = get_chain_index(arg1, he_seal_backend);
-
-    if (chain_ind0 == 0 || chain_ind1 == 0) {
+    // The operands are at the same level, which is the last one at chain
+    // index 0
+    if (arg0.ciphertext().parms_id() ==
+        he_seal_backend.get_context()->last_parms_id()) {
       NGRAPH_INFO << "Multiplicative depth limit reached";
       exit(1);
     }
@@ -75,7 +75,7 @@ void ngraph::he::scalar_multiply_seal(
 
 void ngraph::he::scalar_multiply_seal(
     ngraph::he::SealCiphertextWrapper& arg0,
-    const ngraph::he::HEPlaintext& arg1,
+    const ngraph::he::HEPlaintext& arg1, const std::uint64_t* encoded_arg1,
     std::shared_ptr<ngraph::he::SealCiphertextWrapper>& out,
     const element::Type& element_type, const HESealBackend& he_seal_backend,
     const seal::MemoryPoolHandle& pool) {
@@ -102,10 +102,15 @@ void ngraph::he::scalar_multiply_seal(
     out->value() = 0;
 
   } else if (arg1.is_single_value()) {
-    double value = static_cast<double>(arg1.values()[0]);
-
-    multiply_plain(arg0.ciphertext(), value, out->ciphertext(), he_seal_backend,
-                   pool);
+    if (encoded_arg1 != nullptr) {
+      out->ciphertext() = arg0.ciphertext();
+      multiply_plain_inplace(out->ciphertext(), encoded_arg1, he_seal_backend,
+                             pool);
+    } else {
+      double value = static_cast<double>(arg1.values()[0]);
+      multiply_plain(arg0.ciphertext(), value, out->ciphertext(),
+                     he_seal_backend, pool);
+    }
 
     if (out->ciphertext().is_transparent()) {
       NGRAPH_WARN << "Result ciphertext is transparent";
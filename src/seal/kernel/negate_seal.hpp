@@ -47,10 +47,9 @@ inline void negate_seal(
     std::vector<std::shared_ptr<SealCiphertextWrapper>>& out,
     const element::Type& element_type,
     const ngraph::he::HESealBackend& he_seal_backend, size_t count) {
-#pragma omp parallel for
-  for (size_t i = 0; i < count; ++i) {
+  he_seal_backend.get_thread_pool().parallel_for(0, count, [&](size_t i) {
     scalar_negate_seal(*arg[i], out[i], element_type, he_seal_backend);
-  }
+  });
 }
 }  // namespace he
 }  // namespace ngraph
@@ -22,10 +22,9 @@ void ngraph::he::result_seal(
     const HESealBackend& he_seal_backend) {
   NGRAPH_CHECK(out.size() == arg.size(), "Result output size ", out.size(),
                " does not match result input size ", arg.size());
-#pragma omp parallel for
-  for (size_t i = 0; i < count; ++i) {
+  he_seal_backend.get_thread_pool().parallel_for(0, count, [&](size_t i) {
     he_seal_backend.encrypt(out[i], arg[i], he_seal_backend.complex_packing());
-  }
+  });
 }
 
 void ngraph::he::result_seal(
@@ -34,8 +33,7 @@ void ngraph::he::result_seal(
     const HESealBackend& he_seal_backend) {
   NGRAPH_CHECK(out.size() == arg.size(), "Result output size ", out.size(),
                " does not match result input size ", arg.size());
-#pragma omp parallel for
-  for (size_t i = 0; i < count; ++i) {
+  he_seal_backend.get_thread_pool().parallel_for(0, count, [&](size_t i) {
     he_seal_backend.decrypt(out[i], *arg[i]);
-  }
+  });
 }
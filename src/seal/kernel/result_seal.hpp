@@ -35,7 +35,6 @@ inline void result_seal(
   NGRAPH_CHECK(out.size() >= count, "Result out size ", out.size(),
                " smaller than count ", count);
 
-#pragma omp parallel for
   for (size_t i = 0; i < count; ++i) {
     out[i] = arg[i];
   }
@@ -45,7 +44,6 @@ inline void result_seal(const std::vector<HEPlaintext>& arg,
                         std::vector<HEPlaintext>& out, size_t count) {
   NGRAPH_CHECK(out.size() == arg.size(), "Result output size ", out.size(),
                " does not match result input size ", arg.size());
-#pragma omp parallel for
   for (size_t i = 0; i < count; ++i) {
     out[i] = arg[i];
   }
@@ -53,11 +53,10 @@ inline void subtract_seal(
     const element::Type& element_type, const HESealBackend& he_seal_backend,
     size_t count,
     const seal::MemoryPoolHandle& pool = seal::MemoryManager::GetPool()) {
-#pragma omp parallel for
-  for (size_t i = 0; i < count; ++i) {
+  he_seal_backend.get_thread_pool().parallel_for(0, count, [&](size_t i) {
     scalar_subtract_seal(*arg0[i], *arg1[i], out[i], element_type,
                          he_seal_backend);
-  }
+  });
 }
 
 inline void subtract_seal(
@@ -66,11 +65,10 @@ inline void subtract_seal(
     std::vector<std::shared_ptr<SealCiphertextWrapper>>& out,
     const element::Type& element_type, const HESealBackend& he_seal_backend,
     size_t count) {
-#pragma omp parallel for
-  for (size_t i = 0; i < count; ++i) {
+  he_seal_backend.get_thread_pool().parallel_for(0, count, [&](size_t i) {
     scalar_subtract_seal(*arg0[i], arg1[i], out[i], element_type,
                          he_seal_backend);
-  }
+  });
 }
 
 inline void subtract_seal(
@@ -79,11 +77,10 @@ inline void subtract_seal(
     std::vector<std::shared_ptr<SealCiphertextWrapper>>& out,
     const element::Type& element_type, const HESealBackend& he_seal_backend,
     size_t count) {
-#pragma omp parallel for
-  for (size_t i = 0; i < count; ++i) {
+  he_seal_backend.get_thread_pool().parallel_for(0, count, [&](size_t i) {
     scalar_subtract_seal(arg0[i], *arg1[i], out[i], element_type,
                          he_seal_backend);
-  }
+  });
 }
 
 inline void subtract_seal(std::vector<HEPlaintext>& arg0,
@@ -91,11 +88,10 @@ inline void subtract_seal(std::vector<HEPlaintext>& arg0,
                           std::vector<HEPlaintext>& out,
                           const element::Type& element_type,
                           const HESealBackend& he_seal_backend, size_t count) {
-#pragma omp parallel for
-  for (size_t i = 0; i < count; ++i) {
+  he_seal_backend.get_thread_pool().parallel_for(0, count, [&](size_t i) {
     scalar_subtract_seal(arg0[i], arg1[i], out[i], element_type,
                          he_seal_backend);
-  }
+  });
 }
 }  // namespace he
 }  // namespace ngraph
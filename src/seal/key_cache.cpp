@@ -0,0 +1,231 @@
+//*****************************************************************************
+// Copyright 2018-2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//*****************************************************************************
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utime.h>
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+
+#include "ngraph/check.hpp"
+#include "ngraph/log.hpp"
+#include "seal/key_cache.hpp"
+#include "seal/util/hash.h"
+
+namespace {
+const std::string key_file_suffix = ".keys";
+}
+
+bool ngraph::he::is_valid_key_id(const std::string& key_id) {
+  return !key_id.empty() && key_id.size() <= 64 &&
+         std::all_of(key_id.begin(), key_id.end(),
+                     [](char c) { return std::isxdigit(c) != 0; });
+}
+
+std::string ngraph::he::key_id_from_public_key(
+    const seal::PublicKey& public_key) {
+  const seal::Ciphertext& key = public_key.data();
+  std::vector<uint64_t> words(key.parms_id().begin(), key.parms_id().end());
+  words.insert(words.end(), key.data(), key.data() + key.uint64_count());
+  seal::util::HashFunction::sha3_block_type hash;
+  seal::util::HashFunction::sha3_hash(words.data(), words.size(), hash);
+
+  std::stringstream ss;
+  ss << std::hex << std::setfill('0');
+  for (uint64_t hash_word : hash) {
+    ss << std::setw(16) << hash_word;
+  }
+  return ss.str();
+}
+
+bool ngraph::he::write_file_atomically(const std::string& path,
+                                       const std::string& contents,
+                                       mode_t mode) {
+  std::string tmp_path = path + ".tmp";
+  // A stale temporary file is removed rather than written through, and
+  // O_EXCL fails if another one appears in the meantime
+  unlink(tmp_path.c_str());
+  int fd = open(tmp_path.c_str(), O_CREAT | O_EXCL | O_WRONLY, mode);
+  if (fd < 0) {
+    NGRAPH_INFO << "Cannot create " << tmp_path << ": " << std::strerror(errno);
+    return false;
+  }
+  bool written = true;
+  const char* data = contents.data();
+  size_t remaining = contents.size();
+  while (written && remaining > 0) {
+    ssize_t count = write(fd, data, remaining);
+    if (count < 0 && errno != EINTR) {
+      written = false;
+    } else if (count > 0) {
+      data += count;
+      remaining -= static_cast<size_t>(count);
+    }
+  }
+  written = written && fsync(fd) == 0;
+  written = close(fd) == 0 && written;
+  written = written && std::rename(tmp_path.c_str(), path.c_str()) == 0;
+  if (!written) {
+    NGRAPH_INFO << "Cannot write " << path << ": " << std::strerror(errno);
+    unlink(tmp_path.c_str());
+  }
+  return written;
+}
+
+ngraph::he::KeyCache::KeyCache(std::string directory, size_t memory_capacity,
+                               size_t disk_capacity)
+    : m_directory(std::move(directory)),
+      m_memory_capacity(memory_capacity),
+      m_disk_capacity(disk_capacity) {}
+
+std::string ngraph::he::KeyCache::key_path(const std::string& key_id) const {
+  return m_directory + "/" + key_id + key_file_suffix;
+}
+
+bool ngraph::he::KeyCache::find(
+    const std::string& key_id,
+    const std::shared_ptr<seal::SEALContext>& context, Keys& keys) {
+  if (!is_valid_key_id(key_id)) {
+    return false;
+  }
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_key_index.find(key_id);
+    if (it != m_key_index.end()) {
+      if (it->second->second.relin_keys->parms_id() !=
+          context->key_parms_id()) {
+        return false;
+      }
+      m_keys.splice(m_keys.begin(), m_keys, it->second);
+      keys = m_keys.front().second;
+      m_hit_count++;
+      return true;
+    }
+  }
+
+  // Keys are loaded without holding the lock, so other clients are not held
+  // up by the load
+  if (m_directory.empty()) {
+    return false;
+  }
+  std::string path = key_path(key_id);
+  std::ifstream key_file(path, std::ios::binary);
+  if (!key_file) {
+    return false;
+  }
+  Keys loaded_keys{std::make_shared<seal::PublicKey>(),
+                   std::make_shared<seal::RelinKeys>()};
+  try {
+    loaded_keys.public_key->load(context, key_file);
+    loaded_keys.relin_keys->load(context, key_file);
+  } catch (const std::exception& e) {
+    NGRAPH_INFO << "Cannot load cached keys " << key_id << ": " << e.what();
+    return false;
+  }
+  // Marks the file as recently used
+  utime(path.c_str(), nullptr);
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    insert_in_memory(key_id, loaded_keys);
+  }
+  keys = loaded_keys;
+  m_hit_count++;
+  return true;
+}
+
+bool ngraph::he::KeyCache::insert(const std::string& key_id,
+                                  const Keys& keys) {
+  NGRAPH_CHECK(is_valid_key_id(key_id), "Invalid key id ", key_id);
+  NGRAPH_CHECK(keys.public_key != nullptr && keys.relin_keys != nullptr,
+               "Missing keys for key id ", key_id);
+  NGRAPH_CHECK(key_id == key_id_from_public_key(*keys.public_key), "Key id ",
+               key_id, " does not match public key");
+  std::lock_guard<std::mutex> lock(m_mutex);
+  // The public key matches the id, but the relinearization keys cannot be
+  // checked, so keys stored first are never replaced
+  if (m_key_index.find(key_id) != m_key_index.end() ||
+      (!m_directory.empty() && access(key_path(key_id).c_str(), F_OK) == 0)) {
+    return false;
+  }
+  insert_in_memory(key_id, keys);
+
+  if (m_directory.empty()) {
+    return true;
+  }
+  std::stringstream key_stream;
+  keys.public_key->save(key_stream);
+  keys.relin_keys->save(key_stream);
+  if (write_file_atomically(key_path(key_id), key_stream.str(),
+                            S_IRUSR | S_IWUSR)) {
+    evict_from_disk();
+  }
+  return true;
+}
+
+void ngraph::he::KeyCache::insert_in_memory(const std::string& key_id,
+                                            const Keys& keys) {
+  auto it = m_key_index.find(key_id);
+  if (it != m_key_index.end()) {
+    m_keys.erase(it->second);
+  }
+  m_keys.emplace_front(key_id, keys);
+  m_key_index[key_id] = m_keys.begin();
+  while (m_keys.size() > m_memory_capacity) {
+    m_key_index.erase(m_keys.back().first);
+    m_keys.pop_back();
+  }
+}
+
+void ngraph::he::KeyCache::evict_from_disk() {
+  DIR* dir = opendir(m_directory.c_str());
+  if (dir == nullptr) {
+    return;
+  }
+  // (modification time, path) of each key file
+  std::vector<std::pair<time_t, std::string>> key_files;
+  while (dirent* entry = readdir(dir)) {
+    std::string name(entry->d_name);
+    if (name.size() <= key_file_suffix.size() ||
+        name.compare(name.size() - key_file_suffix.size(),
+                     key_file_suffix.size(), key_file_suffix) != 0) {
+      continue;
+    }
+    std::string path = m_directory + "/" + name;
+    struct stat file_stat;
+    if (stat(path.c_str(), &file_stat) == 0) {
+      key_files.emplace_back(file_stat.st_mtime, path);
+    }
+  }
+  closedir(dir);
+
+  if (key_files.size() <= m_disk_capacity) {
+    return;
+  }
+  std::sort(key_files.begin(), key_files.end());
+  size_t evict_count = key_files.size() - m_disk_capacity;
+  for (size_t i = 0; i < evict_count; ++i) {
+    std::remove(key_files[i].second.c_str());
+  }
+}
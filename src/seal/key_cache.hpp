@@ -0,0 +1,106 @@
+//*****************************************************************************
+// Copyright 2018-2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//*****************************************************************************
+
+#pragma once
+
+#include <sys/types.h>
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include "seal/seal.h"
+
+namespace ngraph {
+namespace he {
+/// @brief Returns whether key_id is a valid client key id, i.e. a non-empty
+/// string of at most 64 hexadecimal digits
+bool is_valid_key_id(const std::string& key_id);
+
+/// @brief Returns the key id of the client with public_key, the SHA3-256 hash
+/// of its parms_id and data in hexadecimal. The server derives the id from
+/// uploaded keys, so a client cannot store keys under the id of another
+std::string key_id_from_public_key(const seal::PublicKey& public_key);
+
+/// @brief Writes contents to a new temporary file with the given permissions,
+/// which is synced and renamed to path, so readers never see a partial file
+/// @return Whether the file was written
+bool write_file_atomically(const std::string& path,
+                           const std::string& contents, mode_t mode);
+
+/// \brief Public and relinearization keys of returning clients, by key id.
+/// The most recently used keys are kept in memory and, if a directory is
+/// given, the most recently used keys up to a bound are kept on disk, so they
+/// survive the server process
+class KeyCache {
+ public:
+  enum { default_memory_capacity = 16, default_disk_capacity = 256 };
+
+  struct Keys {
+    std::shared_ptr<seal::PublicKey> public_key;
+    std::shared_ptr<seal::RelinKeys> relin_keys;
+  };
+
+  /// @param directory Directory storing the keys. If empty, keys are only
+  /// kept in memory
+  /// @param memory_capacity Maximum number of keys kept in memory
+  /// @param disk_capacity Maximum number of keys kept in directory
+  explicit KeyCache(std::string directory,
+                    size_t memory_capacity = default_memory_capacity,
+                    size_t disk_capacity = default_disk_capacity);
+
+  /// @brief Looks up the keys of a client
+  /// @param context Context the keys must be valid for
+  /// @param[out] keys Keys of the client, if found
+  /// @return Whether keys valid for context were found
+  bool find(const std::string& key_id,
+            const std::shared_ptr<seal::SEALContext>& context, Keys& keys);
+
+  /// @brief Stores the keys of a client, unless keys with key_id are already
+  /// stored, which are kept
+  /// @param key_id Must be key_id_from_public_key(*keys.public_key)
+  /// @return Whether the keys were stored
+  bool insert(const std::string& key_id, const Keys& keys);
+
+  /// @brief Returns the number of successful find() calls
+  size_t hit_count() const { return m_hit_count; }
+
+ private:
+  std::string key_path(const std::string& key_id) const;
+
+  // Adds keys as the most recently used keys in memory. Must hold m_mutex
+  void insert_in_memory(const std::string& key_id, const Keys& keys);
+
+  // Removes the least recently used key files beyond m_disk_capacity
+  void evict_from_disk();
+
+  std::string m_directory;
+  size_t m_memory_capacity;
+  size_t m_disk_capacity;
+
+  // Most recently used first
+  std::list<std::pair<std::string, Keys>> m_keys;
+  std::unordered_map<std::string,
+                     std::list<std::pair<std::string, Keys>>::iterator>
+      m_key_index;
+  std::mutex m_mutex;
+  std::atomic<size_t> m_hit_count{0};
+};
+}  // namespace he
+}  // namespace ngraph
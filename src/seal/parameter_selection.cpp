@@ -0,0 +1,128 @@
+//*****************************************************************************
+// Copyright 2018-2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//*****************************************************************************
+
+#include <algorithm>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+#include "ngraph/check.hpp"
+#include "ngraph/except.hpp"
+#include "node_wrapper.hpp"
+#include "seal/parameter_selection.hpp"
+
+size_t ngraph::he::multiplicative_depth(const Function& function,
+                                        bool encrypt_model) {
+  // Depth of the encrypted outputs of ops. Plaintext outputs are not listed
+  std::unordered_map<const Node*, size_t> depths;
+  size_t max_depth = 0;
+
+  for (const auto& node : function.get_ordered_ops()) {
+    auto type_id = NodeWrapper(node).get_typeid();
+    bool encrypted = type_id == OP_TYPEID::Parameter ||
+                     (encrypt_model && node->is_constant());
+    size_t depth = 0;
+    for (const auto& arg : node->get_arguments()) {
+      auto it = depths.find(arg.get());
+      if (it != depths.end()) {
+        encrypted = true;
+        depth = std::max(depth, it->second);
+      }
+    }
+    if (!encrypted) {
+      continue;
+    }
+    switch (type_id) {
+      case OP_TYPEID::AvgPool:
+      case OP_TYPEID::BatchNormInference:
+      case OP_TYPEID::Convolution:
+      case OP_TYPEID::Dot:
+      case OP_TYPEID::Multiply:
+        depth++;
+        break;
+      default:
+        break;
+    }
+    depths[node.get()] = depth;
+    max_depth = std::max(max_depth, depth);
+  }
+  return max_depth;
+}
+
+ngraph::he::HESealEncryptionParameters
+ngraph::he::select_encryption_parameters(
+    const ParameterRequirements& requirements) {
+  seal::sec_level_type sec_level = seal::sec_level_type::none;
+  if (requirements.security_level == 128) {
+    sec_level = seal::sec_level_type::tc128;
+  } else if (requirements.security_level == 192) {
+    sec_level = seal::sec_level_type::tc192;
+  } else if (requirements.security_level == 256) {
+    sec_level = seal::sec_level_type::tc256;
+  } else if (requirements.security_level != 0) {
+    throw ngraph_error("security_level must be 0, 128, 192, 256");
+  }
+
+  int first_bits =
+      static_cast<int>(requirements.scale_bits + requirements.integer_bits);
+  int scale_bits = static_cast<int>(requirements.scale_bits);
+  NGRAPH_CHECK(first_bits <= 60, "Scale bits ", requirements.scale_bits,
+               " and integer bits ", requirements.integer_bits,
+               " exceed the 60 bits of a coefficient modulus");
+
+  // The scale is the last prime of the chain (see choose_scale()), so there
+  // is at least one level even without multiplications. The special prime is
+  // at least as large as the others
+  std::vector<int> coeff_modulus_bits{first_bits};
+  coeff_modulus_bits.insert(
+      coeff_modulus_bits.end(),
+      std::max(requirements.multiplicative_depth, size_t(1)), scale_bits);
+  coeff_modulus_bits.emplace_back(std::max(first_bits, scale_bits));
+  int total_bits = std::accumulate(coeff_modulus_bits.begin(),
+                                   coeff_modulus_bits.end(), 0);
+
+  for (std::uint64_t poly_modulus_degree = 1024; poly_modulus_degree <= 32768;
+       poly_modulus_degree *= 2) {
+    size_t slots = requirements.complex_packing ? poly_modulus_degree
+                                                : poly_modulus_degree / 2;
+    if (slots < requirements.slot_count) {
+      continue;
+    }
+    if (sec_level != seal::sec_level_type::none &&
+        total_bits > seal::CoeffModulus::MaxBitCount(poly_modulus_degree,
+                                                     sec_level)) {
+      continue;
+    }
+    try {
+      return HESealEncryptionParameters("HE_SEAL", poly_modulus_degree,
+                                        requirements.security_level,
+                                        coeff_modulus_bits);
+    } catch (const std::logic_error&) {
+      // Too few primes of some bit count are congruent to 1 modulo
+      // 2 * poly_modulus_degree
+      continue;
+    }
+  }
+  std::stringstream ss;
+  ss << "No poly_modulus_degree up to 32768 supports multiplicative depth "
+     << requirements.multiplicative_depth << " with " << total_bits
+     << " coefficient modulus bits at security level "
+     << requirements.security_level << " and " << requirements.slot_count
+     << " slots";
+  throw ngraph_error(ss.str());
+}
@@ -0,0 +1,57 @@
+//*****************************************************************************
+// Copyright 2018-2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//*****************************************************************************
+
+#pragma once
+
+#include <cstdint>
+
+#include "ngraph/function.hpp"
+#include "seal/he_seal_encryption_parameters.hpp"
+
+namespace ngraph {
+namespace he {
+/// @brief Returns the largest number of multiplying ops (AvgPool,
+/// BatchNormInference, Convolution, Dot, Multiply) on a path of encrypted
+/// values of function, each of which uses one level of the coefficient
+/// modulus chain. Parameters are assumed encrypted
+/// @param encrypt_model Whether constants are encrypted too
+size_t multiplicative_depth(const Function& function,
+                            bool encrypt_model = false);
+
+/// \brief What select_encryption_parameters() selects parameters for
+struct ParameterRequirements {
+  // Levels used on the deepest path, see multiplicative_depth()
+  size_t multiplicative_depth{1};
+  // Bits of precision of the fractional part of values, i.e. of the scale
+  size_t scale_bits{24};
+  // Bits of the integer part of the largest value decrypted
+  size_t integer_bits{6};
+  // Minimum security level in bits, or 0 to enforce none
+  std::uint64_t security_level{128};
+  // Number of values packed into each ciphertext, e.g. the batch size
+  size_t slot_count{1};
+  bool complex_packing{false};
+};
+
+/// @brief Returns the parameters with the smallest poly_modulus_degree which
+/// meet requirements, along with the shortest coefficient modulus chain: a
+/// first prime holding the integer and fractional bits, one prime of
+/// scale_bits per level, and a special prime for key switching
+/// @throws ngraph_error if no poly_modulus_degree up to 32768 meets them
+HESealEncryptionParameters select_encryption_parameters(
+    const ParameterRequirements& requirements);
+}  // namespace he
+}  // namespace ngraph
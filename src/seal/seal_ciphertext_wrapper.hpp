@@ -16,12 +16,290 @@
 
 #pragma once
 
+#include <array>
+#include <cstdint>
+#include <cstring>
 #include <memory>
 
+#include "ngraph/check.hpp"
 #include "seal/seal.h"
 
 namespace ngraph {
 namespace he {
+/// \brief Symmetric ciphertext whose second polynomial is sampled from a PRNG
+/// seeded with seed. The ciphertext holds both polynomials, but only the first
+/// one and the seed are serialized, which roughly halves its size
+struct SeededCiphertext {
+  enum { seed_uint64_count = 4 };
+  using Seed = std::array<uint64_t, seed_uint64_count>;
+
+  seal::Ciphertext ciphertext;
+  Seed seed;
+};
+
+/// \brief ChaCha20 keystream (RFC 8439) as a SEAL random generator, returning
+/// one little-endian 32-bit word of the keystream per call. SEAL 3.3 has no
+/// seedable generator outside of AES-NI builds, so seeds are expanded with
+/// this one. The second polynomial of a SeededCiphertext is sampled from it
+/// with seal::util::sample_poly_uniform, so it is part of the client-server
+/// protocol and must not change
+class SeedGenerator : public seal::UniformRandomGenerator {
+ public:
+  /// @param key 256-bit key as eight little-endian words
+  /// @param counter Block counter of the first block
+  /// @param nonce 96-bit nonce as three little-endian words
+  SeedGenerator(const std::array<uint32_t, 8>& key, uint32_t counter,
+                const std::array<uint32_t, 3>& nonce);
+
+  /// @brief Keystream with the seed as key, each word of which is two
+  /// little-endian key words, block counter 0 and nonce 0
+  explicit SeedGenerator(const SeededCiphertext::Seed& seed);
+
+  uint32_t generate() override;
+
+ private:
+  void next_block();
+
+  std::array<uint32_t, 16> m_state;
+  std::array<uint32_t, 16> m_block;
+  size_t m_block_idx;
+};
+
+/// @brief Regenerates the second polynomial of a seeded ciphertext from a
+/// SeedGenerator
+/// @param[in,out] cipher Ciphertext of size 2 whose first polynomial is set
+void expand_seed(seal::Ciphertext& cipher,
+                 const std::shared_ptr<seal::SEALContext>& context,
+                 const SeededCiphertext::Seed& seed);
+
+// Serialized ciphertexts have the layout written by seal::Ciphertext::save:
+// parms_id | is_ntt_form | size | poly_modulus_degree | coeff_mod_count |
+// scale | uint64_count | data
+constexpr size_t ciphertext_header_size =
+    sizeof(seal::parms_id_type) + sizeof(seal::SEAL_BYTE) +
+    3 * sizeof(uint64_t) + sizeof(double) + sizeof(uint64_t);
+
+inline size_t ciphertext_size(const seal::Ciphertext& cipher) {
+  return ciphertext_header_size + 8 * cipher.uint64_count();
+}
+
+/// @brief Serializes cipher to destination in the format of
+/// seal::Ciphertext::save, without an intermediate stream
+/// @param destination Buffer of at least ciphertext_size(cipher) bytes
+inline void save(const seal::Ciphertext& cipher, char* destination) {
+  auto write = [&destination](const void* src, size_t num_bytes) {
+    std::memcpy(destination, src, num_bytes);
+    destination += num_bytes;
+  };
+  seal::SEAL_BYTE is_ntt_form =
+      static_cast<seal::SEAL_BYTE>(cipher.is_ntt_form());
+  uint64_t size64 = static_cast<uint64_t>(cipher.size());
+  uint64_t poly_modulus_degree64 =
+      static_cast<uint64_t>(cipher.poly_modulus_degree());
+  uint64_t coeff_mod_count64 = static_cast<uint64_t>(cipher.coeff_mod_count());
+  uint64_t uint64_count64 = static_cast<uint64_t>(cipher.uint64_count());
+  double scale = cipher.scale();
+
+  write(&cipher.parms_id(), sizeof(seal::parms_id_type));
+  write(&is_ntt_form, sizeof(seal::SEAL_BYTE));
+  write(&size64, sizeof(uint64_t));
+  write(&poly_modulus_degree64, sizeof(uint64_t));
+  write(&coeff_mod_count64, sizeof(uint64_t));
+  write(&scale, sizeof(double));
+  write(&uint64_count64, sizeof(uint64_t));
+  write(cipher.data(), 8 * cipher.uint64_count());
+}
+
+/// @brief Deserializes a ciphertext written by save() or
+/// seal::Ciphertext::save directly from source, without an intermediate
+/// stream. The metadata is validated against context; the coefficients are
+/// copied as-is
+/// @param[out] cipher Ciphertext to load into. Its memory pool is kept
+inline void load(seal::Ciphertext& cipher,
+                 const std::shared_ptr<seal::SEALContext>& context,
+                 const char* source) {
+  auto read = [&source](void* dst, size_t num_bytes) {
+    std::memcpy(dst, source, num_bytes);
+    source += num_bytes;
+  };
+  seal::parms_id_type parms_id;
+  seal::SEAL_BYTE is_ntt_form;
+  uint64_t size64;
+  uint64_t poly_modulus_degree64;
+  uint64_t coeff_mod_count64;
+  double scale;
+  uint64_t uint64_count64;
+
+  read(&parms_id, sizeof(seal::parms_id_type));
+  read(&is_ntt_form, sizeof(seal::SEAL_BYTE));
+  read(&size64, sizeof(uint64_t));
+  read(&poly_modulus_degree64, sizeof(uint64_t));
+  read(&coeff_mod_count64, sizeof(uint64_t));
+  read(&scale, sizeof(double));
+  read(&uint64_count64, sizeof(uint64_t));
+
+  NGRAPH_CHECK(context->get_context_data(parms_id) != nullptr,
+               "Ciphertext parms_id not valid for context");
+  cipher.resize(context, parms_id, static_cast<size_t>(size64));
+  NGRAPH_CHECK(cipher.poly_modulus_degree() == poly_modulus_degree64 &&
+                   cipher.coeff_mod_count() == coeff_mod_count64 &&
+                   cipher.uint64_count() == uint64_count64,
+               "Ciphertext metadata not valid for context");
+  cipher.is_ntt_form() = (is_ntt_form != seal::SEAL_BYTE(0));
+  cipher.scale() = scale;
+  read(cipher.data(), 8 * cipher.uint64_count());
+}
+
+// Messages store ciphertexts as a batch with a single header, followed by the
+// scale and data of each ciphertext:
+// parms_id | is_ntt_form | size | poly_modulus_degree | coeff_mod_count |
+// seeded | uint64_count | (scale | data) for each ciphertext
+// All ciphertexts of a batch are at the same level and have the same size.
+// uint64_count is the number of data words of each ciphertext; seeded
+// ciphertexts store their first polynomial followed by the seed
+struct CiphertextBatchHeader {
+  enum {
+    serialized_size = sizeof(seal::parms_id_type) +
+                      2 * sizeof(seal::SEAL_BYTE) + 4 * sizeof(uint64_t)
+  };
+
+  seal::parms_id_type parms_id;
+  bool is_ntt_form;
+  uint64_t size;
+  uint64_t poly_modulus_degree;
+  uint64_t coeff_mod_count;
+  bool seeded;
+  uint64_t uint64_count;
+
+  /// @brief Returns the number of bytes of each ciphertext in the batch
+  size_t element_size() const { return sizeof(double) + 8 * uint64_count; }
+};
+
+inline CiphertextBatchHeader batch_header(const seal::Ciphertext& cipher) {
+  CiphertextBatchHeader header;
+  header.parms_id = cipher.parms_id();
+  header.is_ntt_form = cipher.is_ntt_form();
+  header.size = cipher.size();
+  header.poly_modulus_degree = cipher.poly_modulus_degree();
+  header.coeff_mod_count = cipher.coeff_mod_count();
+  header.seeded = false;
+  header.uint64_count = cipher.uint64_count();
+  return header;
+}
+
+inline CiphertextBatchHeader batch_header(const SeededCiphertext& cipher) {
+  CiphertextBatchHeader header = batch_header(cipher.ciphertext);
+  header.seeded = true;
+  header.uint64_count =
+      header.poly_modulus_degree * header.coeff_mod_count + cipher.seed.size();
+  return header;
+}
+
+inline void save(const CiphertextBatchHeader& header, char* destination) {
+  auto write = [&destination](const void* src, size_t num_bytes) {
+    std::memcpy(destination, src, num_bytes);
+    destination += num_bytes;
+  };
+  seal::SEAL_BYTE is_ntt_form =
+      static_cast<seal::SEAL_BYTE>(header.is_ntt_form);
+  seal::SEAL_BYTE seeded = static_cast<seal::SEAL_BYTE>(header.seeded);
+  write(&header.parms_id, sizeof(seal::parms_id_type));
+  write(&is_ntt_form, sizeof(seal::SEAL_BYTE));
+  write(&header.size, sizeof(uint64_t));
+  write(&header.poly_modulus_degree, sizeof(uint64_t));
+  write(&header.coeff_mod_count, sizeof(uint64_t));
+  write(&seeded, sizeof(seal::SEAL_BYTE));
+  write(&header.uint64_count, sizeof(uint64_t));
+}
+
+/// @brief Reads a batch header and validates it against context once for the
+/// whole batch
+inline CiphertextBatchHeader load_batch_header(
+    const std::shared_ptr<seal::SEALContext>& context, const char* source) {
+  auto read = [&source](void* dst, size_t num_bytes) {
+    std::memcpy(dst, source, num_bytes);
+    source += num_bytes;
+  };
+  CiphertextBatchHeader header;
+  seal::SEAL_BYTE is_ntt_form;
+  seal::SEAL_BYTE seeded;
+  read(&header.parms_id, sizeof(seal::parms_id_type));
+  read(&is_ntt_form, sizeof(seal::SEAL_BYTE));
+  read(&header.size, sizeof(uint64_t));
+  read(&header.poly_modulus_degree, sizeof(uint64_t));
+  read(&header.coeff_mod_count, sizeof(uint64_t));
+  read(&seeded, sizeof(seal::SEAL_BYTE));
+  read(&header.uint64_count, sizeof(uint64_t));
+  header.is_ntt_form = (is_ntt_form != seal::SEAL_BYTE(0));
+  header.seeded = (seeded != seal::SEAL_BYTE(0));
+
+  auto context_data = context->get_context_data(header.parms_id);
+  NGRAPH_CHECK(context_data != nullptr,
+               "Ciphertext batch parms_id not valid for context");
+  const auto& parms = context_data->parms();
+  NGRAPH_CHECK(header.poly_modulus_degree == parms.poly_modulus_degree() &&
+                   header.coeff_mod_count == parms.coeff_modulus().size(),
+               "Ciphertext batch metadata not valid for context");
+  uint64_t poly_uint64_count =
+      header.poly_modulus_degree * header.coeff_mod_count;
+  uint64_t expected_uint64_count =
+      header.seeded ? poly_uint64_count + SeededCiphertext::seed_uint64_count
+                    : poly_uint64_count * header.size;
+  NGRAPH_CHECK(header.size >= 2 && (!header.seeded || header.size == 2) &&
+                   header.uint64_count == expected_uint64_count,
+               "Ciphertext batch size not valid");
+  return header;
+}
+
+/// @brief Writes the scale and data of cipher, which must match header
+inline void save_batch_element(const seal::Ciphertext& cipher,
+                               const CiphertextBatchHeader& header,
+                               char* destination) {
+  NGRAPH_CHECK(!header.seeded && cipher.parms_id() == header.parms_id &&
+                   cipher.size() == header.size,
+               "Ciphertext does not match batch");
+  double scale = cipher.scale();
+  std::memcpy(destination, &scale, sizeof(double));
+  std::memcpy(destination + sizeof(double), cipher.data(),
+              8 * cipher.uint64_count());
+}
+
+inline void save_batch_element(const SeededCiphertext& cipher,
+                               const CiphertextBatchHeader& header,
+                               char* destination) {
+  const seal::Ciphertext& ciphertext = cipher.ciphertext;
+  NGRAPH_CHECK(header.seeded && ciphertext.parms_id() == header.parms_id &&
+                   ciphertext.size() == 2,
+               "Ciphertext does not match batch");
+  size_t poly_uint64_count = ciphertext.uint64_count() / 2;
+  double scale = ciphertext.scale();
+  std::memcpy(destination, &scale, sizeof(double));
+  destination += sizeof(double);
+  std::memcpy(destination, ciphertext.data(0), 8 * poly_uint64_count);
+  destination += 8 * poly_uint64_count;
+  std::memcpy(destination, cipher.seed.data(), 8 * cipher.seed.size());
+}
+
+/// @brief Reads a ciphertext of a batch whose header was validated by
+/// load_batch_header. Seeded ciphertexts are expanded
+inline void load_batch_element(
+    seal::Ciphertext& cipher, const CiphertextBatchHeader& header,
+    const std::shared_ptr<seal::SEALContext>& context, const char* source) {
+  cipher.resize(context, header.parms_id, static_cast<size_t>(header.size));
+  cipher.is_ntt_form() = header.is_ntt_form;
+  std::memcpy(&cipher.scale(), source, sizeof(double));
+  source += sizeof(double);
+  if (header.seeded) {
+    size_t poly_uint64_count = cipher.uint64_count() / 2;
+    SeededCiphertext::Seed seed;
+    std::memcpy(cipher.data(0), source, 8 * poly_uint64_count);
+    std::memcpy(seed.data(), source + 8 * poly_uint64_count, 8 * seed.size());
+    expand_seed(cipher, context, seed);
+  } else {
+    std::memcpy(cipher.data(), source, 8 * cipher.uint64_count());
+  }
+}
+
 class SealCiphertextWrapper {
  public:
   SealCiphertextWrapper() : m_complex_packing(false), m_known_value(false) {}
@@ -40,6 +318,10 @@ class SealCiphertextWrapper {
 
   void save(std::ostream& stream) const { m_ciphertext.save(stream); }
 
+  void save(char* destination) const {
+    ngraph::he::save(m_ciphertext, destination);
+  }
+
   size_t size() const { return m_ciphertext.size(); }
 
   bool known_value() const { return m_known_value; }
@@ -61,19 +343,15 @@ class SealCiphertextWrapper {
   float m_value;
 };
 
-inline size_t ciphertext_size(const seal::Ciphertext& cipher) {
-  // TODO: figure out why the extra 8 bytes
-  size_t expected_size = 8;
-  expected_size += sizeof(seal::parms_id_type);
-  expected_size += sizeof(seal::SEAL_BYTE);
-  // size64, poly_modulus_degere, coeff_mod_count
-  expected_size += 3 * sizeof(uint64_t);
-  // scale
-  expected_size += sizeof(double);
-  // data
-  expected_size += 8 * cipher.uint64_count();
-  return expected_size;
+inline CiphertextBatchHeader batch_header(
+    const std::shared_ptr<SealCiphertextWrapper>& cipher) {
+  return batch_header(cipher->ciphertext());
 }
 
+inline void save_batch_element(
+    const std::shared_ptr<SealCiphertextWrapper>& cipher,
+    const CiphertextBatchHeader& header, char* destination) {
+  save_batch_element(cipher->ciphertext(), header, destination);
+}
 }  // namespace he
 }  // namespace ngraph
@@ -18,6 +18,7 @@
 
 #include <chrono>
 #include <limits>
+#include <random>
 #include <utility>
 
 #include "ngraph/runtime/tensor.hpp"
@@ -27,12 +28,19 @@
 #include "seal/he_seal_backend.hpp"
 #include "seal/seal_ciphertext_wrapper.hpp"
 #include "seal/util/polyarithsmallmod.h"
+#include "seal/util/rlwe.h"
+#include "seal/util/smallntt.h"
 
 // Matches the modulus chain for the two elements in-place
 // The elements are modified if necessary
 void ngraph::he::match_modulus_and_scale_inplace(
     SealCiphertextWrapper& arg0, SealCiphertextWrapper& arg1,
     const HESealBackend& he_seal_backend, seal::MemoryPoolHandle pool) {
+  // Operands are usually matched by the level plan of the executable, in
+  // which case the chain indices need not be looked up
+  if (arg0.ciphertext().parms_id() == arg1.ciphertext().parms_id()) {
+    return;
+  }
   size_t chain_ind0 = ngraph::he::get_chain_index(arg0, he_seal_backend);
   size_t chain_ind1 = ngraph::he::get_chain_index(arg1, he_seal_backend);
 
@@ -66,6 +74,33 @@ void ngraph::he::match_modulus_and_scale_inplace(
   ngraph::he::match_scale(arg0, arg1, he_seal_backend);
 }
 
+void ngraph::he::match_parms_id(const SealCiphertextWrapper& cipher,
+                                SealCiphertextWrapper& destination,
+                                const seal::parms_id_type& parms_id,
+                                double scale,
+                                const HESealBackend& he_seal_backend,
+                                seal::MemoryPoolHandle pool) {
+  destination.complex_packing() = cipher.complex_packing();
+  destination.known_value() = false;
+  if (cipher.ciphertext().parms_id() == parms_id) {
+    if (&destination != &cipher) {
+      destination.ciphertext() = cipher.ciphertext();
+    }
+    return;
+  }
+  if (ngraph::he::within_rescale_tolerance(cipher.scale(), scale)) {
+    he_seal_backend.get_evaluator()->mod_switch_to(
+        cipher.ciphertext(), parms_id, destination.ciphertext(), pool);
+  } else {
+    he_seal_backend.get_evaluator()->rescale_to(
+        cipher.ciphertext(), parms_id, destination.ciphertext(), pool);
+  }
+  NGRAPH_CHECK(
+      ngraph::he::within_rescale_tolerance(destination.scale(), scale),
+      "Scale ", destination.scale(), " does not match scale ", scale);
+  destination.scale() = scale;
+}
+
 // Encode value into vector of coefficients
 void ngraph::he::encode(double value, double scale,
                         seal::parms_id_type parms_id,
@@ -107,16 +142,13 @@ void ngraph::he::encode(double value, double scale,
 
   int coeff_bit_count = static_cast<int>(log2(fabs(value))) + 2;
   if (coeff_bit_count >= context_data.total_coeff_modulus_bit_count()) {
-#pragma omp critical
-    {
-      NGRAPH_INFO << "Failed to encode " << value / scale << " at scale "
-                  << scale;
-      NGRAPH_INFO << "coeff_bit_count " << coeff_bit_count;
-      NGRAPH_INFO << "coeff_mod_count " << coeff_mod_count;
-      NGRAPH_INFO << "total coeff modulus bit count "
-                  << context_data.total_coeff_modulus_bit_count();
-      throw ngraph_error("encoded value is too large");
-    }
+    // A single statement, so lines from concurrent calls do not interleave
+    NGRAPH_INFO << "Failed to encode " << value / scale << " at scale "
+                << scale << ": coeff_bit_count " << coeff_bit_count
+                << ", coeff_mod_count " << coeff_mod_count
+                << ", total coeff modulus bit count "
+                << context_data.total_coeff_modulus_bit_count();
+    throw ngraph_error("encoded value is too large");
   }
 
   double two_pow_64 = pow(2.0, 64);
@@ -232,6 +264,16 @@ void ngraph::he::encode(double value, double scale,
 
 void ngraph::he::add_plain_inplace(seal::Ciphertext& encrypted, double value,
                                    const HESealBackend& he_seal_backend) {
+  std::vector<std::uint64_t> plaintext_vals;
+  ngraph::he::encode(value, encrypted.scale(), encrypted.parms_id(),
+                     plaintext_vals, he_seal_backend);
+  ngraph::he::add_plain_inplace(encrypted, plaintext_vals.data(),
+                                he_seal_backend);
+}
+
+void ngraph::he::add_plain_inplace(seal::Ciphertext& encrypted,
+                                   const std::uint64_t* encoded_value,
+                                   const HESealBackend& he_seal_backend) {
   // Verify parameters.
   auto context = he_seal_backend.get_context();
   if (!seal::is_metadata_valid_for(encrypted, context)) {
@@ -258,16 +300,10 @@ void ngraph::he::add_plain_inplace(seal::Ciphertext& encrypted, double value,
 
   NGRAPH_CHECK(encrypted.data() != nullptr, "Encrypted data == nullptr");
 
-  // Encode
-  std::vector<std::uint64_t> plaintext_vals(coeff_mod_count, 0);
-  double scale = encrypted.scale();
-  ngraph::he::encode(value, scale, encrypted.parms_id(), plaintext_vals,
-                     he_seal_backend);
-
   for (size_t j = 0; j < coeff_mod_count; j++) {
     // Add poly scalar instead of poly poly
     ngraph::he::add_poly_scalar_coeffmod(
-        encrypted.data() + (j * coeff_count), coeff_count, plaintext_vals[j],
+        encrypted.data() + (j * coeff_count), coeff_count, encoded_value[j],
         coeff_modulus[j], encrypted.data() + (j * coeff_count));
   }
 
@@ -283,6 +319,19 @@ void ngraph::he::multiply_plain_inplace(seal::Ciphertext& encrypted,
                                         double value,
                                         const HESealBackend& he_seal_backend,
                                         seal::MemoryPoolHandle pool) {
+  // TODO: explore using different scales! Smaller scales might reduce # of
+  // rescalings
+  std::vector<std::uint64_t> plaintext_vals;
+  ngraph::he::encode(value, encrypted.scale(), encrypted.parms_id(),
+                     plaintext_vals, he_seal_backend, pool);
+  ngraph::he::multiply_plain_inplace(encrypted, plaintext_vals.data(),
+                                     he_seal_backend, std::move(pool));
+}
+
+void ngraph::he::multiply_plain_inplace(seal::Ciphertext& encrypted,
+                                        const std::uint64_t* encoded_value,
+                                        const HESealBackend& he_seal_backend,
+                                        seal::MemoryPoolHandle pool) {
   // Verify parameters.
   auto context = he_seal_backend.get_context();
   if (!seal::is_metadata_valid_for(encrypted, context)) {
@@ -312,12 +361,7 @@ void ngraph::he::multiply_plain_inplace(seal::Ciphertext& encrypted,
     throw ngraph_error("invalid parameters");
   }
 
-  std::vector<std::uint64_t> plaintext_vals(coeff_mod_count, 0);
-  // TODO: explore using different scales! Smaller scales might reduce # of
-  // rescalings
   double scale = encrypted.scale();
-  ngraph::he::encode(value, scale, encrypted.parms_id(), plaintext_vals,
-                     he_seal_backend);
   double new_scale = scale * scale;
   // Check that scale is positive and not too large
   if (new_scale <= 0 || (static_cast<int>(log2(new_scale)) >=
@@ -342,12 +386,12 @@ void ngraph::he::multiply_plain_inplace(seal::Ciphertext& encrypted,
         const std::uint64_t barrett_ratio = iter->second;
         ngraph::he::multiply_poly_scalar_coeffmod64(
             encrypted.data(i) + (j * coeff_count), coeff_count,
-            plaintext_vals[j], modulus_value, barrett_ratio,
+            encoded_value[j], modulus_value, barrett_ratio,
             encrypted.data(i) + (j * coeff_count));
       } else {
         seal::util::multiply_poly_scalar_coeffmod(
             encrypted.data(i) + (j * coeff_count), coeff_count,
-            plaintext_vals[j], coeff_modulus[j],
+            encoded_value[j], coeff_modulus[j],
             encrypted.data(i) + (j * coeff_count));
       }
     }
@@ -400,8 +444,7 @@ size_t ngraph::he::match_to_smallest_chain_index(
                << smallest_chain_ind.second;
 
   auto smallest_cipher = *ciphers[smallest_chain_ind.first];
-#pragma omp parallel for
-  for (size_t cipher_idx = 0; cipher_idx < num_elements; ++cipher_idx) {
+  auto match_cipher = [&](size_t cipher_idx) {
     auto& cipher = *ciphers[cipher_idx];
     if (!cipher.known_value() && cipher_idx != smallest_chain_ind.second) {
       match_modulus_and_scale_inplace(smallest_cipher, cipher, he_seal_backend);
@@ -410,6 +453,178 @@ size_t ngraph::he::match_to_smallest_chain_index(
                    chain_ind, " does not match smallest ",
                    smallest_chain_ind.second);
     }
-  }
+  };
+  he_seal_backend.get_thread_pool().parallel_for(0, num_elements, match_cipher);
   return smallest_chain_ind.second;
 }
+
+size_t ngraph::he::lowest_chain_index(
+    const seal::Ciphertext& cipher,
+    const ngraph::he::HESealBackend& he_seal_backend, size_t headroom_bits) {
+  auto context_data =
+      he_seal_backend.get_context()->get_context_data(cipher.parms_id());
+  NGRAPH_CHECK(context_data != nullptr, "Cipher parms_id not in context");
+
+  double min_modulus_bits = std::log2(cipher.scale()) + headroom_bits;
+  for (auto next_context_data = context_data->next_context_data();
+       next_context_data != nullptr;
+       next_context_data = next_context_data->next_context_data()) {
+    if (next_context_data->total_coeff_modulus_bit_count() <
+        min_modulus_bits) {
+      break;
+    }
+    context_data = next_context_data;
+  }
+  return context_data->chain_index();
+}
+
+void ngraph::he::mod_switch_to_chain_index_inplace(
+    seal::Ciphertext& cipher, size_t chain_index,
+    const ngraph::he::HESealBackend& he_seal_backend,
+    seal::MemoryPoolHandle pool) {
+  auto context_data =
+      he_seal_backend.get_context()->get_context_data(cipher.parms_id());
+  NGRAPH_CHECK(context_data != nullptr, "Cipher parms_id not in context");
+
+  while (context_data->chain_index() > chain_index &&
+         context_data->next_context_data() != nullptr) {
+    context_data = context_data->next_context_data();
+  }
+  if (context_data->parms_id() != cipher.parms_id()) {
+    he_seal_backend.get_evaluator()->mod_switch_to_inplace(
+        cipher, context_data->parms_id(), pool);
+  }
+}
+
+namespace {
+inline uint32_t rotate_left(uint32_t value, int count) {
+  return (value << count) | (value >> (32 - count));
+}
+
+inline void quarter_round(std::array<uint32_t, 16>& x, size_t a, size_t b,
+                          size_t c, size_t d) {
+  x[a] += x[b];
+  x[d] = rotate_left(x[d] ^ x[a], 16);
+  x[c] += x[d];
+  x[b] = rotate_left(x[b] ^ x[c], 12);
+  x[a] += x[b];
+  x[d] = rotate_left(x[d] ^ x[a], 8);
+  x[c] += x[d];
+  x[b] = rotate_left(x[b] ^ x[c], 7);
+}
+}  // namespace
+
+ngraph::he::SeedGenerator::SeedGenerator(const std::array<uint32_t, 8>& key,
+                                         uint32_t counter,
+                                         const std::array<uint32_t, 3>& nonce)
+    : m_block{}, m_block_idx(m_block.size()) {
+  // "expand 32-byte k", key, block counter, nonce
+  m_state = {0x61707865, 0x3320646e, 0x79622d32, 0x6b206574,
+             key[0],     key[1],     key[2],     key[3],
+             key[4],     key[5],     key[6],     key[7],
+             counter,    nonce[0],   nonce[1],   nonce[2]};
+}
+
+ngraph::he::SeedGenerator::SeedGenerator(const SeededCiphertext::Seed& seed)
+    : SeedGenerator(
+          {static_cast<uint32_t>(seed[0]), static_cast<uint32_t>(seed[0] >> 32),
+           static_cast<uint32_t>(seed[1]), static_cast<uint32_t>(seed[1] >> 32),
+           static_cast<uint32_t>(seed[2]), static_cast<uint32_t>(seed[2] >> 32),
+           static_cast<uint32_t>(seed[3]),
+           static_cast<uint32_t>(seed[3] >> 32)},
+          0, {0, 0, 0}) {}
+
+uint32_t ngraph::he::SeedGenerator::generate() {
+  if (m_block_idx == m_block.size()) {
+    next_block();
+  }
+  return m_block[m_block_idx++];
+}
+
+void ngraph::he::SeedGenerator::next_block() {
+  m_block = m_state;
+  for (size_t round = 0; round < 10; ++round) {
+    quarter_round(m_block, 0, 4, 8, 12);
+    quarter_round(m_block, 1, 5, 9, 13);
+    quarter_round(m_block, 2, 6, 10, 14);
+    quarter_round(m_block, 3, 7, 11, 15);
+    quarter_round(m_block, 0, 5, 10, 15);
+    quarter_round(m_block, 1, 6, 11, 12);
+    quarter_round(m_block, 2, 7, 8, 13);
+    quarter_round(m_block, 3, 4, 9, 14);
+  }
+  for (size_t i = 0; i < m_block.size(); ++i) {
+    m_block[i] += m_state[i];
+  }
+  // The counter covers 256 GB of keystream, far beyond a polynomial
+  NGRAPH_CHECK(++m_state[12] != 0, "ChaCha20 block counter overflow");
+  m_block_idx = 0;
+}
+
+void ngraph::he::expand_seed(seal::Ciphertext& cipher,
+                             const std::shared_ptr<seal::SEALContext>& context,
+                             const SeededCiphertext::Seed& seed) {
+  auto context_data = context->get_context_data(cipher.parms_id());
+  NGRAPH_CHECK(context_data != nullptr, "Cipher parms_id not in context");
+  NGRAPH_CHECK(cipher.size() == 2, "Seeded ciphertext has size ",
+               cipher.size());
+  auto random = std::make_shared<ngraph::he::SeedGenerator>(seed);
+  seal::util::sample_poly_uniform(cipher.data(1), random,
+                                  context_data->parms());
+}
+
+void ngraph::he::encrypt_symmetric_seeded(
+    const seal::Plaintext& plain, const seal::SecretKey& secret_key,
+    const std::shared_ptr<seal::SEALContext>& context,
+    ngraph::he::SeededCiphertext& destination, seal::MemoryPoolHandle pool) {
+  NGRAPH_CHECK(plain.is_ntt_form(), "Plaintext must be in NTT form");
+  auto context_data = context->get_context_data(plain.parms_id());
+  NGRAPH_CHECK(context_data != nullptr, "Plain parms_id not in context");
+  const seal::EncryptionParameters& parms = context_data->parms();
+  const std::vector<seal::SmallModulus>& coeff_modulus = parms.coeff_modulus();
+  size_t coeff_count = parms.poly_modulus_degree();
+  size_t coeff_mod_count = coeff_modulus.size();
+
+  seal::Ciphertext& cipher = destination.ciphertext;
+  cipher.resize(context, plain.parms_id(), 2);
+  cipher.is_ntt_form() = true;
+  cipher.scale() = plain.scale();
+
+  // The seed and the noise are drawn from the generator SEAL uses for its
+  // own encryptions, so the noise cannot be derived from the seed
+  auto random_factory = parms.random_generator();
+  if (random_factory == nullptr) {
+    random_factory = seal::UniformRandomGeneratorFactory::default_factory();
+  }
+  auto random = random_factory->create();
+
+  // c1 = a, uniform from the seeded PRNG
+  for (uint64_t& seed_word : destination.seed) {
+    seed_word = static_cast<uint64_t>(random->generate()) |
+                (static_cast<uint64_t>(random->generate()) << 32);
+  }
+  expand_seed(cipher, context, destination.seed);
+
+  // e
+  auto noise = seal::util::allocate_poly(coeff_count, coeff_mod_count, pool);
+  seal::util::sample_poly_normal(noise.get(), random, parms);
+
+  // c0 = -(a * s) + e + m. The secret key is stored at the key level, whose
+  // first moduli are those of every data level
+  const uint64_t* secret_key_data = secret_key.data().data();
+  for (size_t mod_idx = 0; mod_idx < coeff_mod_count; ++mod_idx) {
+    size_t offset = mod_idx * coeff_count;
+    uint64_t* c0 = cipher.data(0) + offset;
+    seal::util::ntt_negacyclic_harvey(
+        noise.get() + offset, context_data->small_ntt_tables()[mod_idx]);
+    seal::util::dyadic_product_coeffmod(cipher.data(1) + offset,
+                                        secret_key_data + offset, coeff_count,
+                                        coeff_modulus[mod_idx], c0);
+    seal::util::negate_poly_coeffmod(c0, coeff_count, coeff_modulus[mod_idx],
+                                     c0);
+    seal::util::add_poly_poly_coeffmod(noise.get() + offset, c0, coeff_count,
+                                       coeff_modulus[mod_idx], c0);
+    seal::util::add_poly_poly_coeffmod(plain.data() + offset, c0, coeff_count,
+                                       coeff_modulus[mod_idx], c0);
+  }
+}
@@ -25,6 +25,7 @@
 #include "ngraph/check.hpp"
 #include "seal/he_seal_backend.hpp"
 #include "seal/seal.h"
+#include "seal/seal_ciphertext_wrapper.hpp"
 
 namespace ngraph {
 namespace he {
@@ -61,17 +62,40 @@ size_t match_to_smallest_chain_index(
     std::vector<std::shared_ptr<SealCiphertextWrapper>>& ciphers,
     const HESealBackend& he_seal_backend);
 
-template <typename S, typename T>
-inline bool within_rescale_tolerance(const S& arg0, const T& arg1,
-                                     double factor = 1.05) {
-  const auto scale0 = arg0.scale();
-  const auto scale1 = arg1.scale();
+// Number of bits by which the coefficient modulus of a ciphertext sent to the
+// client exceeds its scale, so values up to 2^(default_headroom_bits - 1) in
+// magnitude decrypt correctly
+constexpr size_t default_headroom_bits = 20;
+
+// Returns the chain index of the lowest level whose coefficient modulus
+// exceeds the cipher's scale by at least headroom_bits bits. Ciphertexts which
+// are only decrypted, e.g. those sent to the client, need no further levels,
+// and each level dropped removes one RNS limb from the serialized ciphertext
+size_t lowest_chain_index(const seal::Ciphertext& cipher,
+                          const HESealBackend& he_seal_backend,
+                          size_t headroom_bits = default_headroom_bits);
+
+// Mod-switches cipher down to chain_index. Ciphertexts at or below
+// chain_index are left unchanged
+void mod_switch_to_chain_index_inplace(
+    seal::Ciphertext& cipher, size_t chain_index,
+    const HESealBackend& he_seal_backend,
+    seal::MemoryPoolHandle pool = seal::MemoryManager::GetPool());
 
+inline bool within_rescale_tolerance(double scale0, double scale1,
+                                     double factor = 1.05) {
   bool within_tolerance =
       (scale0 / scale1 <= factor && scale1 / scale0 <= factor);
   return within_tolerance;
 }
 
+template <typename S, typename T>
+inline bool within_rescale_tolerance(const S& arg0, const T& arg1,
+                                     double factor = 1.05) {
+  return within_rescale_tolerance(static_cast<double>(arg0.scale()),
+                                  static_cast<double>(arg1.scale()), factor);
+}
+
 template <typename S, typename T>
 inline void match_scale(S& arg0, T& arg1,
                         const HESealBackend& he_seal_backend) {
@@ -87,6 +111,16 @@ void match_modulus_and_scale_inplace(
     const HESealBackend& he_seal_backend,
     seal::MemoryPoolHandle pool = seal::MemoryManager::GetPool());
 
+// Brings cipher down to parms_id, writing the result to destination, which may
+// be cipher itself. As match_modulus_and_scale_inplace would against an
+// operand at parms_id and scale, cipher is rescaled if its scale is not within
+// tolerance of scale and mod-switched otherwise
+void match_parms_id(
+    const SealCiphertextWrapper& cipher, SealCiphertextWrapper& destination,
+    const seal::parms_id_type& parms_id, double scale,
+    const HESealBackend& he_seal_backend,
+    seal::MemoryPoolHandle pool = seal::MemoryManager::GetPool());
+
 void encode(double value, double scale, seal::parms_id_type parms_id,
             std::vector<std::uint64_t>& destination,
             const HESealBackend& he_seal_backend,
@@ -95,6 +129,12 @@ void encode(double value, double scale, seal::parms_id_type parms_id,
 void add_plain_inplace(seal::Ciphertext& encrypted, double value,
                        const HESealBackend& he_seal_backend);
 
+// Like add_plain_inplace, where encoded_value is the output of encode() at the
+// scale and parms_id of encrypted
+void add_plain_inplace(seal::Ciphertext& encrypted,
+                       const std::uint64_t* encoded_value,
+                       const HESealBackend& he_seal_backend);
+
 inline void add_plain(const seal::Ciphertext& encrypted, double value,
                       seal::Ciphertext& destination,
                       const HESealBackend& he_seal_backend) {
@@ -153,6 +193,13 @@ void multiply_plain_inplace(
     const HESealBackend& he_seal_backend,
     seal::MemoryPoolHandle pool = seal::MemoryManager::GetPool());
 
+// Like multiply_plain_inplace, where encoded_value is the output of encode() at
+// the scale and parms_id of encrypted
+void multiply_plain_inplace(
+    seal::Ciphertext& encrypted, const std::uint64_t* encoded_value,
+    const HESealBackend& he_seal_backend,
+    seal::MemoryPoolHandle pool = seal::MemoryManager::GetPool());
+
 inline void multiply_plain(
     const seal::Ciphertext& encrypted, double value,
     seal::Ciphertext& destination, const HESealBackend& he_seal_backend,
@@ -161,5 +208,17 @@ inline void multiply_plain(
   ngraph::he::multiply_plain_inplace(destination, value, he_seal_backend,
                                      std::move(pool));
 }
+
+// Encrypts plain, which must be in NTT form, under secret_key, as SEAL's
+// symmetric encryption does. The second polynomial is expanded from a 256-bit
+// seed with SeedGenerator, so only the first polynomial and the seed need to
+// be sent. The seed and the noise come from the encryption parameters' random
+// generator. SEAL 3.3 has neither a seedable generator nor a compressed
+// symmetric encryption of its own
+void encrypt_symmetric_seeded(
+    const seal::Plaintext& plain, const seal::SecretKey& secret_key,
+    const std::shared_ptr<seal::SEALContext>& context,
+    SeededCiphertext& destination,
+    seal::MemoryPoolHandle pool = seal::MemoryManager::GetPool());
 }  // namespace he
 }  // namespace ngraph
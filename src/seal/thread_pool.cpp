@@ -0,0 +1,252 @@
+//*****************************************************************************
+// Copyright 2018-2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//*****************************************************************************
+
+#include <algorithm>
+#include <exception>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "ngraph/log.hpp"
+#include "seal/thread_pool.hpp"
+
+namespace {
+// Pool the calling thread is a worker of, if any
+thread_local ngraph::he::ThreadPool* t_worker_pool = nullptr;
+// Index of the calling thread within t_worker_pool
+thread_local size_t t_worker_idx = 0;
+// Limit set by ThreadPool::set_max_parallelism
+thread_local size_t t_max_parallelism = 0;
+}  // namespace
+
+ngraph::he::ThreadPool::ThreadPool(size_t num_threads, bool pin_threads) {
+  if (num_threads == 0) {
+    num_threads = std::max(std::thread::hardware_concurrency(), 1U);
+  }
+  for (size_t i = 0; i < num_threads; ++i) {
+    m_queues.emplace_back(std::make_unique<TaskQueue>());
+  }
+  for (size_t i = 0; i < num_threads; ++i) {
+    m_workers.emplace_back(&ThreadPool::worker_loop, this, i, pin_threads);
+  }
+}
+
+ngraph::he::ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> guard(m_sleep_mutex);
+    m_stop = true;
+  }
+  m_sleep_cond.notify_all();
+  for (std::thread& worker : m_workers) {
+    worker.join();
+  }
+}
+
+void ngraph::he::ThreadPool::worker_loop(size_t worker_idx, bool pin_thread) {
+  t_worker_pool = this;
+  t_worker_idx = worker_idx;
+
+#ifdef __linux__
+  if (pin_thread) {
+    size_t num_cpus = std::max(std::thread::hardware_concurrency(), 1U);
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    CPU_SET(worker_idx % num_cpus, &cpu_set);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpu_set) !=
+        0) {
+      NGRAPH_WARN << "Failed to pin worker thread " << worker_idx;
+    }
+  }
+#endif
+  // Create the thread's memory pool up front, rather than in the first task
+  memory_pool();
+
+  while (true) {
+    Task task;
+    if (try_get_task(task)) {
+      try {
+        task();
+      } catch (const std::exception& e) {
+        NGRAPH_ERR << "Thread pool task threw exception: " << e.what();
+      } catch (...) {
+        NGRAPH_ERR << "Thread pool task threw unknown exception";
+      }
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(m_sleep_mutex);
+    m_sleep_cond.wait(lock, [this] { return m_stop || m_pending_tasks > 0; });
+    if (m_stop && m_pending_tasks == 0) {
+      return;
+    }
+  }
+}
+
+void ngraph::he::ThreadPool::submit(Task task) {
+  {
+    std::lock_guard<std::mutex> guard(m_sleep_mutex);
+    m_pending_tasks++;
+  }
+  {
+    std::lock_guard<std::mutex> guard(m_submitted.mutex);
+    m_submitted.tasks.emplace_back(std::move(task));
+  }
+  m_sleep_cond.notify_one();
+}
+
+void ngraph::he::ThreadPool::submit_loop_task(Task task) {
+  // Workers push to their own queue, so nested work stays local; other
+  // threads spread tasks over all queues
+  size_t queue_idx = (t_worker_pool == this)
+                         ? t_worker_idx
+                         : m_next_queue++ % m_queues.size();
+  {
+    std::lock_guard<std::mutex> guard(m_sleep_mutex);
+    m_pending_tasks++;
+  }
+  {
+    std::lock_guard<std::mutex> guard(m_queues[queue_idx]->mutex);
+    m_queues[queue_idx]->tasks.emplace_back(std::move(task));
+  }
+  m_sleep_cond.notify_one();
+}
+
+bool ngraph::he::ThreadPool::try_get_task(Task& task) {
+  size_t queue_count = m_queues.size();
+  size_t own_idx = t_worker_idx;
+
+  // Own queue: newest task first, since its data is likely still in cache
+  {
+    TaskQueue& queue = *m_queues[own_idx];
+    std::lock_guard<std::mutex> guard(queue.mutex);
+    if (!queue.tasks.empty()) {
+      task = std::move(queue.tasks.back());
+      queue.tasks.pop_back();
+      m_pending_tasks--;
+      return true;
+    }
+  }
+  // Steal the oldest task of another queue
+  for (size_t offset = 1; offset < queue_count; ++offset) {
+    TaskQueue& queue = *m_queues[(own_idx + offset) % queue_count];
+    std::lock_guard<std::mutex> guard(queue.mutex);
+    if (!queue.tasks.empty()) {
+      task = std::move(queue.tasks.front());
+      queue.tasks.pop_front();
+      m_pending_tasks--;
+      return true;
+    }
+  }
+  // Submitted tasks start once running loops have no chunk left to hand out
+  std::lock_guard<std::mutex> guard(m_submitted.mutex);
+  if (!m_submitted.tasks.empty()) {
+    task = std::move(m_submitted.tasks.front());
+    m_submitted.tasks.pop_front();
+    m_pending_tasks--;
+    return true;
+  }
+  return false;
+}
+
+void ngraph::he::ThreadPool::parallel_for(
+    size_t begin, size_t end, const std::function<void(size_t)>& func) {
+  if (end <= begin) {
+    return;
+  }
+  size_t count = end - begin;
+  size_t max_parallelism =
+      (t_max_parallelism == 0) ? m_workers.size() + 1 : t_max_parallelism;
+  size_t helper_count = std::min(count, max_parallelism) - 1;
+  if (helper_count == 0) {
+    for (size_t i = begin; i < end; ++i) {
+      func(i);
+    }
+    return;
+  }
+
+  // Helpers may start after the loop has finished, so they only reference
+  // shared state, and only call func for indices they have claimed
+  struct LoopState {
+    std::atomic<size_t> next_idx;
+    size_t end_idx;
+    size_t grain_size;
+    const std::function<void(size_t)>* func;
+    std::mutex mutex;
+    std::condition_variable done_cond;
+    size_t done_count{0};
+    std::exception_ptr error{nullptr};
+  };
+  auto state = std::make_shared<LoopState>();
+  state->next_idx = begin;
+  state->end_idx = end;
+  // Several chunks per thread, to balance uneven iterations
+  state->grain_size = std::max(count / ((helper_count + 1) * 4), size_t(1));
+  state->func = &func;
+
+  auto run_chunks = [state, count]() {
+    while (true) {
+      size_t chunk_begin = state->next_idx.fetch_add(state->grain_size);
+      if (chunk_begin >= state->end_idx) {
+        return;
+      }
+      size_t chunk_end =
+          std::min(chunk_begin + state->grain_size, state->end_idx);
+      std::exception_ptr error = nullptr;
+      for (size_t i = chunk_begin; i < chunk_end; ++i) {
+        try {
+          (*state->func)(i);
+        } catch (...) {
+          if (error == nullptr) {
+            error = std::current_exception();
+          }
+        }
+      }
+      std::lock_guard<std::mutex> guard(state->mutex);
+      if (error != nullptr && state->error == nullptr) {
+        state->error = error;
+      }
+      state->done_count += chunk_end - chunk_begin;
+      if (state->done_count == count) {
+        state->done_cond.notify_all();
+      }
+    }
+  };
+
+  for (size_t i = 0; i < helper_count; ++i) {
+    submit_loop_task(run_chunks);
+  }
+  // Every chunk is claimed once this returns. Chunks claimed by other threads
+  // are running, so waiting for them cannot deadlock
+  run_chunks();
+  std::unique_lock<std::mutex> lock(state->mutex);
+  state->done_cond.wait(lock,
+                        [&state, count] { return state->done_count == count; });
+  if (state->error != nullptr) {
+    std::rethrow_exception(state->error);
+  }
+}
+
+void ngraph::he::ThreadPool::set_max_parallelism(size_t max_parallelism) {
+  t_max_parallelism = max_parallelism;
+}
+
+size_t ngraph::he::ThreadPool::max_parallelism() { return t_max_parallelism; }
+
+seal::MemoryPoolHandle ngraph::he::ThreadPool::memory_pool() {
+  thread_local seal::MemoryPoolHandle pool = seal::MemoryPoolHandle::New();
+  return pool;
+}
@@ -0,0 +1,105 @@
+//*****************************************************************************
+// Copyright 2018-2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//*****************************************************************************
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "seal/seal.h"
+
+namespace ngraph {
+namespace he {
+/// \brief Persistent work-stealing thread pool. Each worker owns a queue of
+/// parallel_for chunks; it runs its own chunks newest first and steals the
+/// oldest chunks of other workers when idle. Tasks passed to submit() are kept
+/// in a separate queue, which workers serve once no chunk is pending. A thread
+/// waiting in parallel_for only runs chunks of its own loop, then blocks until
+/// the loop completes, so it never picks up an unrelated task.
+class ThreadPool {
+ public:
+  using Task = std::function<void()>;
+
+  /// @brief Constructs a thread pool
+  /// @param num_threads Number of worker threads. If 0, uses the number of
+  /// hardware threads
+  /// @param pin_threads Whether to pin each worker thread to a single CPU
+  explicit ThreadPool(size_t num_threads = 0, bool pin_threads = false);
+
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  /// @brief Returns the number of worker threads
+  size_t num_threads() const { return m_workers.size(); }
+
+  /// @brief Schedules task for asynchronous execution. Tasks should not throw
+  void submit(Task task);
+
+  /// @brief Calls func(i) for every i in [begin, end) in parallel. The calling
+  /// thread takes part, and returns once every call has finished
+  /// @throws The first exception thrown by func
+  void parallel_for(size_t begin, size_t end,
+                    const std::function<void(size_t)>& func);
+
+  /// @brief Limits the number of threads used by parallel_for calls made from
+  /// the calling thread, including the calling thread itself
+  /// @param max_parallelism Maximum number of threads. 0 removes the limit
+  static void set_max_parallelism(size_t max_parallelism);
+
+  /// @brief Returns the limit set on the calling thread, 0 if none
+  static size_t max_parallelism();
+
+  /// @brief Returns a SEAL memory pool owned by the calling thread. The pool
+  /// is created on first use and reused by all later tasks on the thread
+  static seal::MemoryPoolHandle memory_pool();
+
+ private:
+  struct TaskQueue {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  void worker_loop(size_t worker_idx, bool pin_thread);
+
+  // Queues a parallel_for chunk task, on the calling worker's own queue if any
+  void submit_loop_task(Task task);
+
+  // Pops a chunk task from the calling worker's own queue, or steals one from
+  // another queue. Failing that, pops a submitted task
+  bool try_get_task(Task& task);
+
+  // Queues of parallel_for chunk tasks, one per worker
+  std::vector<std::unique_ptr<TaskQueue>> m_queues;
+  // Tasks passed to submit(), in order
+  TaskQueue m_submitted;
+  std::vector<std::thread> m_workers;
+
+  std::mutex m_sleep_mutex;
+  std::condition_variable m_sleep_cond;
+  std::atomic<size_t> m_pending_tasks{0};
+  std::atomic<size_t> m_next_queue{0};
+  std::atomic<bool> m_stop{false};
+};
+}  // namespace he
+}  // namespace ngraph
@@ -16,7 +16,13 @@
 
 #pragma once
 
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
 #include <complex>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
 #include <string>
 #include <unordered_set>
 #include <vector>
@@ -84,6 +90,26 @@ static inline void real_vec_to_complex_vec(
   }
 }
 
+// Returns the row-major index of the element at position stream_idx when the
+// elements of a tensor of the given shape (of rank at least 3) are streamed in
+// spatial order, i.e. row by row along axis 2. Each row holds the elements of
+// all batches and channels at that row, so a convolution can start on a row
+// once all rows in its receptive field have been streamed
+static inline size_t spatial_stream_index(size_t stream_idx,
+                                          const std::vector<size_t>& shape) {
+  NGRAPH_CHECK(shape.size() >= 3, "Cannot stream tensor of rank ",
+               shape.size(), " in spatial order");
+  size_t outer_size = shape[0] * shape[1];
+  size_t inner_size = 1;
+  for (size_t axis = 3; axis < shape.size(); ++axis) {
+    inner_size *= shape[axis];
+  }
+  size_t row = stream_idx / (outer_size * inner_size);
+  size_t outer_idx = (stream_idx / inner_size) % outer_size;
+  size_t inner_idx = stream_idx % inner_size;
+  return (outer_idx * shape[2] + row) * inner_size + inner_idx;
+}
+
 static inline bool flag_to_bool(const char* flag, bool default_value = false) {
   if (flag == nullptr) {
     return default_value;
@@ -100,5 +126,26 @@ static inline bool flag_to_bool(const char* flag, bool default_value = false) {
     throw ngraph_error("Unknown flag value " + std::string(flag));
   }
 }
+
+// Returns the value of environment variable name, which must be a positive
+// integer, or default_value if it is not set
+static inline size_t positive_size_from_env(const char* name,
+                                            size_t default_value) {
+  const char* value_str = std::getenv(name);
+  if (value_str == nullptr) {
+    return default_value;
+  }
+  bool is_number =
+      value_str[0] != '\0' &&
+      std::all_of(value_str, value_str + std::strlen(value_str),
+                  [](char c) { return std::isdigit(c) != 0; });
+  errno = 0;
+  unsigned long long value =
+      is_number ? std::strtoull(value_str, nullptr, 10) : 0;
+  NGRAPH_CHECK(is_number && errno == 0 && value > 0 &&
+                   value <= std::numeric_limits<size_t>::max(),
+               name, " must be a positive integer, got \"", value_str, "\"");
+  return static_cast<size_t>(value);
+}
 }  // namespace he
 }  // namespace ngraph
\ No newline at end of file
@@ -0,0 +1,140 @@
+//*****************************************************************************
+// Copyright 2018-2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//*****************************************************************************
+
+#include <utility>
+
+#include "ngraph/check.hpp"
+#include "seal/seal_util.hpp"
+#include "seal/thread_pool.hpp"
+#include "seal/util/polyarithsmallmod.h"
+#include "seal/zero_ciphertext_pool.hpp"
+
+ngraph::he::ZeroCiphertextPool::ZeroCiphertextPool(
+    std::shared_ptr<seal::SEALContext> context,
+    std::shared_ptr<seal::SecretKey> secret_key, size_t capacity)
+    : m_context(std::move(context)),
+      m_secret_key(std::move(secret_key)),
+      m_capacity(capacity) {
+  if (m_capacity > 0) {
+    m_fill_thread = std::thread([this]() { fill_levels(); });
+  }
+}
+
+ngraph::he::ZeroCiphertextPool::~ZeroCiphertextPool() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stopped = true;
+  }
+  m_fill_cond.notify_all();
+  if (m_fill_thread.joinable()) {
+    m_fill_thread.join();
+  }
+}
+
+void ngraph::he::ZeroCiphertextPool::add_level(
+    const seal::parms_id_type& parms_id) {
+  NGRAPH_CHECK(m_context->get_context_data(parms_id) != nullptr,
+               "parms_id not in context");
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_zeros[parms_id];
+  }
+  m_fill_cond.notify_all();
+}
+
+void ngraph::he::ZeroCiphertextPool::encrypt(const seal::Plaintext& plain,
+                                             SeededCiphertext& destination,
+                                             seal::MemoryPoolHandle pool) {
+  NGRAPH_CHECK(plain.is_ntt_form(), "Plaintext must be in NTT form");
+  auto context_data = m_context->get_context_data(plain.parms_id());
+  NGRAPH_CHECK(context_data != nullptr, "Plain parms_id not in context");
+  bool from_pool = false;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto& zeros = m_zeros[plain.parms_id()];
+    if (!zeros.empty()) {
+      destination = std::move(zeros.front());
+      zeros.pop_front();
+      from_pool = true;
+    }
+  }
+  // Refills the level, or starts filling a new level
+  m_fill_cond.notify_all();
+
+  if (!from_pool) {
+    encrypt_symmetric_seeded(plain, *m_secret_key, m_context, destination,
+                             std::move(pool));
+    return;
+  }
+
+  // c0 = -(a * s) + e + m
+  const seal::EncryptionParameters& parms = context_data->parms();
+  const std::vector<seal::SmallModulus>& coeff_modulus = parms.coeff_modulus();
+  size_t coeff_count = parms.poly_modulus_degree();
+  seal::Ciphertext& cipher = destination.ciphertext;
+  cipher.scale() = plain.scale();
+  for (size_t mod_idx = 0; mod_idx < coeff_modulus.size(); ++mod_idx) {
+    size_t offset = mod_idx * coeff_count;
+    seal::util::add_poly_poly_coeffmod(cipher.data(0) + offset,
+                                       plain.data() + offset, coeff_count,
+                                       coeff_modulus[mod_idx],
+                                       cipher.data(0) + offset);
+  }
+}
+
+size_t ngraph::he::ZeroCiphertextPool::size(
+    const seal::parms_id_type& parms_id) const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto it = m_zeros.find(parms_id);
+  return it == m_zeros.end() ? 0 : it->second.size();
+}
+
+void ngraph::he::ZeroCiphertextPool::fill_levels() {
+  while (true) {
+    seal::parms_id_type parms_id;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      auto find_level = [this, &parms_id]() {
+        for (const auto& level : m_zeros) {
+          if (level.second.size() < m_capacity) {
+            parms_id = level.first;
+            return true;
+          }
+        }
+        return false;
+      };
+      m_fill_cond.wait(
+          lock, [this, &find_level]() { return m_stopped || find_level(); });
+      if (m_stopped) {
+        return;
+      }
+    }
+
+    auto context_data = m_context->get_context_data(parms_id);
+    const seal::EncryptionParameters& parms = context_data->parms();
+    seal::MemoryPoolHandle pool = ThreadPool::memory_pool();
+    seal::Plaintext zero(
+        parms.poly_modulus_degree() * parms.coeff_modulus().size(), pool);
+    zero.parms_id() = parms_id;
+    zero.scale() = 1.0;
+
+    SeededCiphertext cipher;
+    encrypt_symmetric_seeded(zero, *m_secret_key, m_context, cipher, pool);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_zeros[parms_id].emplace_back(std::move(cipher));
+  }
+}
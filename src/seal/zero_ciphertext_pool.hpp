@@ -0,0 +1,80 @@
+//*****************************************************************************
+// Copyright 2018-2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//*****************************************************************************
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "seal/seal.h"
+#include "seal/seal_ciphertext_wrapper.hpp"
+
+namespace ngraph {
+namespace he {
+/// \brief Fresh seeded encryptions of zero under a secret key, kept per level
+/// and refilled by a background thread. Encrypting a plaintext then adds it
+/// to a pooled encryption of zero, so sampling the randomness and the noise
+/// NTTs happen off the critical path. Each encryption of zero is used once.
+class ZeroCiphertextPool {
+ public:
+  /// @param capacity Maximum number of encryptions of zero kept per level. If
+  /// 0, encrypt() always encrypts directly
+  ZeroCiphertextPool(std::shared_ptr<seal::SEALContext> context,
+                     std::shared_ptr<seal::SecretKey> secret_key,
+                     size_t capacity);
+
+  ~ZeroCiphertextPool();
+
+  ZeroCiphertextPool(const ZeroCiphertextPool&) = delete;
+  ZeroCiphertextPool& operator=(const ZeroCiphertextPool&) = delete;
+
+  /// @brief Starts keeping encryptions of zero at the level of parms_id.
+  /// Levels are also added on their first encrypt() call
+  void add_level(const seal::parms_id_type& parms_id);
+
+  /// @brief Encrypts plain, which must be in NTT form, like
+  /// encrypt_symmetric_seeded(). Uses a pooled encryption of zero at the level
+  /// of plain if one is available. Thread-safe
+  void encrypt(const seal::Plaintext& plain, SeededCiphertext& destination,
+               seal::MemoryPoolHandle pool);
+
+  /// @brief Returns the number of encryptions of zero available at the level
+  /// of parms_id
+  size_t size(const seal::parms_id_type& parms_id) const;
+
+  size_t capacity() const { return m_capacity; }
+
+ private:
+  // Encrypts zeros until every level is full, on m_fill_thread
+  void fill_levels();
+
+  std::shared_ptr<seal::SEALContext> m_context;
+  std::shared_ptr<seal::SecretKey> m_secret_key;
+  size_t m_capacity;
+
+  std::map<seal::parms_id_type, std::deque<SeededCiphertext>> m_zeros;
+  mutable std::mutex m_mutex;
+  // Signals that a level is no longer full, or that the pool is destroyed
+  std::condition_variable m_fill_cond;
+  bool m_stopped{false};
+  std::thread m_fill_thread;
+};
+}  // namespace he
+}  // namespace ngraph
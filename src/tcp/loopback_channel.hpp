@@ -0,0 +1,147 @@
+//*****************************************************************************
+// Copyright 2018-2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//*****************************************************************************
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#include "ngraph/check.hpp"
+#include "tcp/message_channel.hpp"
+#include "tcp/tcp_message.hpp"
+
+namespace ngraph {
+namespace he {
+/// \brief One end of an in-process connection. Messages written to one end
+/// are moved, without serialization to a socket, to the other end, which
+/// passes them to its message handler on a delivery thread in the order they
+/// were written
+class LoopbackChannel : public MessageChannel {
+ public:
+  LoopbackChannel()
+      : m_inbox(std::make_shared<Inbox>()),
+        m_stopped(std::make_shared<std::atomic<bool>>(false)) {}
+
+  LoopbackChannel(const LoopbackChannel&) = delete;
+  LoopbackChannel& operator=(const LoopbackChannel&) = delete;
+
+  ~LoopbackChannel() override {
+    // Messages not yet delivered are discarded
+    *m_stopped = true;
+    m_inbox->close();
+    if (m_delivery_thread.joinable()) {
+      if (m_delivery_thread.get_id() == std::this_thread::get_id()) {
+        m_delivery_thread.detach();
+      } else {
+        m_delivery_thread.join();
+      }
+    }
+  }
+
+  /// @brief Returns two connected ends
+  static std::pair<std::shared_ptr<LoopbackChannel>,
+                   std::shared_ptr<LoopbackChannel>>
+  create_pair() {
+    auto first = std::make_shared<LoopbackChannel>();
+    auto second = std::make_shared<LoopbackChannel>();
+    first->m_peer_inbox = second->m_inbox;
+    second->m_peer_inbox = first->m_inbox;
+    return std::make_pair(first, second);
+  }
+
+  /// @brief Starts passing received messages to message_handler. Messages
+  /// received before start() are delivered once it is called
+  void start(MessageHandler message_handler) {
+    NGRAPH_CHECK(!m_delivery_thread.joinable(), "Channel already started");
+    // The delivery thread does not access this end, which it may destroy
+    m_delivery_thread =
+        std::thread([inbox = m_inbox, stopped = m_stopped,
+                     message_handler = std::move(message_handler)]() {
+          TCPMessage message;
+          while (inbox->pop(message) && !*stopped) {
+            message_handler(std::move(message));
+          }
+        });
+  }
+
+  void write_message(TCPMessage&& message) override {
+    NGRAPH_CHECK(m_peer_inbox != nullptr, "Channel is not connected");
+    m_peer_inbox->push(std::move(message));
+  }
+
+  /// @brief Stops both ends once they delivered the messages already written
+  void close() override {
+    m_inbox->close();
+    if (m_peer_inbox != nullptr) {
+      m_peer_inbox->close();
+    }
+  }
+
+ private:
+  // Received messages. Shared with the peer, which may outlive this end
+  class Inbox {
+   public:
+    void push(TCPMessage&& message) {
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_closed) {
+          return;
+        }
+        m_messages.emplace_back(std::move(message));
+      }
+      m_cond.notify_one();
+    }
+
+    // Returns false once closed and empty
+    bool pop(TCPMessage& message) {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_cond.wait(lock, [this]() { return !m_messages.empty() || m_closed; });
+      if (m_messages.empty()) {
+        return false;
+      }
+      message = std::move(m_messages.front());
+      m_messages.pop_front();
+      return true;
+    }
+
+    void close() {
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_closed = true;
+      }
+      m_cond.notify_all();
+    }
+
+   private:
+    std::deque<TCPMessage> m_messages;
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    bool m_closed{false};
+  };
+
+  std::shared_ptr<Inbox> m_inbox;
+  std::shared_ptr<Inbox> m_peer_inbox;
+  std::thread m_delivery_thread;
+  std::shared_ptr<std::atomic<bool>> m_stopped;
+};
+}  // namespace he
+}  // namespace ngraph
@@ -0,0 +1,148 @@
+//*****************************************************************************
+// Copyright 2018-2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//*****************************************************************************
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "ngraph/util.hpp"
+
+namespace ngraph {
+namespace he {
+/// \brief Thread-safe cache of message buffers. Released buffers are kept and
+/// handed out again for requests of similar size, so repeated round trips
+/// reuse memory which has already been faulted in. The cache is bounded, and
+/// emptied with trim() once a round of messages ends
+class MessageBufferPool {
+ public:
+  /// @brief Buffer sizes are rounded up to a multiple of the granularity
+  enum { granularity = 4096 };
+
+  /// @brief Maximum total size of cached free buffers of the global pool,
+  /// unless set by NGRAPH_HE_MESSAGE_POOL_BYTES
+  enum { default_max_cached_bytes = 64UL << 20 };
+
+  /// @param max_cached_bytes Maximum total size of cached free buffers.
+  /// Buffers released beyond this limit are freed
+  explicit MessageBufferPool(
+      size_t max_cached_bytes = default_max_cached_bytes)
+      : m_max_cached_bytes(max_cached_bytes) {}
+
+  ~MessageBufferPool() {
+    for (auto& entry : m_free_buffers) {
+      ngraph_free(entry.second);
+    }
+  }
+
+  MessageBufferPool(const MessageBufferPool&) = delete;
+  MessageBufferPool& operator=(const MessageBufferPool&) = delete;
+
+  /// @brief Returns a buffer of at least size bytes
+  /// @param[out] capacity Actual size of the returned buffer, which must be
+  /// passed to release()
+  char* acquire(size_t size, size_t& capacity) {
+    size_t rounded_size = round_up(size);
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      // Smallest cached buffer which fits, unless it wastes more than half
+      auto it = m_free_buffers.lower_bound(rounded_size);
+      if (it != m_free_buffers.end() && it->first / 2 <= rounded_size) {
+        capacity = it->first;
+        char* buffer = it->second;
+        m_cached_bytes -= capacity;
+        m_free_buffers.erase(it);
+        return buffer;
+      }
+    }
+    capacity = rounded_size;
+    return static_cast<char*>(ngraph_malloc(capacity));
+  }
+
+  /// @brief Returns a buffer obtained from acquire() to the pool
+  void release(char* buffer, size_t capacity) {
+    if (buffer == nullptr) {
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if (m_cached_bytes + capacity <= m_max_cached_bytes) {
+        m_free_buffers.emplace(capacity, buffer);
+        m_cached_bytes += capacity;
+        return;
+      }
+    }
+    ngraph_free(buffer);
+  }
+
+  /// @brief Frees cached buffers, largest first, until at most max_bytes are
+  /// cached. Called once a round of messages ends, so idle buffers do not
+  /// hold memory between rounds
+  void trim(size_t max_bytes = 0) {
+    std::vector<char*> buffers;
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      while (m_cached_bytes > max_bytes && !m_free_buffers.empty()) {
+        auto it = std::prev(m_free_buffers.end());
+        m_cached_bytes -= it->first;
+        buffers.emplace_back(it->second);
+        m_free_buffers.erase(it);
+      }
+    }
+    for (char* buffer : buffers) {
+      ngraph_free(buffer);
+    }
+  }
+
+  /// @brief Returns the total size of cached free buffers
+  size_t cached_bytes() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_cached_bytes;
+  }
+
+  /// @brief Returns the pool shared by all messages of the process
+  static const std::shared_ptr<MessageBufferPool>& global() {
+    static std::shared_ptr<MessageBufferPool> pool = [] {
+      size_t max_cached_bytes = default_max_cached_bytes;
+      if (const char* bytes_str = std::getenv("NGRAPH_HE_MESSAGE_POOL_BYTES")) {
+        max_cached_bytes = std::stoul(bytes_str);
+      }
+      return std::make_shared<MessageBufferPool>(max_cached_bytes);
+    }();
+    return pool;
+  }
+
+ private:
+  static size_t round_up(size_t size) {
+    return ((std::max(size, size_t(1)) + granularity - 1) / granularity) *
+           granularity;
+  }
+
+  mutable std::mutex m_mutex;
+  // Free buffers by capacity
+  std::multimap<size_t, char*> m_free_buffers;
+  size_t m_cached_bytes{0};
+  size_t m_max_cached_bytes;
+};
+}  // namespace he
+}  // namespace ngraph
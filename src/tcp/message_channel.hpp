@@ -0,0 +1,42 @@
+//*****************************************************************************
+// Copyright 2018-2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//*****************************************************************************
+
+#pragma once
+
+#include <functional>
+
+#include "tcp/tcp_message.hpp"
+
+namespace ngraph {
+namespace he {
+/// \brief Connection between the server and the client, independent of how
+/// messages are transported
+class MessageChannel {
+ public:
+  /// @brief Handles a received message, which it takes ownership of
+  using MessageHandler = std::function<void(TCPMessage&&)>;
+
+  virtual ~MessageChannel() = default;
+
+  /// @brief Queues message for delivery to the peer. Thread-safe. Messages
+  /// are delivered in the order they are written
+  virtual void write_message(TCPMessage&& message) = 0;
+
+  /// @brief Closes the connection
+  virtual void close() = 0;
+};
+}  // namespace he
+}  // namespace ngraph
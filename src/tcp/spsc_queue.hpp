@@ -0,0 +1,116 @@
+//*****************************************************************************
+// Copyright 2018-2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//*****************************************************************************
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+namespace ngraph {
+namespace he {
+/// \brief Bounded lock-free queue with a single producer thread and a single
+/// consumer thread. Pushing and popping only use atomics; a mutex is taken
+/// only to wake a consumer blocked in pop() on an empty queue
+template <typename T>
+class SPSCQueue {
+ public:
+  /// @param capacity Maximum number of items in the queue
+  explicit SPSCQueue(size_t capacity) : m_slots(capacity + 1) {}
+
+  SPSCQueue(const SPSCQueue&) = delete;
+  SPSCQueue& operator=(const SPSCQueue&) = delete;
+
+  /// @brief Appends item to the queue. Must only be called by the producer
+  /// @return false if the queue is full, in which case item is unchanged
+  bool try_push(T&& item) {
+    size_t tail = m_tail.load(std::memory_order_relaxed);
+    size_t next_tail = increment(tail);
+    if (next_tail == m_head.load(std::memory_order_acquire)) {
+      return false;
+    }
+    m_slots[tail] = std::move(item);
+    m_tail.store(next_tail);
+
+    if (m_consumer_waiting.load()) {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_cond.notify_one();
+    }
+    return true;
+  }
+
+  /// @brief Removes the oldest item of the queue. Must only be called by the
+  /// consumer
+  /// @return false if the queue is empty, in which case item is unchanged
+  bool try_pop(T& item) {
+    size_t head = m_head.load(std::memory_order_relaxed);
+    if (head == m_tail.load(std::memory_order_acquire)) {
+      return false;
+    }
+    item = std::move(m_slots[head]);
+    m_head.store(increment(head), std::memory_order_release);
+    return true;
+  }
+
+  /// @brief Removes the oldest item of the queue, blocking until an item is
+  /// pushed if the queue is empty. Must only be called by the consumer
+  /// @return false if the queue is empty and has been closed
+  bool pop(T& item) {
+    if (try_pop(item)) {
+      return true;
+    }
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_consumer_waiting.store(true);
+    m_cond.wait(lock, [this]() { return !empty() || m_closed; });
+    m_consumer_waiting.store(false);
+    return try_pop(item);
+  }
+
+  /// @brief Wakes the consumer once the queue is empty
+  void close() {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_closed = true;
+    }
+    m_cond.notify_all();
+  }
+
+  bool empty() const { return m_head.load() == m_tail.load(); }
+
+  bool full() const { return increment(m_tail.load()) == m_head.load(); }
+
+  size_t capacity() const { return m_slots.size() - 1; }
+
+ private:
+  size_t increment(size_t index) const {
+    return index + 1 == m_slots.size() ? 0 : index + 1;
+  }
+
+  std::vector<T> m_slots;
+  // Next slot to pop, written by the consumer
+  std::atomic<size_t> m_head{0};
+  // Next slot to push, written by the producer
+  std::atomic<size_t> m_tail{0};
+
+  std::atomic<bool> m_consumer_waiting{false};
+  std::mutex m_mutex;
+  std::condition_variable m_cond;
+  bool m_closed{false};
+};
+}  // namespace he
+}  // namespace ngraph
@@ -21,38 +21,44 @@
 #include <deque>
 #include <iostream>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <thread>
 
 #include "ngraph/log.hpp"
 
+#include "tcp/message_channel.hpp"
 #include "tcp/tcp_message.hpp"
+#include "tcp/transport.hpp"
 
 using boost::asio::ip::tcp;
 
 namespace ngraph {
 namespace he {
-class TCPClient {
+class TCPClient : public MessageChannel {
  public:
-  // Connects client to hostname:port and reads message
+  // Connects client to the first reachable endpoint and reads message
   // message_handler will handle responses from the server
   TCPClient(boost::asio::io_context& io_context,
-            const tcp::resolver::results_type& endpoints,
-            std::function<void(const ngraph::he::TCPMessage&)> message_handler)
+            std::vector<stream_protocol::endpoint> endpoints,
+            MessageHandler message_handler)
       : m_io_context(io_context),
         m_socket(io_context),
+        m_endpoints(std::move(endpoints)),
         m_first_connect(true),
-        m_message_callback(std::bind(message_handler, std::placeholders::_1)) {
-    do_connect(endpoints);
+        m_message_callback(std::move(message_handler)) {
+    do_connect();
   }
 
-  void close() {
+  void close() override {
     NGRAPH_INFO << "Closing socket";
-    m_socket.shutdown(boost::asio::ip::tcp::socket::shutdown_both);
+    m_socket.shutdown(stream_protocol::socket::shutdown_both);
     boost::asio::post(m_io_context, [this]() { m_socket.close(); });
   }
 
-  void write_message(ngraph::he::TCPMessage&& message) {
+  // Thread-safe. Messages are written in the order they are queued
+  void write_message(ngraph::he::TCPMessage&& message) override {
+    std::lock_guard<std::mutex> lock(m_write_mutex);
     bool write_in_progress = !m_message_queue.empty();
     m_message_queue.emplace_back(std::move(message));
     if (!write_in_progress) {
@@ -61,12 +67,11 @@ class TCPClient {
   }
 
  private:
-  void do_connect(const tcp::resolver::results_type& endpoints,
-                  size_t delay_ms = 10) {
+  void do_connect(size_t delay_ms = 10) {
     boost::asio::async_connect(
-        m_socket, endpoints,
-        [this, delay_ms, &endpoints](boost::system::error_code ec,
-                                     tcp::endpoint) {
+        m_socket, m_endpoints,
+        [this, delay_ms](boost::system::error_code ec,
+                         const stream_protocol::endpoint&) {
           if (!ec) {
             NGRAPH_INFO << "Connected to server";
             do_read_header();
@@ -81,7 +86,7 @@ class TCPClient {
               new_delay_ms *= 2;
             }
             NGRAPH_INFO << "Trying to connect again";
-            do_connect(std::move(endpoints), new_delay_ms);
+            do_connect(new_delay_ms);
           }
         });
   }
@@ -111,7 +116,8 @@ class TCPClient {
         [this](boost::system::error_code ec, std::size_t length) {
           if (!ec) {
             m_read_message.decode_body();
-            m_message_callback(m_read_message);
+            m_message_callback(std::move(m_read_message));
+            m_read_message = TCPMessage();
             do_read_header();
           } else {
             // End of file is expected on teardown
@@ -123,14 +129,24 @@ class TCPClient {
   }
 
   void do_write() {
+    const TCPMessage* message;
+    {
+      // References to deque elements stay valid on emplace_back
+      std::lock_guard<std::mutex> lock(m_write_mutex);
+      message = &m_message_queue.front();
+    }
     boost::asio::async_write(
         m_socket,
-        boost::asio::buffer(m_message_queue.front().header_ptr(),
-                            m_message_queue.front().num_bytes()),
+        boost::asio::buffer(message->header_ptr(), message->num_bytes()),
         [this](boost::system::error_code ec, std::size_t length) {
           if (!ec) {
-            m_message_queue.pop_front();
-            if (!m_message_queue.empty()) {
+            bool write_next;
+            {
+              std::lock_guard<std::mutex> lock(m_write_mutex);
+              m_message_queue.pop_front();
+              write_next = !m_message_queue.empty();
+            }
+            if (write_next) {
               do_write();
             }
           } else {
@@ -140,15 +156,17 @@ class TCPClient {
   }
 
   boost::asio::io_context& m_io_context;
-  tcp::socket m_socket;
+  stream_protocol::socket m_socket;
+  std::vector<stream_protocol::endpoint> m_endpoints;
 
   TCPMessage m_read_message;
   std::deque<ngraph::he::TCPMessage> m_message_queue;
+  std::mutex m_write_mutex;
 
   bool m_first_connect;
 
   // How to handle the message
-  std::function<void(const ngraph::he::TCPMessage&)> m_message_callback;
+  MessageHandler m_message_callback;
 };
 }  // namespace he
 }  // namespace ngraph
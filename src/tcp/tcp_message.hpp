@@ -18,7 +18,9 @@
 
 #include <assert.h>
 #include <algorithm>
+#include <cstdint>
 #include <cstring>
+#include <functional>
 #include <iostream>
 #include <memory>
 #include <set>
@@ -30,6 +32,8 @@
 #include "ngraph/util.hpp"
 #include "seal/seal.h"
 #include "seal/seal_ciphertext_wrapper.hpp"
+#include "seal/thread_pool.hpp"
+#include "tcp/message_buffer_pool.hpp"
 
 namespace ngraph {
 namespace he {
@@ -38,6 +42,8 @@ enum class MessageType {
   encryption_parameters,
   eval_key,
   execute,
+  key_id,
+  key_request,
   max_request,
   max_result,
   minimum_request,
@@ -69,6 +75,12 @@ inline std::string message_type_to_string(const MessageType& type) {
     case MessageType::execute:
       return "execute";
       break;
+    case MessageType::key_id:
+      return "key_id";
+      break;
+    case MessageType::key_request:
+      return "key_request";
+      break;
     case MessageType::minimum_request:
       return "minimum_request";
       break;
@@ -108,21 +120,50 @@ inline std::string message_type_to_string(const MessageType& type) {
 }
 
 // @brief Describes TCP messages of the form:
-// header        | message_type | count        | data  |
-// ^- header_ptr   ^- body_ptr    ^- count_ptr   ^- data_ptr
-//               | ---------------  body  ------------ |
+// header | type | request_id | result_chain_index | frame | count | data
+//        | -------------------------  body  ------------------------- |
+// Each part starts at the pointer of the same name, e.g. frame_ptr(). The body,
+// which starts with the message type, starts at body_ptr()
+// request_id identifies the request a result message answers. It is 0 for
+// messages which are not part of a request / result pair
+// result_chain_index is the chain index at which the ciphertexts of the
+// result answering a request message are expected. It is 0 for other messages
+// frame holds the element offset and total element count of the logical
+// message. Large logical messages are sent as a sequence of frames (see
+// encode_frames()), each holding count elements starting at element_offset,
+// so neither side holds the whole message in one buffer. Messages sent as a
+// single frame have element_offset 0 and total_count equal to count
+// Messages carrying ciphertexts store them as a ciphertext batch, whose
+// header precedes the elements
 // @param count number of elements of data
-// @param size number of bytes of data in message. Must be a multiple of
-// count
+// @param size number of bytes of data in message. Apart from the batch
+// header, must be a multiple of count
 class TCPMessage {
  public:
   enum { header_length = 15 };
-  enum { max_body_length = 39900000000UL };
-  enum { default_body_length = 400000000UL };
   enum { message_type_length = sizeof(MessageType) };
+  enum { message_request_id_length = sizeof(uint64_t) };
+  enum { message_result_chain_index_length = sizeof(uint64_t) };
+  enum { message_frame_length = 2 * sizeof(uint64_t) };
   enum { message_count_length = sizeof(size_t) };
-
-  // Creates message with data buffer large enough to store default_body_length
+  // Number of bytes of the body preceding the data
+  enum {
+    metadata_length = message_type_length + message_request_id_length +
+                      message_result_chain_index_length +
+                      message_frame_length + message_count_length
+  };
+  // Maximum number of bytes of elements in a message. Larger logical
+  // messages are sent as a sequence of frames
+  enum { max_frame_size = 64UL << 20 };
+  // Messages with longer bodies are neither sent nor read, so a peer cannot
+  // make the reader allocate more than a frame
+  enum {
+    max_body_length = metadata_length + CiphertextBatchHeader::serialized_size +
+                      max_frame_size
+  };
+
+  // Creates message without data. Messages read from a socket grow their
+  // buffer to fit the body in decode_header()
   TCPMessage(const MessageType type)
       : m_type(type), m_count(0), m_data_size(0) {
     std::set<MessageType> request_types{
@@ -133,12 +174,12 @@ class TCPMessage {
       throw std::invalid_argument("Request type not valid");
     }
     check_arguments();
-    size_t body_malloc_size =
-        std::max(body_length(), static_cast<size_t>(default_body_length));
-    m_data =
-        static_cast<char*>(ngraph_malloc(header_length + body_malloc_size));
+    allocate_buffer();
     encode_header();
     encode_message_type();
+    encode_request_id();
+    encode_result_chain_index();
+    encode_frame();
     encode_count();
   }
 
@@ -146,106 +187,120 @@ class TCPMessage {
 
   // Encodes message of count elements using data in stream
   TCPMessage(const MessageType type, size_t count, std::stringstream&& stream)
-      : m_type(type), m_count(count) {
+      : m_type(type), m_total_count(count), m_count(count) {
     stream.seekp(0, std::ios::end);
     m_data_size = stream.tellp();
 
     check_arguments();
-    size_t body_malloc_size =
-        std::max(body_length(), static_cast<size_t>(default_body_length));
-    m_data =
-        static_cast<char*>(ngraph_malloc(header_length + body_malloc_size));
+    allocate_buffer();
     encode_header();
     encode_message_type();
+    encode_request_id();
+    encode_result_chain_index();
+    encode_frame();
     encode_count();
     encode_data(std::move(stream));
   }
 
   TCPMessage(const MessageType type,
-             const std::vector<std::shared_ptr<SealCiphertextWrapper>>& ciphers)
-      : m_type(type), m_count(ciphers.size()) {
-    NGRAPH_CHECK(ciphers.size() > 0, "No ciphertexts in TCPMessage");
-    size_t cipher_size = ciphertext_size(ciphers[0]->ciphertext());
-    m_data_size = cipher_size * m_count;
+             const std::vector<std::shared_ptr<SealCiphertextWrapper>>& ciphers,
+             ThreadPool& thread_pool)
+      : TCPMessage(type, ciphers, 1, thread_pool) {}
 
-    check_arguments();
-    size_t body_malloc_size =
-        std::max(body_length(), static_cast<size_t>(default_body_length));
-    m_data =
-        static_cast<char*>(ngraph_malloc(header_length + body_malloc_size));
-    encode_header();
-    encode_message_type();
-    encode_count();
+  TCPMessage(const MessageType type,
+             const std::vector<seal::Ciphertext>& ciphers,
+             ThreadPool& thread_pool)
+      : TCPMessage(type, ciphers, 1, thread_pool) {}
 
-#pragma omp parallel for
-    for (size_t i = 0; i < ciphers.size(); ++i) {
-      size_t offset = i * cipher_size;
-      std::stringstream ss;
-      // TODO: save directly to buffer
-      ciphers[i]->save(ss);
-      NGRAPH_CHECK(ciphertext_size(ciphers[i]->ciphertext()) == cipher_size,
-                   "Cipher sizes don't match. Got size ",
-                   ciphertext_size(ciphers[i]->ciphertext()), ", expected ",
-                   cipher_size);
-
-      std::stringbuf* pbuf = ss.rdbuf();
-      pbuf->sgetn(data_ptr() + offset, cipher_size);
+  TCPMessage(const MessageType type,
+             const std::vector<SeededCiphertext>& ciphers,
+             ThreadPool& thread_pool)
+      : TCPMessage(type, ciphers, 1, thread_pool) {}
+
+  // Encodes ciphers as a ciphertext batch (see CiphertextBatchHeader) of
+  // elements of ciphers_per_element consecutive ciphertexts each. The
+  // receiver recovers ciphers_per_element from the number of ciphertexts
+  // returned by load_ciphertexts()
+  // @param ciphers seal::Ciphertext, SeededCiphertext or
+  // std::shared_ptr<SealCiphertextWrapper>, all at the same level
+  template <typename Cipher>
+  TCPMessage(const MessageType type, const std::vector<Cipher>& ciphers,
+             size_t ciphers_per_element, ThreadPool& thread_pool)
+      : TCPMessage(type, ciphers.data(), ciphers.size(), ciphers_per_element,
+                   thread_pool) {}
+
+  // Encodes ciphers as a sequence of frames, each a ciphertext batch of
+  // consecutive elements with at most frame_size bytes of elements (but at
+  // least one element). Each frame is passed to on_frame once encoded, so it
+  // can be written while the following frames are encoded
+  // @param frame_size At most max_frame_size
+  template <typename Cipher>
+  static void encode_frames(const MessageType type,
+                            const std::vector<Cipher>& ciphers,
+                            size_t ciphers_per_element, ThreadPool& thread_pool,
+                            const std::function<void(TCPMessage&&)>& on_frame,
+                            size_t frame_size = max_frame_size) {
+    check_ciphers(ciphers.size(), ciphers_per_element);
+    check_frame_size(frame_size);
+    size_t total_count = ciphers.size() / ciphers_per_element;
+    size_t element_size =
+        ciphers_per_element * batch_header(ciphers[0]).element_size();
+    size_t frame_count = std::max(frame_size / element_size, size_t(1));
+    for (size_t offset = 0; offset < total_count; offset += frame_count) {
+      size_t count = std::min(frame_count, total_count - offset);
+      TCPMessage frame(type, ciphers.data() + offset * ciphers_per_element,
+                       count * ciphers_per_element, ciphers_per_element,
+                       thread_pool);
+      frame.set_frame(offset, total_count);
+      on_frame(std::move(frame));
     }
   }
 
-  TCPMessage(const MessageType type,
-             const std::vector<seal::Ciphertext>& ciphers)
-      : m_type(type), m_count(ciphers.size()) {
-    NGRAPH_CHECK(ciphers.size() > 0, "No ciphertexts in TCPMessage");
-    size_t cipher_size = ciphertext_size(ciphers[0]);
-    m_data_size = cipher_size * m_count;
-
-    check_arguments();
-    size_t body_malloc_size =
-        std::max(body_length(), static_cast<size_t>(default_body_length));
-    m_data =
-        static_cast<char*>(ngraph_malloc(header_length + body_malloc_size));
-    encode_header();
-    encode_message_type();
-    encode_count();
-
-#pragma omp parallel for
-    for (size_t i = 0; i < ciphers.size(); ++i) {
-      size_t offset = i * cipher_size;
-      std::stringstream ss;
-      // TODO: save directly to buffer
-      ciphers[i].save(ss);
-      NGRAPH_CHECK(ciphertext_size(ciphers[i]) == cipher_size,
-                   "Cipher sizes don't match. Got size ",
-                   ciphertext_size(ciphers[i]), " at index ", i, " expected ",
-                   cipher_size);
-
-      std::stringbuf* pbuf = ss.rdbuf();
-      pbuf->sgetn(data_ptr() + offset, cipher_size);
+  // Encodes data as a sequence of frames of at most frame_size bytes each,
+  // whose elements are the bytes of data
+  // @param frame_size At most max_frame_size
+  static void encode_frames(const MessageType type, const std::string& data,
+                            const std::function<void(TCPMessage&&)>& on_frame,
+                            size_t frame_size = max_frame_size) {
+    NGRAPH_CHECK(!data.empty(), "No data in TCPMessage");
+    check_frame_size(frame_size);
+    for (size_t offset = 0; offset < data.size(); offset += frame_size) {
+      size_t count = std::min(frame_size, data.size() - offset);
+      TCPMessage frame(type, count, count, data.data() + offset);
+      frame.set_frame(offset, data.size());
+      on_frame(std::move(frame));
     }
   }
 
   TCPMessage(const MessageType type, const size_t count, const size_t size,
              const char* data)
-      : m_type(type), m_count(count), m_data_size(size) {
+      : m_type(type), m_total_count(count), m_count(count), m_data_size(size) {
     check_arguments();
-    size_t body_malloc_size =
-        std::max(body_length(), static_cast<size_t>(default_body_length));
-    m_data =
-        static_cast<char*>(ngraph_malloc(header_length + body_malloc_size));
+    allocate_buffer();
     encode_header();
     encode_message_type();
+    encode_request_id();
+    encode_result_chain_index();
+    encode_frame();
     encode_count();
     encode_data(data);
   }
 
   TCPMessage& operator=(TCPMessage&& other) {
     if (this != &other) {
+      release_buffer();
       m_type = other.m_type;
+      m_request_id = other.m_request_id;
+      m_result_chain_index = other.m_result_chain_index;
+      m_element_offset = other.m_element_offset;
+      m_total_count = other.m_total_count;
       m_count = other.m_count;
       m_data_size = other.m_data_size;
       m_data = other.m_data;
+      m_capacity = other.m_capacity;
+      m_buffer_pool = std::move(other.m_buffer_pool);
       other.m_data = nullptr;
+      other.m_capacity = 0;
       other.m_data_size = 0;
       other.m_count = 0;
       other.m_type = MessageType::none;
@@ -255,19 +310,70 @@ class TCPMessage {
 
   TCPMessage(TCPMessage&& other)
       : m_type(other.m_type),
+        m_request_id(other.m_request_id),
+        m_result_chain_index(other.m_result_chain_index),
+        m_element_offset(other.m_element_offset),
+        m_total_count(other.m_total_count),
         m_count(other.m_count),
         m_data_size(other.m_data_size),
-        m_data(other.m_data) {
+        m_data(other.m_data),
+        m_capacity(other.m_capacity),
+        m_buffer_pool(std::move(other.m_buffer_pool)) {
     other.m_data = nullptr;
+    other.m_capacity = 0;
   }
 
   TCPMessage& operator=(const TCPMessage&) = delete;
   TCPMessage(const TCPMessage& other) = delete;
 
-  ~TCPMessage() { ngraph_free(m_data); }
+  ~TCPMessage() { release_buffer(); }
+
+  // Returns a deep copy of the message
+  TCPMessage copy() const {
+    TCPMessage message;
+    message.m_type = m_type;
+    message.m_request_id = m_request_id;
+    message.m_result_chain_index = m_result_chain_index;
+    message.m_element_offset = m_element_offset;
+    message.m_total_count = m_total_count;
+    message.m_count = m_count;
+    message.m_data_size = m_data_size;
+    message.release_buffer();
+    message.allocate_buffer();
+    std::memcpy(message.header_ptr(), header_ptr(), num_bytes());
+    return message;
+  }
+
+  // Loads the ciphertexts of a message encoded from ciphertexts. The header
+  // of the batch is parsed and validated once for all ciphertexts
+  void load_ciphertexts(std::vector<seal::Ciphertext>& ciphers,
+                        const std::shared_ptr<seal::SEALContext>& context,
+                        ThreadPool& thread_pool) const {
+    NGRAPH_CHECK(m_data_size >= CiphertextBatchHeader::serialized_size,
+                 "Message too small for ciphertext batch");
+    CiphertextBatchHeader header = load_batch_header(context, data_ptr());
+    size_t cipher_size = header.element_size();
+    size_t ciphers_size = m_data_size - CiphertextBatchHeader::serialized_size;
+    NGRAPH_CHECK(ciphers_size % cipher_size == 0, "Ciphertext batch of ",
+                 ciphers_size, " bytes not a multiple of ciphertext size ",
+                 cipher_size);
+    size_t cipher_count = ciphers_size / cipher_size;
+    NGRAPH_CHECK(m_count != 0 && cipher_count % m_count == 0, "Cannot split ",
+                 cipher_count, " ciphertexts into ", m_count, " elements");
+
+    ciphers.resize(cipher_count);
+    const char* ciphers_ptr =
+        data_ptr() + CiphertextBatchHeader::serialized_size;
+    auto load_cipher = [&](size_t i) {
+      load_batch_element(ciphers[i], header, context,
+                         ciphers_ptr + i * cipher_size);
+    };
+    thread_pool.parallel_for(0, cipher_count, load_cipher);
+  }
 
-  void check_arguments() {
-    if (m_count != 0 && m_data_size % m_count != 0) {
+  // @param metadata_size Number of bytes of data preceding the elements
+  void check_arguments(size_t metadata_size = 0) {
+    if (m_count != 0 && (m_data_size - metadata_size) % m_count != 0) {
       NGRAPH_INFO << "Error: size " << m_data_size
                   << " not a multiple of count " << m_count;
       throw std::invalid_argument("Size must be a multiple of count");
@@ -314,21 +420,69 @@ class TCPMessage {
   size_t data_size() { return m_data_size; }
   size_t data_size() const { return m_data_size; }
 
-  size_t body_length() const {
-    return message_type_length + message_count_length + m_data_size;
-  }
+  size_t capacity() const { return m_capacity; }
+
+  size_t body_length() const { return metadata_length + m_data_size; }
 
   MessageType message_type() { return m_type; }
   MessageType message_type() const { return m_type; }
 
+  uint64_t request_id() const { return m_request_id; }
+
+  void set_request_id(uint64_t request_id) {
+    m_request_id = request_id;
+    encode_request_id();
+  }
+
+  uint64_t result_chain_index() const { return m_result_chain_index; }
+
+  void set_result_chain_index(uint64_t result_chain_index) {
+    m_result_chain_index = result_chain_index;
+    encode_result_chain_index();
+  }
+
+  // Index of the first element of the frame in the logical message
+  uint64_t element_offset() const { return m_element_offset; }
+
+  // Number of elements of the logical message over all its frames
+  uint64_t total_count() const { return m_total_count; }
+
+  void set_frame(uint64_t element_offset, uint64_t total_count) {
+    NGRAPH_CHECK(element_offset + m_count <= total_count, "Frame of ",
+                 m_count, " elements at offset ", element_offset,
+                 " exceeds total count ", total_count);
+    m_element_offset = element_offset;
+    m_total_count = total_count;
+    encode_frame();
+  }
+
   char* header_ptr() { return m_data; }
   const char* header_ptr() const { return m_data; }
 
   char* body_ptr() { return header_ptr() + header_length; }
   const char* body_ptr() const { return header_ptr() + header_length; }
 
-  char* count_ptr() { return body_ptr() + message_type_length; }
-  const char* count_ptr() const { return body_ptr() + message_type_length; }
+  char* request_id_ptr() { return body_ptr() + message_type_length; }
+  const char* request_id_ptr() const {
+    return body_ptr() + message_type_length;
+  }
+
+  char* result_chain_index_ptr() {
+    return request_id_ptr() + message_request_id_length;
+  }
+  const char* result_chain_index_ptr() const {
+    return request_id_ptr() + message_request_id_length;
+  }
+
+  char* frame_ptr() {
+    return result_chain_index_ptr() + message_result_chain_index_length;
+  }
+  const char* frame_ptr() const {
+    return result_chain_index_ptr() + message_result_chain_index_length;
+  }
+
+  char* count_ptr() { return frame_ptr() + message_frame_length; }
+  const char* count_ptr() const { return frame_ptr() + message_frame_length; }
 
   char* data_ptr() { return count_ptr() + message_count_length; }
   const char* data_ptr() const { return count_ptr() + message_count_length; }
@@ -351,16 +505,20 @@ class TCPMessage {
     std::stringstream sstream(header_str);
     size_t body_length;
     sstream >> body_length;
-    if (body_length > max_body_length) {
-      NGRAPH_INFO << "Body length " << body_length << " too large";
+    if (body_length > max_body_length || body_length < metadata_length) {
+      NGRAPH_INFO << "Invalid body length " << body_length;
       throw std::invalid_argument("Cannot decode header");
     }
-    m_data_size = body_length - message_type_length - message_count_length;
-
-    // Resize to fit message
-    if (body_length > default_body_length) {
-      ngraph_free(m_data);
-      m_data = static_cast<char*>(ngraph_malloc(header_length + body_length));
+    m_data_size = body_length - metadata_length;
+
+    // Resize to fit message. Oversized buffers are returned to the pool, so
+    // a single large message does not pin its buffer to the reader
+    size_t required_size = header_length + body_length;
+    if (required_size > m_capacity ||
+        (required_size < m_capacity / 2 &&
+         m_capacity > MessageBufferPool::granularity)) {
+      release_buffer();
+      allocate_buffer();
       encode_header();
     }
 
@@ -375,6 +533,36 @@ class TCPMessage {
     std::memcpy(&m_type, body_ptr(), message_type_length);
   }
 
+  void encode_request_id() {
+    std::memcpy(request_id_ptr(), &m_request_id, message_request_id_length);
+  }
+
+  void decode_request_id() {
+    std::memcpy(&m_request_id, request_id_ptr(), message_request_id_length);
+  }
+
+  void encode_result_chain_index() {
+    std::memcpy(result_chain_index_ptr(), &m_result_chain_index,
+                message_result_chain_index_length);
+  }
+
+  void decode_result_chain_index() {
+    std::memcpy(&m_result_chain_index, result_chain_index_ptr(),
+                message_result_chain_index_length);
+  }
+
+  void encode_frame() {
+    std::memcpy(frame_ptr(), &m_element_offset, sizeof(m_element_offset));
+    std::memcpy(frame_ptr() + sizeof(m_element_offset), &m_total_count,
+                sizeof(m_total_count));
+  }
+
+  void decode_frame() {
+    std::memcpy(&m_element_offset, frame_ptr(), sizeof(m_element_offset));
+    std::memcpy(&m_total_count, frame_ptr() + sizeof(m_element_offset),
+                sizeof(m_total_count));
+  }
+
   void encode_count() {
     std::memcpy(count_ptr(), &m_count, message_count_length);
   }
@@ -394,15 +582,85 @@ class TCPMessage {
 
   bool decode_body() {
     decode_message_type();
+    decode_request_id();
+    decode_result_chain_index();
+    decode_frame();
     decode_count();
     return true;
   }
 
  private:
-  MessageType m_type;  // What data is being transmitted
-  size_t m_count;      // Number of datatype in message
-  size_t m_data_size;  // Nubmer of bytes in data part of message
-  char* m_data;
+  // Encodes cipher_count ciphers starting at ciphers as a ciphertext batch
+  template <typename Cipher>
+  TCPMessage(const MessageType type, const Cipher* ciphers,
+             size_t cipher_count, size_t ciphers_per_element,
+             ThreadPool& thread_pool)
+      : m_type(type) {
+    check_ciphers(cipher_count, ciphers_per_element);
+    m_count = cipher_count / ciphers_per_element;
+    m_total_count = m_count;
+    CiphertextBatchHeader header = batch_header(ciphers[0]);
+    size_t cipher_size = header.element_size();
+    m_data_size =
+        CiphertextBatchHeader::serialized_size + cipher_size * cipher_count;
+
+    check_arguments(CiphertextBatchHeader::serialized_size);
+    allocate_buffer();
+    encode_header();
+    encode_message_type();
+    encode_request_id();
+    encode_result_chain_index();
+    encode_frame();
+    encode_count();
+
+    ngraph::he::save(header, data_ptr());
+    char* ciphers_ptr = data_ptr() + CiphertextBatchHeader::serialized_size;
+    auto save_cipher = [&](size_t i) {
+      save_batch_element(ciphers[i], header, ciphers_ptr + i * cipher_size);
+    };
+    thread_pool.parallel_for(0, cipher_count, save_cipher);
+  }
+
+  static void check_ciphers(size_t cipher_count, size_t ciphers_per_element) {
+    NGRAPH_CHECK(cipher_count > 0, "No ciphertexts in TCPMessage");
+    NGRAPH_CHECK(ciphers_per_element > 0 &&
+                     cipher_count % ciphers_per_element == 0,
+                 "Cannot split ", cipher_count, " ciphertexts into elements "
+                 "of ", ciphers_per_element, " ciphertexts");
+  }
+
+  static void check_frame_size(size_t frame_size) {
+    NGRAPH_CHECK(frame_size > 0 && frame_size <= max_frame_size,
+                 "Frame size ", frame_size, " not in [1, ", max_frame_size,
+                 "]");
+  }
+
+  // Acquires a buffer large enough for the header and body from the pool
+  void allocate_buffer() {
+    if (m_buffer_pool == nullptr) {
+      m_buffer_pool = MessageBufferPool::global();
+    }
+    m_data = m_buffer_pool->acquire(header_length + body_length(), m_capacity);
+  }
+
+  void release_buffer() {
+    if (m_buffer_pool != nullptr) {
+      m_buffer_pool->release(m_data, m_capacity);
+    }
+    m_data = nullptr;
+    m_capacity = 0;
+  }
+
+  MessageType m_type;        // What data is being transmitted
+  uint64_t m_request_id{0};  // Request answered by a result message
+  uint64_t m_result_chain_index{0};  // Level of the result of a request
+  uint64_t m_element_offset{0};  // First element of the frame
+  uint64_t m_total_count{0};     // Number of elements over all frames
+  size_t m_count;            // Number of datatype in message
+  size_t m_data_size;        // Nubmer of bytes in data part of message
+  char* m_data{nullptr};
+  size_t m_capacity{0};  // Number of bytes allocated for m_data
+  std::shared_ptr<MessageBufferPool> m_buffer_pool;
 };
 }  // namespace he
 }  // namespace ngraph
\ No newline at end of file
@@ -16,27 +16,73 @@
 
 #pragma once
 
+#include <atomic>
+#include <algorithm>
 #include <boost/asio.hpp>
+#include <condition_variable>
+#include <deque>
 #include <functional>
 #include <memory>
 #include <mutex>
+#include <thread>
+#include <vector>
 
 #include "ngraph/log.hpp"
+#include "tcp/message_channel.hpp"
+#include "tcp/spsc_queue.hpp"
 #include "tcp/tcp_message.hpp"
+#include "tcp/transport.hpp"
 
 using boost::asio::ip::tcp;
 
 namespace ngraph {
 namespace he {
-class TCPSession : public std::enable_shared_from_this<TCPSession> {
+// Messages are read on the io_context thread and handed to a decode thread,
+// which calls the message handler in the order messages were received. The
+// next message is read while the handler decodes the current one. The decode
+// thread keeps the session alive until reading fails or close() is called
+class TCPSession : public MessageChannel,
+                   public std::enable_shared_from_this<TCPSession> {
  public:
-  TCPSession(tcp::socket socket,
-             std::function<void(const ngraph::he::TCPMessage&)> message_handler)
+  // Maximum number of received messages awaiting the handler. Reading pauses
+  // while the queue is full
+  enum { decode_queue_capacity = 4 };
+
+  // Default bytes of queued outgoing messages at which write_message()
+  // blocks
+  enum { default_max_queued_bytes = 256UL << 20 };
+
+  // Maximum number of queued messages gathered into a single write
+  enum { max_gather_messages = 64 };
+
+  TCPSession(stream_protocol::socket socket, MessageHandler message_handler,
+             size_t max_queued_bytes = default_max_queued_bytes)
       : m_socket(std::move(socket)),
-        m_writing(false),
-        m_message_callback(std::bind(message_handler, std::placeholders::_1)) {}
+        m_decode_queue(decode_queue_capacity),
+        m_max_queued_bytes(max_queued_bytes),
+        m_message_callback(std::move(message_handler)) {}
+
+  ~TCPSession() override {
+    // Messages still in the queue are discarded
+    stop_decoding(true);
+    if (m_decode_thread.joinable()) {
+      // The decode thread releases the last reference once it is done
+      if (m_decode_thread.get_id() == std::this_thread::get_id()) {
+        m_decode_thread.detach();
+      } else {
+        m_decode_thread.join();
+      }
+    }
+  }
 
-  void start() { do_read_header(); }
+  // Must be called on the io_context thread
+  void start() {
+    m_io_thread_id = std::this_thread::get_id();
+    m_decode_thread =
+        std::thread([self = shared_from_this()]() { self->decode_messages(); });
+    m_decode_thread_id = m_decode_thread.get_id();
+    do_read_header();
+  }
 
  public:
   void do_read_header() {
@@ -49,6 +95,8 @@ class TCPSession : public std::enable_shared_from_this<TCPSession> {
           if (!ec & m_message.decode_header()) {
             do_read_body();
           } else {
+            // Messages already received are still handled
+            stop_decoding(false);
             if (ec) {
               // End of file is expected on teardown
               if (ec.message() != "End of file") {
@@ -67,47 +115,173 @@ class TCPSession : public std::enable_shared_from_this<TCPSession> {
         [this, self](boost::system::error_code ec, std::size_t length) {
           if (!ec) {
             m_message.decode_body();
-            m_message_callback(m_message);
-            do_read_header();
+            // Reading only continues while the queue has space
+            NGRAPH_CHECK(m_decode_queue.try_push(std::move(m_message)),
+                         "Message read while decode queue is full");
+            m_message = TCPMessage();
+            if (!m_decode_queue.full() || !pause_reading()) {
+              do_read_header();
+            }
           } else {
+            stop_decoding(false);
             NGRAPH_INFO << "Server error reading message: " << ec.message();
             throw std::runtime_error("Server error reading message");
           }
         });
   }
 
-  void do_write(const TCPMessage&& message) {
-    std::lock_guard<std::mutex> lock(m_write_mtx);
+  // Queues message for writing. Messages are written in the order they are
+  // queued, and are owned by the session until written. Blocks while at least
+  // max_queued_bytes are queued, unless called on the io_context thread,
+  // which drains the queue
+  void write_message(TCPMessage&& message) override {
+    std::unique_lock<std::mutex> lock(m_write_mtx);
+    if (std::this_thread::get_id() != m_io_thread_id) {
+      m_write_space_cond.wait(
+          lock, [this]() { return m_queued_bytes < m_max_queued_bytes; });
+    }
+    bool write_in_progress = !m_message_queue.empty();
+    m_queued_bytes += message.num_bytes();
+    m_message_queue.emplace_back(std::move(message));
+    if (!write_in_progress) {
+      auto self(shared_from_this());
+      boost::asio::post(m_socket.get_executor(),
+                        [this, self]() { write_queued(); });
+    }
+  }
+
+  // Closes the socket and discards messages not yet handled. Unless called by
+  // the message handler, waits until the handler returns
+  void close() override {
+    stop_decoding(true);
     auto self(shared_from_this());
-    m_writing = true;
-    boost::asio::async_write(
-        m_socket,
-        boost::asio::buffer(message.header_ptr(), message.num_bytes()),
-        [this, self](boost::system::error_code ec, std::size_t length) {
-          if (ec) {
-            NGRAPH_INFO << "Error writing message in session: " << ec.message();
+    boost::asio::post(m_socket.get_executor(), [this, self]() {
+      // A paused read is not resumed by the stopped decode thread
+      if (m_read_paused.exchange(false)) {
+        m_read_work = nullptr;
+      }
+      boost::system::error_code ec;
+      m_socket.shutdown(stream_protocol::socket::shutdown_both, ec);
+      m_socket.close(ec);
+    });
+    if (std::this_thread::get_id() != m_decode_thread_id) {
+      std::lock_guard<std::mutex> lock(m_decode_thread_mtx);
+      if (m_decode_thread.joinable()) {
+        m_decode_thread.join();
+      }
+    }
+  }
 
-          } else {
-            m_writing = false;
-            m_is_writing.notify_all();
-          }
-        });
+ private:
+  // Called by the reader once the decode queue is full. Returns false if the
+  // decode thread made space before noticing the pause, in which case the
+  // reader continues
+  bool pause_reading() {
+    // Keeps the io_context running while no read is pending
+    m_read_work = std::make_shared<ReadWork>(m_socket.get_executor());
+    m_read_paused = true;
+    if (m_decode_queue.full()) {
+      return true;
+    }
+    bool paused = true;
+    if (m_read_paused.compare_exchange_strong(paused, false)) {
+      m_read_work = nullptr;
+      return false;
+    }
+    return true;
   }
 
-  bool is_writing() const { return m_writing; }
+  // Ends the decode loop once the queue is empty, or at once if discard
+  void stop_decoding(bool discard) {
+    if (discard) {
+      m_stopped = true;
+    }
+    m_decode_queue.close();
+  }
 
-  std::condition_variable& is_writing_cond() { return m_is_writing; }
+  void decode_messages() {
+    TCPMessage message;
+    while (m_decode_queue.pop(message) && !m_stopped) {
+      if (m_read_paused.exchange(false)) {
+        boost::asio::post(m_socket.get_executor(),
+                          [this, self = shared_from_this(),
+                           work = std::move(m_read_work)]() {
+                            do_read_header();
+                          });
+      }
+      m_message_callback(std::move(message));
+    }
+  }
+
+  // Writes the messages at the front of the queue with a single gather write
+  void write_queued() {
+    std::vector<boost::asio::const_buffer> buffers;
+    {
+      // References to deque elements stay valid on emplace_back
+      std::lock_guard<std::mutex> lock(m_write_mtx);
+      size_t message_count = std::min(m_message_queue.size(),
+                                      static_cast<size_t>(max_gather_messages));
+      buffers.reserve(message_count);
+      for (size_t i = 0; i < message_count; ++i) {
+        const TCPMessage& message = m_message_queue[i];
+        buffers.emplace_back(message.header_ptr(), message.num_bytes());
+      }
+    }
+    auto self(shared_from_this());
+    size_t message_count = buffers.size();
+    boost::asio::async_write(
+        m_socket, buffers,
+        [this, self, message_count](boost::system::error_code ec,
+                                    std::size_t length) {
+          bool write_next;
+          {
+            std::lock_guard<std::mutex> lock(m_write_mtx);
+            if (ec) {
+              NGRAPH_INFO << "Error writing message in session: "
+                          << ec.message();
+              // Drop unwritten messages so producers do not block forever
+              m_message_queue.clear();
+              m_queued_bytes = 0;
+            } else {
+              for (size_t i = 0; i < message_count; ++i) {
+                m_queued_bytes -= m_message_queue.front().num_bytes();
+                m_message_queue.pop_front();
+              }
+            }
+            write_next = !m_message_queue.empty();
+          }
+          m_write_space_cond.notify_all();
+          if (write_next) {
+            write_queued();
+          }
+        });
+  }
 
- private:
   TCPMessage m_message;
-  tcp::socket m_socket;
+  stream_protocol::socket m_socket;
+
+  SPSCQueue<TCPMessage> m_decode_queue;
+  std::thread m_decode_thread;
+  std::thread::id m_decode_thread_id;
+  // Serializes joining the decode thread in close()
+  std::mutex m_decode_thread_mtx;
+  // Whether reading waits for the decode thread to make space in the queue
+  std::atomic<bool> m_read_paused{false};
+  std::atomic<bool> m_stopped{false};
+  using ReadWork =
+      boost::asio::executor_work_guard<stream_protocol::socket::executor_type>;
+  std::shared_ptr<ReadWork> m_read_work;
+  std::thread::id m_io_thread_id;
 
-  bool m_writing;
-  std::condition_variable m_is_writing;
+  // Outgoing messages, the front ones of which are being written
+  std::deque<TCPMessage> m_message_queue;
+  size_t m_queued_bytes{0};
+  size_t m_max_queued_bytes;
+  std::condition_variable m_write_space_cond;
   std::mutex m_write_mtx;
 
   // Called after message is received
-  std::function<void(const ngraph::he::TCPMessage&)> m_message_callback;
+  MessageHandler m_message_callback;
 };
 }  // namespace he
 }  // namespace ngraph
@@ -0,0 +1,89 @@
+//*****************************************************************************
+// Copyright 2018-2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//*****************************************************************************
+
+#pragma once
+
+#include <boost/asio.hpp>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "ngraph/check.hpp"
+
+namespace ngraph {
+namespace he {
+// Sessions and clients use generic stream sockets, so the same code runs over
+// any stream transport
+using stream_protocol = boost::asio::generic::stream_protocol;
+using stream_acceptor = boost::asio::basic_socket_acceptor<stream_protocol>;
+
+/// \brief Transport carrying messages between the server and the client
+enum class Transport {
+  // TCP socket at hostname:port
+  tcp,
+  // Unix domain socket, for clients on the same host as the server
+  unix_socket
+};
+
+/// @brief Returns the transport selected by NGRAPH_HE_TRANSPORT, which is
+/// either "tcp" (default) or "unix"
+inline Transport transport_from_env() {
+  const char* transport = std::getenv("NGRAPH_HE_TRANSPORT");
+  if (transport == nullptr || std::string(transport) == "tcp") {
+    return Transport::tcp;
+  }
+  NGRAPH_CHECK(std::string(transport) == "unix",
+               "Unknown NGRAPH_HE_TRANSPORT ", transport);
+  return Transport::unix_socket;
+}
+
+/// @brief Returns the path of the Unix domain socket for the given port,
+/// which is NGRAPH_HE_SOCKET_PATH if set
+inline std::string unix_socket_path(size_t port) {
+  if (const char* path = std::getenv("NGRAPH_HE_SOCKET_PATH")) {
+    return path;
+  }
+  return "/tmp/ngraph_he_" + std::to_string(port) + ".sock";
+}
+
+/// @brief Returns the endpoint the server listens on
+inline stream_protocol::endpoint server_endpoint(Transport transport,
+                                                 size_t port) {
+  if (transport == Transport::unix_socket) {
+    return boost::asio::local::stream_protocol::endpoint(
+        unix_socket_path(port));
+  }
+  return boost::asio::ip::tcp::endpoint(boost::asio::ip::tcp::v4(), port);
+}
+
+/// @brief Returns the endpoints the client tries to connect to, in order
+inline std::vector<stream_protocol::endpoint> client_endpoints(
+    boost::asio::io_context& io_context, Transport transport,
+    const std::string& hostname, size_t port) {
+  std::vector<stream_protocol::endpoint> endpoints;
+  if (transport == Transport::unix_socket) {
+    endpoints.emplace_back(
+        boost::asio::local::stream_protocol::endpoint(unix_socket_path(port)));
+  } else {
+    boost::asio::ip::tcp::resolver resolver(io_context);
+    for (const auto& entry : resolver.resolve(hostname, std::to_string(port))) {
+      endpoints.emplace_back(entry.endpoint());
+    }
+  }
+  return endpoints;
+}
+}  // namespace he
+}  // namespace ngraph
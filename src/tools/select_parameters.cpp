@@ -0,0 +1,100 @@
+//*****************************************************************************
+// Copyright 2018-2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//*****************************************************************************
+
+// Prints the encryption parameters configuration, as read from
+// NGRAPH_HE_SEAL_CONFIG, with the smallest poly_modulus_degree and coefficient
+// modulus chain which evaluate a serialized function
+//
+// Usage: select_parameters FUNCTION_JSON [--security_level=128]
+//            [--scale_bits=24] [--integer_bits=6] [--batch_size=1]
+//            [--complex_packing] [--encrypt_model]
+
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "ngraph/pass/constant_folding.hpp"
+#include "ngraph/pass/manager.hpp"
+#include "ngraph/serializer.hpp"
+#include "pass/he_batch_norm_folding.hpp"
+#include "seal/he_seal_encryption_parameters.hpp"
+#include "seal/parameter_selection.hpp"
+
+namespace {
+void print_usage(const char* program) {
+  std::cerr << "Usage: " << program
+            << " FUNCTION_JSON [--security_level=128] [--scale_bits=24]"
+               " [--integer_bits=6] [--batch_size=1] [--complex_packing]"
+               " [--encrypt_model]"
+            << std::endl;
+}
+
+// Returns whether arg is --name=value, setting value if so
+bool parse_flag(const std::string& arg, const std::string& name,
+                size_t& value) {
+  std::string prefix = "--" + name + "=";
+  if (arg.compare(0, prefix.size(), prefix) != 0) {
+    return false;
+  }
+  value = std::stoul(arg.substr(prefix.size()));
+  return true;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    print_usage(argv[0]);
+    return 1;
+  }
+  ngraph::he::ParameterRequirements requirements;
+  bool encrypt_model = false;
+  size_t security_level = requirements.security_level;
+  for (int i = 2; i < argc; ++i) {
+    std::string arg(argv[i]);
+    if (arg == "--complex_packing") {
+      requirements.complex_packing = true;
+    } else if (arg == "--encrypt_model") {
+      encrypt_model = true;
+    } else if (!parse_flag(arg, "security_level", security_level) &&
+               !parse_flag(arg, "scale_bits", requirements.scale_bits) &&
+               !parse_flag(arg, "integer_bits", requirements.integer_bits) &&
+               !parse_flag(arg, "batch_size", requirements.slot_count)) {
+      print_usage(argv[0]);
+      return 1;
+    }
+  }
+  requirements.security_level = security_level;
+
+  std::ifstream function_stream(argv[1]);
+  if (!function_stream) {
+    std::cerr << "Cannot read " << argv[1] << std::endl;
+    return 1;
+  }
+  auto function = ngraph::deserialize(function_stream);
+  // Batch norms folded at compilation take no level
+  ngraph::pass::Manager pass_manager;
+  pass_manager.register_pass<ngraph::pass::ConstantFolding>();
+  pass_manager.register_pass<ngraph::he::pass::HEBatchNormFolding>();
+  pass_manager.run_passes(function);
+  requirements.multiplicative_depth =
+      ngraph::he::multiplicative_depth(*function, encrypt_model);
+  std::cerr << "Multiplicative depth " << requirements.multiplicative_depth
+            << std::endl;
+
+  auto parms = ngraph::he::select_encryption_parameters(requirements);
+  std::cout << ngraph::he::config_json(parms) << std::endl;
+  return 0;
+}
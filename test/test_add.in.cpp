@@ -283,3 +283,38 @@ NGRAPH_TEST(${BACKEND_NAME}, add_optimized_2_3) {
         (test::NDArray<float, 2>({{0, 2, 4}, {3, 5, 7}})).get_vector(), 1e-3f));
   }
 }
+
+NGRAPH_TEST(${BACKEND_NAME}, add_product_and_input) {
+  auto backend = runtime::Backend::create("${BACKEND_NAME}");
+  auto he_backend = static_cast<ngraph::he::HESealBackend*>(backend.get());
+
+  Shape shape{2, 3};
+  auto a = make_shared<op::Parameter>(element::f32, shape);
+  auto b = make_shared<op::Parameter>(element::f32, shape);
+  // a is a level above the product when added to it
+  auto t = make_shared<op::Add>(make_shared<op::Multiply>(a, b), a);
+  auto f = make_shared<Function>(t, ParameterVector{a, b});
+
+  for (bool cipher_b : vector<bool>{false, true}) {
+    auto t_a = he_backend->create_cipher_tensor(element::f32, shape);
+    auto t_b = cipher_b ? he_backend->create_cipher_tensor(element::f32, shape)
+                        : he_backend->create_plain_tensor(element::f32, shape);
+    auto t_result = he_backend->create_cipher_tensor(element::f32, shape);
+    auto t_result2 = he_backend->create_cipher_tensor(element::f32, shape);
+
+    copy_data(t_a, vector<float>{1, 2, 3, 4, 5, 6});
+    copy_data(t_b, vector<float>{7, 8, 9, 10, 11, 12});
+
+    auto handle = backend->compile(f);
+    handle->call_with_validate({t_result}, {t_a, t_b});
+    EXPECT_TRUE(all_close(read_vector<float>(t_result),
+                          (vector<float>{8, 18, 30, 44, 60, 78}), 1e-3f));
+
+    // The result is a level below the first, so the levels are re-planned
+    // when it is passed as input
+    handle->call_with_validate({t_result2}, {t_result, t_b});
+    EXPECT_TRUE(all_close(read_vector<float>(t_result2),
+                          (vector<float>{64, 162, 300, 484, 720, 1014}),
+                          1e-3f));
+  }
+}
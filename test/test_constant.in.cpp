@@ -14,8 +14,12 @@
 // limitations under the License.
 //*****************************************************************************
 
+#include <stdlib.h>
+
+#include "ngraph/file_util.hpp"
 #include "ngraph/ngraph.hpp"
 #include "seal/he_seal_backend.hpp"
+#include "seal/he_seal_executable.hpp"
 #include "test_util.hpp"
 #include "util/all_close.hpp"
 #include "util/ndarray.hpp"
@@ -73,3 +77,66 @@ NGRAPH_TEST(${BACKEND_NAME}, constant_abc) {
         (test::NDArray<float, 2>({{54, 80}, {110, 144}})).get_vector()));
   }
 }
+
+NGRAPH_TEST(${BACKEND_NAME}, constant_encrypt_model_repeated_calls) {
+  auto backend = runtime::Backend::create("${BACKEND_NAME}");
+  auto he_backend = static_cast<ngraph::he::HESealBackend*>(backend.get());
+  he_backend->set_pack_data(false);
+  he_backend->set_encrypt_model(true);
+
+  Shape shape{2, 2};
+  auto a = make_shared<op::Parameter>(element::f32, shape);
+  auto w = op::Constant::create(element::f32, shape, {1, -1, 2, 0.5});
+  auto bias = op::Constant::create(element::f32, shape, {0.5, 1, -1, 2});
+  auto t = make_shared<op::Dot>(a, w) + bias;
+  auto f = make_shared<Function>(t, ParameterVector{a});
+
+  char model_dir[] = "/tmp/he_encrypted_model_XXXXXX";
+  ASSERT_NE(mkdtemp(model_dir), nullptr);
+  string model_path = string(model_dir) + "/model";
+
+  // Create some tensors for input/output
+  auto tensors_list = generate_plain_cipher_tensors({t}, {a}, backend.get());
+
+  for (auto tensors : tensors_list) {
+    auto results = get<0>(tensors);
+    auto inputs = get<1>(tensors);
+
+    auto t_a = inputs[0];
+    auto t_result = results[0];
+
+    // The second call reuses the constants encrypted by the first
+    auto handle = dynamic_pointer_cast<ngraph::he::HESealExecutable>(
+        backend->compile(f));
+    copy_data(t_a, vector<float>{1, 2, 3, 4});
+    handle->call_with_validate({t_result}, {t_a});
+    EXPECT_TRUE(all_close(read_vector<float>(t_result),
+                          (vector<float>{5.5, 1, 10, 1}), 1e-2f));
+
+    copy_data(t_a, vector<float>{0, 1, 1, 0});
+    handle->call_with_validate({t_result}, {t_a});
+    EXPECT_TRUE(all_close(read_vector<float>(t_result),
+                          (vector<float>{2.5, 1.5, 0, 1}), 1e-2f));
+
+    // A new executable loads the saved constants instead of encrypting them
+    handle->save_encrypted_constants(model_path);
+    auto loaded_handle = dynamic_pointer_cast<ngraph::he::HESealExecutable>(
+        backend->compile(f));
+    EXPECT_TRUE(loaded_handle->load_encrypted_constants(model_path));
+    copy_data(t_a, vector<float>{1, 2, 3, 4});
+    loaded_handle->call_with_validate({t_result}, {t_a});
+    EXPECT_TRUE(all_close(read_vector<float>(t_result),
+                          (vector<float>{5.5, 1, 10, 1}), 1e-2f));
+  }
+
+  // Another backend has another public key, so it does not load the model
+  auto other_backend = runtime::Backend::create("${BACKEND_NAME}");
+  auto other_he_backend =
+      static_cast<ngraph::he::HESealBackend*>(other_backend.get());
+  other_he_backend->set_pack_data(false);
+  other_he_backend->set_encrypt_model(true);
+  auto other_handle = dynamic_pointer_cast<ngraph::he::HESealExecutable>(
+      other_backend->compile(f));
+  EXPECT_FALSE(other_handle->load_encrypted_constants(model_path));
+  file_util::remove_directory(model_dir);
+}
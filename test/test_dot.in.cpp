@@ -204,3 +204,42 @@ NGRAPH_TEST(${BACKEND_NAME}, dot_scalar_batch) {
   EXPECT_TRUE(all_close((vector<float>{4, 8, 12}), read_vector<float>(t_result),
                         1e-3f));
 }
+
+NGRAPH_TEST(${BACKEND_NAME}, dot_constant_repeated_calls) {
+  auto backend = runtime::Backend::create("${BACKEND_NAME}");
+  auto he_backend = static_cast<ngraph::he::HESealBackend*>(backend.get());
+  he_backend->set_pack_data(false);
+
+  Shape shape_a{2, 4};
+  Shape shape_w{4, 2};
+  Shape shape_r{2, 2};
+  auto a = make_shared<op::Parameter>(element::f32, shape_a);
+  auto w = op::Constant::create(element::f32, shape_w,
+                                {1, 0, 0, 1, 1, 1, -1, 2});
+  auto bias = op::Constant::create(element::f32, shape_r, {0.5, -1, 2, 1});
+  auto t = make_shared<op::Dot>(a, w) + bias;
+  auto f = make_shared<Function>(t, ParameterVector{a});
+
+  // Create some tensors for input/output
+  auto tensors_list = generate_plain_cipher_tensors({t}, {a}, backend.get());
+
+  for (auto tensors : tensors_list) {
+    auto results = get<0>(tensors);
+    auto inputs = get<1>(tensors);
+
+    auto t_a = inputs[0];
+    auto t_result = results[0];
+
+    // The second call reuses the constants encoded by the first
+    auto handle = backend->compile(f);
+    copy_data(t_a, vector<float>{1, 2, 3, 4, 5, 6, 7, 8});
+    handle->call_with_validate({t_result}, {t_a});
+    EXPECT_TRUE(all_close(read_vector<float>(t_result),
+                          (vector<float>{0.5, 12, 6, 30}), 1e-2f));
+
+    copy_data(t_a, vector<float>{0, 1, 0, 1, 2, 0, 0, 0});
+    handle->call_with_validate({t_result}, {t_a});
+    EXPECT_TRUE(all_close(read_vector<float>(t_result),
+                          (vector<float>{-0.5, 2, 4, 1}), 1e-2f));
+  }
+}
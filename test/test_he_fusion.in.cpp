@@ -81,3 +81,82 @@ NGRAPH_TEST(${BACKEND_NAME}, bounded_relu_fusion) {
   check_bounded_relu(Shape{4, 3}, 4.0f);
   check_bounded_relu(Shape{4, 3, 2}, 2.0f);
 }
+
+// Checks the batch norm of make_function is folded, and the result is that of
+// the interpreter
+static void check_batch_norm_folding(
+    std::function<std::shared_ptr<Function>()> make_function) {
+  auto he_f = make_function();
+  auto int_f = make_function();
+  Shape param_shape = int_f->get_parameters()[0]->get_shape();
+  Shape result_shape = int_f->get_output_shape(0);
+  test::Uniform<float> rng(-1.0f, 1.0f);
+  vector<float> arg(shape_size(param_shape));
+  rng.initialize(arg);
+
+  auto he_backend_orig = runtime::Backend::create("${BACKEND_NAME}");
+  auto he_backend =
+      static_cast<ngraph::he::HESealBackend*>(he_backend_orig.get());
+  auto he_handle = he_backend->compile(he_f);
+  EXPECT_EQ(0, count_ops_of_type<op::BatchNormInference>(he_f));
+
+  auto he_a = he_backend->create_cipher_tensor(element::f32, param_shape);
+  auto he_result = he_backend->create_cipher_tensor(element::f32, result_shape);
+  copy_data(he_a, arg);
+  he_handle->call_with_validate({he_result}, {he_a});
+
+  auto int_backend = runtime::Backend::create("INTERPRETER");
+  auto int_handle = int_backend->compile(int_f);
+  auto int_a = int_backend->create_tensor(element::f32, param_shape);
+  auto int_result = int_backend->create_tensor(element::f32, result_shape);
+  copy_data(int_a, arg);
+  int_handle->call_with_validate({int_result}, {int_a});
+
+  EXPECT_TRUE(all_close(read_vector<float>(he_result),
+                        read_vector<float>(int_result), 1e-3f, 1e-2f));
+}
+
+static std::shared_ptr<Node> make_batch_norm(std::shared_ptr<Node> input) {
+  auto et = element::f32;
+  Shape shape_norm{input->get_shape()[1]};
+  auto gamma = op::Constant::create(et, shape_norm, {-0.5f, 1.25f, 2.0f});
+  auto beta = op::Constant::create(et, shape_norm, {0.25f, -1.0f, 0.5f});
+  auto mean = op::Constant::create(et, shape_norm, {0.125f, 0.5f, -0.25f});
+  auto var = op::Constant::create(et, shape_norm, {0.5f, 2.0f, 0.25f});
+  return std::make_shared<op::BatchNormInference>(input, gamma, beta, mean,
+                                                  var, 0.001);
+}
+
+NGRAPH_TEST(${BACKEND_NAME}, batch_norm_folding_dot) {
+  check_batch_norm_folding([]() {
+    auto input = std::make_shared<op::Parameter>(element::f32, Shape{2, 4});
+    auto weights = op::Constant::create(
+        element::f32, Shape{4, 3},
+        {0.5f, -1.0f, 0.25f, 1.5f, 0.75f, -0.5f, -0.25f, 1.0f, 2.0f, 0.5f,
+         -1.5f, 0.125f});
+    auto dot = std::make_shared<op::Dot>(input, weights);
+    return make_shared<Function>(NodeVector{make_batch_norm(dot)},
+                                 ParameterVector{input});
+  });
+}
+
+NGRAPH_TEST(${BACKEND_NAME}, batch_norm_folding_depthwise_convolution) {
+  check_batch_norm_folding([]() {
+    // A depthwise convolution, as one convolution per input channel
+    Shape shape_input{1, 3, 3, 3};
+    auto input = std::make_shared<op::Parameter>(element::f32, shape_input);
+    NodeVector convs;
+    for (size_t c = 0; c < shape_input[1]; ++c) {
+      auto channel = std::make_shared<op::Slice>(
+          input, Coordinate{0, c, 0, 0}, Coordinate{1, c + 1, 3, 3});
+      auto filter = op::Constant::create(
+          element::f32, Shape{1, 1, 2, 2},
+          {0.5f * (c + 1), -0.25f, 1.0f, 0.125f * (c + 1)});
+      convs.emplace_back(std::make_shared<op::Convolution>(
+          channel, filter, Strides{1, 1}, Strides{1, 1}));
+    }
+    auto concat = std::make_shared<op::Concat>(convs, 1);
+    return make_shared<Function>(NodeVector{make_batch_norm(concat)},
+                                 ParameterVector{input});
+  });
+}
@@ -14,10 +14,32 @@
 // limitations under the License.
 //*****************************************************************************
 
+#include <stdlib.h>
+#include <unistd.h>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
 #include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include "gtest/gtest.h"
+#include "ngraph/ngraph.hpp"
+#include "nlohmann/json.hpp"
+#include "seal/he_seal_encryption_parameters.hpp"
+#include "seal/key_cache.hpp"
+#include "seal/parameter_selection.hpp"
 #include "seal/seal.h"
+#include "seal/seal_ciphertext_wrapper.hpp"
+#include "seal/seal_util.hpp"
+#include "seal/thread_pool.hpp"
+#include "seal/util.hpp"
+#include "seal/util/rlwe.h"
+#include "seal/zero_ciphertext_pool.hpp"
+#include "tcp/tcp_message.hpp"
 
 using namespace std;
 
@@ -73,3 +95,493 @@ TEST(seal_example, seal_ckks_basics) {
   decryptor.decrypt(encrypted, plain);
   encoder.decode(plain, input);
 }
+
+TEST(seal_example, ciphertext_save_load) {
+  using namespace seal;
+
+  EncryptionParameters parms(scheme_type::CKKS);
+  size_t poly_modulus_degree = 4096;
+  parms.set_poly_modulus_degree(poly_modulus_degree);
+  parms.set_coeff_modulus(
+      CoeffModulus::Create(poly_modulus_degree, {40, 40, 40}));
+  auto context = SEALContext::Create(parms);
+
+  KeyGenerator keygen(context);
+  Encryptor encryptor(context, keygen.public_key());
+  Evaluator evaluator(context);
+  CKKSEncoder encoder(context);
+
+  Plaintext plain;
+  encoder.encode(vector<double>{0.0, 1.1, 2.2, 3.3}, pow(2.0, 30), plain);
+  Ciphertext encrypted;
+  encryptor.encrypt(plain, encrypted);
+  evaluator.mod_switch_to_next_inplace(encrypted);
+
+  // In-place serialization matches Ciphertext::save
+  vector<char> buffer(ngraph::he::ciphertext_size(encrypted));
+  ngraph::he::save(encrypted, buffer.data());
+  stringstream stream;
+  encrypted.save(stream);
+  string saved = stream.str();
+  ASSERT_EQ(saved.size(), buffer.size());
+  EXPECT_EQ(memcmp(saved.data(), buffer.data(), buffer.size()), 0);
+
+  Ciphertext loaded;
+  ngraph::he::load(loaded, context, buffer.data());
+  EXPECT_EQ(loaded.parms_id(), encrypted.parms_id());
+  EXPECT_EQ(loaded.is_ntt_form(), encrypted.is_ntt_form());
+  EXPECT_EQ(loaded.scale(), encrypted.scale());
+  ASSERT_EQ(loaded.uint64_count(), encrypted.uint64_count());
+  EXPECT_EQ(memcmp(loaded.data(), encrypted.data(),
+                   8 * encrypted.uint64_count()),
+            0);
+}
+
+TEST(seal_example, seeded_ciphertext) {
+  using namespace seal;
+
+  EncryptionParameters parms(scheme_type::CKKS);
+  size_t poly_modulus_degree = 4096;
+  parms.set_poly_modulus_degree(poly_modulus_degree);
+  parms.set_coeff_modulus(
+      CoeffModulus::Create(poly_modulus_degree, {40, 40, 40}));
+  auto context = SEALContext::Create(parms);
+
+  KeyGenerator keygen(context);
+  Decryptor decryptor(context, keygen.secret_key());
+  CKKSEncoder encoder(context);
+  ngraph::he::ThreadPool thread_pool(2);
+
+  vector<double> input{0.0, 1.1, -2.2, 3.3};
+  Plaintext plain;
+  encoder.encode(input, pow(2.0, 30), plain);
+  vector<ngraph::he::SeededCiphertext> seeded(3);
+  for (auto& seeded_cipher : seeded) {
+    ngraph::he::encrypt_symmetric_seeded(plain, keygen.secret_key(), context,
+                                         seeded_cipher);
+  }
+  vector<Ciphertext> full;
+  for (const auto& seeded_cipher : seeded) {
+    full.emplace_back(seeded_cipher.ciphertext);
+  }
+
+  // Only the first polynomial and the seed are serialized
+  ngraph::he::TCPMessage seeded_message(ngraph::he::MessageType::relu_result,
+                                        seeded, thread_pool);
+  ngraph::he::TCPMessage full_message(ngraph::he::MessageType::relu_result,
+                                      full, thread_pool);
+  EXPECT_LT(seeded_message.data_size(), full_message.data_size() / 2 + 1000);
+
+  vector<Ciphertext> loaded;
+  seeded_message.load_ciphertexts(loaded, context, thread_pool);
+  ASSERT_EQ(loaded.size(), seeded.size());
+  for (size_t i = 0; i < loaded.size(); ++i) {
+    ASSERT_EQ(loaded[i].uint64_count(), full[i].uint64_count());
+    EXPECT_EQ(memcmp(loaded[i].data(), full[i].data(),
+                     8 * loaded[i].uint64_count()),
+              0);
+  }
+
+  Plaintext decrypted;
+  decryptor.decrypt(loaded[0], decrypted);
+  vector<double> output;
+  encoder.decode(decrypted, output);
+  for (size_t i = 0; i < input.size(); ++i) {
+    EXPECT_NEAR(output[i], input[i], 1e-3);
+  }
+}
+
+TEST(seal_example, seeded_ciphertext_matches_seal) {
+  using namespace seal;
+
+  EncryptionParameters parms(scheme_type::CKKS);
+  size_t poly_modulus_degree = 4096;
+  parms.set_poly_modulus_degree(poly_modulus_degree);
+  parms.set_coeff_modulus(
+      CoeffModulus::Create(poly_modulus_degree, {40, 40, 40}));
+  auto context = SEALContext::Create(parms);
+
+  KeyGenerator keygen(context);
+  Decryptor decryptor(context, keygen.secret_key());
+  Evaluator evaluator(context);
+  CKKSEncoder encoder(context);
+
+  vector<double> input{0.0, 1.1, -2.2, 3.3, 4.4, -5.5};
+  Plaintext plain;
+  encoder.encode(input, pow(2.0, 30), plain);
+
+  ngraph::he::SeededCiphertext seeded;
+  ngraph::he::encrypt_symmetric_seeded(plain, keygen.secret_key(), context,
+                                       seeded);
+
+  // SEAL's own symmetric encryption: an encryption of zero plus the plaintext
+  Ciphertext expected;
+  util::encrypt_zero_symmetric(keygen.secret_key(), context, plain.parms_id(),
+                               UniformRandomGeneratorFactory::default_factory()
+                                   ->create(),
+                               true, expected, MemoryManager::GetPool());
+  expected.scale() = plain.scale();
+  evaluator.add_plain_inplace(expected, plain);
+
+  EXPECT_EQ(seeded.ciphertext.parms_id(), expected.parms_id());
+  EXPECT_EQ(seeded.ciphertext.is_ntt_form(), expected.is_ntt_form());
+  EXPECT_EQ(seeded.ciphertext.scale(), expected.scale());
+  EXPECT_EQ(seeded.ciphertext.size(), expected.size());
+
+  Plaintext seeded_decrypted;
+  decryptor.decrypt(seeded.ciphertext, seeded_decrypted);
+  vector<double> seeded_output;
+  encoder.decode(seeded_decrypted, seeded_output);
+  Plaintext expected_decrypted;
+  decryptor.decrypt(expected, expected_decrypted);
+  vector<double> expected_output;
+  encoder.decode(expected_decrypted, expected_output);
+  ASSERT_EQ(seeded_output.size(), expected_output.size());
+  for (size_t i = 0; i < seeded_output.size(); ++i) {
+    EXPECT_NEAR(seeded_output[i], expected_output[i], 1e-3);
+  }
+  for (size_t i = 0; i < input.size(); ++i) {
+    EXPECT_NEAR(seeded_output[i], input[i], 1e-3);
+  }
+}
+
+TEST(seal_example, seed_generator) {
+  auto keystream = [](ngraph::he::SeedGenerator& generator, size_t count) {
+    vector<uint32_t> words(count);
+    for (auto& word : words) {
+      word = generator.generate();
+    }
+    return words;
+  };
+
+  // RFC 8439, section 2.3.2: key 00:01:...:1f, nonce 00:00:00:09:00:00:00:4a:
+  // 00:00:00:00, block counter 1
+  ngraph::he::SeedGenerator rfc_generator(
+      {0x03020100, 0x07060504, 0x0b0a0908, 0x0f0e0d0c, 0x13121110, 0x17161514,
+       0x1b1a1918, 0x1f1e1d1c},
+      1, {0x09000000, 0x4a000000, 0x00000000});
+  EXPECT_EQ(keystream(rfc_generator, 16),
+            (vector<uint32_t>{0xe4e7f110, 0x15593bd1, 0x1fdd0f50, 0xc47120a3,
+                              0xc7f4d1c7, 0x0368c033, 0x9aaa2204, 0x4e6cd4c3,
+                              0x466482d2, 0x09aa9f07, 0x05d7c214, 0xa2028bd9,
+                              0xd19c12b5, 0xb94e16de, 0xe883d0cb,
+                              0x4e3c50a2}));
+
+  // RFC 8439, appendix A.1, test vectors 1 and 2: zero key and nonce, block
+  // counters 0 and 1. A zero seed gives the same keystream
+  ngraph::he::SeedGenerator zero_generator({0, 0, 0, 0});
+  vector<uint32_t> block0 = keystream(zero_generator, 16);
+  EXPECT_EQ(block0[0], 0xade0b876);
+  EXPECT_EQ(block0[1], 0x903df1a0);
+  EXPECT_EQ(block0[15], 0x8665eeb2);
+  EXPECT_EQ(zero_generator.generate(), 0xbee7079f);
+
+  // Test vector 4: last key byte 01, block counter 1
+  ngraph::he::SeedGenerator key_generator({0, 0, 0, 0, 0, 0, 0, 0x01000000}, 1,
+                                          {0, 0, 0});
+  EXPECT_EQ(key_generator.generate(), 0x2452eb3a);
+
+  // Test vector 6: last nonce byte 02, block counter 0
+  ngraph::he::SeedGenerator nonce_generator({0, 0, 0, 0, 0, 0, 0, 0}, 0,
+                                            {0, 0, 0x02000000});
+  EXPECT_EQ(nonce_generator.generate(), 0x374dc6c2);
+
+  // Each seed word is two little-endian key words
+  ngraph::he::SeedGenerator seed_generator(
+      ngraph::he::SeededCiphertext::Seed{0, 0, 0, 0x0100000000000000});
+  ngraph::he::SeedGenerator key_word_generator(
+      {0, 0, 0, 0, 0, 0, 0, 0x01000000}, 0, {0, 0, 0});
+  EXPECT_EQ(keystream(seed_generator, 20), keystream(key_word_generator, 20));
+
+  // Equal seeds give equal streams, different seeds different ones
+  ngraph::he::SeedGenerator generator1({1, 2, 3, 4});
+  ngraph::he::SeedGenerator generator2({1, 2, 3, 4});
+  ngraph::he::SeedGenerator generator3({1, 2, 3, 5});
+  size_t equal_count = 0;
+  for (size_t i = 0; i < 100; ++i) {
+    uint32_t word = generator1.generate();
+    EXPECT_EQ(word, generator2.generate());
+    equal_count += (word == generator3.generate());
+  }
+  EXPECT_LT(equal_count, 5);
+}
+
+TEST(seal_example, ciphertext_batch) {
+  using namespace seal;
+
+  EncryptionParameters parms(scheme_type::CKKS);
+  size_t poly_modulus_degree = 4096;
+  parms.set_poly_modulus_degree(poly_modulus_degree);
+  parms.set_coeff_modulus(
+      CoeffModulus::Create(poly_modulus_degree, {40, 40, 40}));
+  auto context = SEALContext::Create(parms);
+
+  KeyGenerator keygen(context);
+  Encryptor encryptor(context, keygen.public_key());
+  CKKSEncoder encoder(context);
+  ngraph::he::ThreadPool thread_pool(2);
+
+  vector<Ciphertext> ciphers(4);
+  for (size_t i = 0; i < ciphers.size(); ++i) {
+    Plaintext plain;
+    encoder.encode(static_cast<double>(i), pow(2.0, 20 + i), plain);
+    encryptor.encrypt(plain, ciphers[i]);
+  }
+
+  // Two elements of two ciphertexts each, sharing a single header
+  ngraph::he::TCPMessage message(ngraph::he::MessageType::max_request, ciphers,
+                                 2, thread_pool);
+  EXPECT_EQ(message.count(), 2u);
+  EXPECT_EQ(message.data_size(),
+            ngraph::he::CiphertextBatchHeader::serialized_size +
+                ciphers.size() * (8 + 8 * ciphers[0].uint64_count()));
+
+  vector<Ciphertext> loaded;
+  message.load_ciphertexts(loaded, context, thread_pool);
+  ASSERT_EQ(loaded.size(), ciphers.size());
+  for (size_t i = 0; i < loaded.size(); ++i) {
+    EXPECT_EQ(loaded[i].parms_id(), ciphers[i].parms_id());
+    EXPECT_EQ(loaded[i].scale(), ciphers[i].scale());
+    ASSERT_EQ(loaded[i].uint64_count(), ciphers[i].uint64_count());
+    EXPECT_EQ(memcmp(loaded[i].data(), ciphers[i].data(),
+                     8 * loaded[i].uint64_count()),
+              0);
+  }
+}
+
+TEST(seal_example, ciphertext_frames) {
+  using namespace seal;
+
+  EncryptionParameters parms(scheme_type::CKKS);
+  size_t poly_modulus_degree = 4096;
+  parms.set_poly_modulus_degree(poly_modulus_degree);
+  parms.set_coeff_modulus(
+      CoeffModulus::Create(poly_modulus_degree, {40, 40, 40}));
+  auto context = SEALContext::Create(parms);
+
+  KeyGenerator keygen(context);
+  Encryptor encryptor(context, keygen.public_key());
+  CKKSEncoder encoder(context);
+  ngraph::he::ThreadPool thread_pool(2);
+
+  vector<Ciphertext> ciphers(10);
+  for (size_t i = 0; i < ciphers.size(); ++i) {
+    Plaintext plain;
+    encoder.encode(static_cast<double>(i), pow(2.0, 20), plain);
+    encryptor.encrypt(plain, ciphers[i]);
+  }
+
+  // Frames of at most three elements of two ciphertexts each
+  size_t element_size = 2 * (8 + 8 * ciphers[0].uint64_count());
+  vector<ngraph::he::TCPMessage> frames;
+  ngraph::he::TCPMessage::encode_frames(
+      ngraph::he::MessageType::max_request, ciphers, 2, thread_pool,
+      [&](ngraph::he::TCPMessage&& frame) {
+        frames.emplace_back(std::move(frame));
+      },
+      3 * element_size + element_size / 2);
+  ASSERT_EQ(frames.size(), 2u);
+  EXPECT_EQ(frames[0].count(), 3u);
+  EXPECT_EQ(frames[1].count(), 2u);
+
+  vector<Ciphertext> loaded(ciphers.size());
+  for (const auto& frame : frames) {
+    EXPECT_EQ(frame.total_count(), 5u);
+    vector<Ciphertext> frame_ciphers;
+    frame.load_ciphertexts(frame_ciphers, context, thread_pool);
+    ASSERT_EQ(frame_ciphers.size(), 2 * frame.count());
+    for (size_t i = 0; i < frame_ciphers.size(); ++i) {
+      loaded[2 * frame.element_offset() + i] = frame_ciphers[i];
+    }
+  }
+  for (size_t i = 0; i < loaded.size(); ++i) {
+    ASSERT_EQ(loaded[i].uint64_count(), ciphers[i].uint64_count());
+    EXPECT_EQ(memcmp(loaded[i].data(), ciphers[i].data(),
+                     8 * loaded[i].uint64_count()),
+              0);
+  }
+}
+
+TEST(seal_example, zero_ciphertext_pool) {
+  using namespace seal;
+
+  EncryptionParameters parms(scheme_type::CKKS);
+  size_t poly_modulus_degree = 4096;
+  parms.set_poly_modulus_degree(poly_modulus_degree);
+  parms.set_coeff_modulus(
+      CoeffModulus::Create(poly_modulus_degree, {40, 40, 40}));
+  auto context = SEALContext::Create(parms);
+
+  KeyGenerator keygen(context);
+  auto secret_key = make_shared<SecretKey>(keygen.secret_key());
+  Decryptor decryptor(context, *secret_key);
+  CKKSEncoder encoder(context);
+
+  ngraph::he::ZeroCiphertextPool zero_pool(context, secret_key, 2);
+  zero_pool.add_level(context->first_parms_id());
+  while (zero_pool.size(context->first_parms_id()) < 2) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  // The first two encryptions use pooled encryptions of zero, which are not
+  // reused; later ones may encrypt directly
+  vector<double> input{0.0, 1.1, -2.2, 3.3};
+  Plaintext plain;
+  encoder.encode(input, pow(2.0, 30), plain);
+  vector<ngraph::he::SeededCiphertext> ciphers(4);
+  for (auto& cipher : ciphers) {
+    zero_pool.encrypt(plain, cipher, MemoryManager::GetPool());
+  }
+  EXPECT_NE(ciphers[0].seed, ciphers[1].seed);
+
+  for (const auto& cipher : ciphers) {
+    EXPECT_EQ(cipher.ciphertext.scale(), plain.scale());
+    Plaintext decrypted;
+    decryptor.decrypt(cipher.ciphertext, decrypted);
+    vector<double> output;
+    encoder.decode(decrypted, output);
+    for (size_t i = 0; i < input.size(); ++i) {
+      EXPECT_NEAR(output[i], input[i], 1e-3);
+    }
+  }
+}
+
+TEST(seal_example, key_cache) {
+  using namespace seal;
+
+  EncryptionParameters parms(scheme_type::CKKS);
+  size_t poly_modulus_degree = 4096;
+  parms.set_poly_modulus_degree(poly_modulus_degree);
+  parms.set_coeff_modulus(
+      CoeffModulus::Create(poly_modulus_degree, {40, 40, 40}));
+  auto context = SEALContext::Create(parms);
+
+  KeyGenerator keygen0(context);
+  ngraph::he::KeyCache::Keys keys0{
+      make_shared<PublicKey>(keygen0.public_key()),
+      make_shared<RelinKeys>(keygen0.relin_keys())};
+  KeyGenerator keygen1(context);
+  ngraph::he::KeyCache::Keys keys1{
+      make_shared<PublicKey>(keygen1.public_key()),
+      make_shared<RelinKeys>(keygen1.relin_keys())};
+
+  char dir_template[] = "/tmp/he_key_cache_XXXXXX";
+  ASSERT_NE(mkdtemp(dir_template), nullptr);
+  string dir(dir_template);
+
+  // Key ids are derived from the public key
+  string key_id0 = ngraph::he::key_id_from_public_key(*keys0.public_key);
+  string key_id1 = ngraph::he::key_id_from_public_key(*keys1.public_key);
+  EXPECT_TRUE(ngraph::he::is_valid_key_id(key_id0));
+  EXPECT_FALSE(ngraph::he::is_valid_key_id("../key"));
+  EXPECT_NE(key_id0, key_id1);
+  EXPECT_EQ(key_id0, ngraph::he::key_id_from_public_key(keygen0.public_key()));
+
+  {
+    // Only one key is kept in memory
+    ngraph::he::KeyCache cache(dir, 1, 4);
+    EXPECT_TRUE(cache.insert(key_id0, keys0));
+    EXPECT_TRUE(cache.insert(key_id1, keys1));
+
+    // Keys are neither stored under the id of other keys, nor replaced
+    EXPECT_THROW(cache.insert(key_id0, keys1), ngraph::CheckFailure);
+    ngraph::he::KeyCache::Keys other_relin_keys{
+        keys1.public_key, make_shared<RelinKeys>(keygen0.relin_keys())};
+    EXPECT_FALSE(cache.insert(key_id1, other_relin_keys));
+    EXPECT_FALSE(cache.insert(key_id0, keys0));
+
+    ngraph::he::KeyCache::Keys found;
+    EXPECT_TRUE(cache.find(key_id1, context, found));
+    EXPECT_EQ(found.relin_keys, keys1.relin_keys);
+    // Reloaded from disk
+    EXPECT_TRUE(cache.find(key_id0, context, found));
+    EXPECT_NE(found.relin_keys, keys0.relin_keys);
+    EXPECT_EQ(found.relin_keys->parms_id(), context->key_parms_id());
+    EXPECT_FALSE(cache.find(string(64, 'a'), context, found));
+    EXPECT_FALSE(cache.find("../key", context, found));
+  }
+
+  // Keys persist across caches
+  ngraph::he::KeyCache cache(dir);
+  ngraph::he::KeyCache::Keys found;
+  EXPECT_TRUE(cache.find(key_id1, context, found));
+  EXPECT_EQ(ngraph::he::key_id_from_public_key(*found.public_key), key_id1);
+
+  remove((dir + "/" + key_id0 + ".keys").c_str());
+  remove((dir + "/" + key_id1 + ".keys").c_str());
+  rmdir(dir.c_str());
+}
+
+TEST(seal_util, positive_size_from_env) {
+  unsetenv("NGRAPH_HE_TEST_SIZE");
+  EXPECT_EQ(ngraph::he::positive_size_from_env("NGRAPH_HE_TEST_SIZE", 7), 7u);
+  setenv("NGRAPH_HE_TEST_SIZE", "4", 1);
+  EXPECT_EQ(ngraph::he::positive_size_from_env("NGRAPH_HE_TEST_SIZE", 7), 4u);
+  for (const char* value : {"0", "-1", "four", "", "4x"}) {
+    setenv("NGRAPH_HE_TEST_SIZE", value, 1);
+    EXPECT_ANY_THROW(
+        ngraph::he::positive_size_from_env("NGRAPH_HE_TEST_SIZE", 7));
+  }
+  unsetenv("NGRAPH_HE_TEST_SIZE");
+}
+
+TEST(seal_util, spatial_stream_index) {
+  // Each row along axis 2 holds that row of both channels
+  vector<size_t> shape{1, 2, 4, 3};
+  vector<size_t> indices;
+  for (size_t i = 0; i < 24; ++i) {
+    indices.emplace_back(ngraph::he::spatial_stream_index(i, shape));
+  }
+  EXPECT_EQ(indices,
+            (vector<size_t>{0,  1,  2,  12, 13, 14, 3,  4,  5,  15, 16, 17,
+                            6,  7,  8,  18, 19, 20, 9,  10, 11, 21, 22, 23}));
+}
+
+TEST(seal_util, multiplicative_depth) {
+  using namespace ngraph;
+  Shape shape{2, 2};
+  auto a = make_shared<op::Parameter>(element::f32, shape);
+  auto w = op::Constant::create(element::f32, shape, {1, 2, 3, 4});
+  auto dot = make_shared<op::Dot>(a, w);
+  // Plaintext products do not use levels
+  auto plain = make_shared<op::Multiply>(w, w);
+  auto t = make_shared<op::Multiply>(make_shared<op::Add>(dot, plain), dot);
+  auto f = make_shared<Function>(t, ParameterVector{a});
+
+  EXPECT_EQ(ngraph::he::multiplicative_depth(*f), 2u);
+  EXPECT_EQ(ngraph::he::multiplicative_depth(*f, true), 2u);
+}
+
+TEST(seal_util, select_encryption_parameters) {
+  ngraph::he::ParameterRequirements requirements;
+  requirements.multiplicative_depth = 2;
+  auto parms = ngraph::he::select_encryption_parameters(requirements);
+  EXPECT_EQ(parms.poly_modulus_degree(), 4096u);
+  EXPECT_EQ(parms.coeff_modulus_bits(), (vector<int>{30, 24, 24, 30}));
+
+  // 132 bits exceed the 109 bits of N=4096 at 128-bit security
+  requirements.multiplicative_depth = 3;
+  parms = ngraph::he::select_encryption_parameters(requirements);
+  EXPECT_EQ(parms.poly_modulus_degree(), 8192u);
+
+  // N/2 slots hold the batch
+  requirements.multiplicative_depth = 1;
+  requirements.slot_count = 4096;
+  parms = ngraph::he::select_encryption_parameters(requirements);
+  EXPECT_EQ(parms.poly_modulus_degree(), 8192u);
+
+  requirements.slot_count = 1;
+  requirements.security_level = 256;
+  requirements.multiplicative_depth = 100;
+  EXPECT_ANY_THROW(ngraph::he::select_encryption_parameters(requirements));
+
+  // The configuration is of the form read from NGRAPH_HE_SEAL_CONFIG
+  requirements.multiplicative_depth = 2;
+  requirements.security_level = 128;
+  auto js = nlohmann::json::parse(ngraph::he::config_json(
+      ngraph::he::select_encryption_parameters(requirements)));
+  EXPECT_EQ(js["scheme_name"], "HE_SEAL");
+  EXPECT_EQ(js["poly_modulus_degree"], 4096);
+  EXPECT_EQ(js["security_level"], 128);
+  EXPECT_EQ(js["coeff_modulus"], (vector<int>{30, 24, 24, 30}));
+}
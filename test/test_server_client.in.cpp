@@ -14,11 +14,15 @@
 // limitations under the License.
 //*****************************************************************************
 
+#include <stdlib.h>
+#include <algorithm>
 #include <chrono>
 #include <memory>
+#include <mutex>
 #include <thread>
 #include <vector>
 
+#include "ngraph/file_util.hpp"
 #include "ngraph/ngraph.hpp"
 #include "seal/he_seal_backend.hpp"
 #include "seal/he_seal_client.hpp"
@@ -34,6 +38,96 @@ using namespace ngraph;
 
 static string s_manifest = "${MANIFEST}";
 
+namespace {
+// Forwards messages between a client connecting to listen_port and the server
+// at server_port. The first held_count relu results are held back, then
+// forwarded in reverse order, so the server receives them out of order
+class ReorderingProxy {
+ public:
+  ReorderingProxy(size_t listen_port, size_t server_port, size_t held_count)
+      : m_acceptor(m_io_context,
+                   ngraph::he::server_endpoint(ngraph::he::Transport::tcp,
+                                               listen_port)),
+        m_held_count(held_count) {
+    m_acceptor.async_accept([this, server_port](
+                                boost::system::error_code ec,
+                                ngraph::he::stream_protocol::socket socket) {
+      ASSERT_FALSE(ec) << ec.message();
+      // Connect to the server once the client is connected, so no server
+      // message arrives before it can be forwarded
+      m_client = make_shared<ngraph::he::TCPSession>(
+          std::move(socket), [this](ngraph::he::TCPMessage&& message) {
+            forward_to_server(std::move(message));
+          });
+      m_server = make_unique<ngraph::he::TCPClient>(
+          m_io_context,
+          ngraph::he::client_endpoints(m_io_context,
+                                       ngraph::he::Transport::tcp,
+                                       "localhost", server_port),
+          [this](ngraph::he::TCPMessage&& message) {
+            m_client->write_message(std::move(message));
+          });
+      m_client->start();
+    });
+    m_thread = std::thread([this]() { m_io_context.run(); });
+  }
+
+  ~ReorderingProxy() {
+    // Waits until the client session stops forwarding messages
+    if (m_client != nullptr) {
+      m_client->close();
+    }
+    // The server only stops reading once its connection is closed
+    if (m_server != nullptr) {
+      try {
+        m_server->close();
+      } catch (const std::exception& e) {
+        NGRAPH_INFO << "Proxy error closing connection: " << e.what();
+      }
+    }
+    m_io_context.stop();
+    m_thread.join();
+  }
+
+  size_t held_results() const {
+    lock_guard<mutex> guard(m_mutex);
+    return m_held_results;
+  }
+
+ private:
+  void forward_to_server(ngraph::he::TCPMessage&& message) {
+    if (message.message_type() != ngraph::he::MessageType::relu_result) {
+      m_server->write_message(std::move(message));
+      return;
+    }
+    lock_guard<mutex> guard(m_mutex);
+    if (m_held_results == m_held_count) {
+      m_server->write_message(std::move(message));
+      return;
+    }
+    m_held.emplace_back(std::move(message));
+    m_held_results++;
+    if (m_held_results == m_held_count) {
+      for (auto it = m_held.rbegin(); it != m_held.rend(); ++it) {
+        m_server->write_message(std::move(*it));
+      }
+      m_held.clear();
+    }
+  }
+
+  boost::asio::io_context m_io_context;
+  ngraph::he::stream_acceptor m_acceptor;
+  shared_ptr<ngraph::he::TCPSession> m_client;
+  unique_ptr<ngraph::he::TCPClient> m_server;
+  std::thread m_thread;
+
+  size_t m_held_count;
+  mutable mutex m_mutex;
+  size_t m_held_results{0};
+  vector<ngraph::he::TCPMessage> m_held;
+};
+}  // namespace
+
 NGRAPH_TEST(${BACKEND_NAME}, server_client_add_3) {
   auto backend = runtime::Backend::create("${BACKEND_NAME}");
   auto he_backend = static_cast<ngraph::he::HESealBackend*>(backend.get());
@@ -156,6 +250,109 @@ NGRAPH_TEST(${BACKEND_NAME}, server_client_relu) {
   EXPECT_TRUE(all_close(results, vector<float>{0, 0, 3}, 1e-3f));
 }
 
+NGRAPH_TEST(${BACKEND_NAME}, server_client_relu_branches) {
+  auto backend = runtime::Backend::create("${BACKEND_NAME}");
+  auto he_backend = static_cast<ngraph::he::HESealBackend*>(backend.get());
+
+  size_t batch_size = 1;
+
+  Shape shape{batch_size, 3};
+  auto a = make_shared<op::Parameter>(element::f32, shape);
+  // Independent Relu ops, whose client requests are outstanding concurrently
+  auto relu_pos = make_shared<op::Relu>(a);
+  auto relu_neg = make_shared<op::Relu>(make_shared<op::Negative>(a));
+  auto abs = make_shared<op::Add>(relu_pos, relu_neg);
+  auto f = make_shared<Function>(abs, ParameterVector{a});
+
+  // Server inputs which are not used
+  auto t_dummy = he_backend->create_plain_tensor(element::f32, shape);
+  auto t_result = he_backend->create_cipher_tensor(element::f32, shape);
+
+  // Used for dummy server inputs
+  float DUMMY_FLOAT = 99;
+  copy_data(t_dummy, vector<float>{DUMMY_FLOAT, DUMMY_FLOAT, DUMMY_FLOAT});
+
+  vector<float> inputs{-1, -0.2, 3};
+  vector<float> results;
+  auto client_thread = std::thread([&inputs, &results, &batch_size]() {
+    auto he_client =
+        ngraph::he::HESealClient("localhost", 34000, batch_size, inputs);
+
+    while (!he_client.is_done()) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    results = he_client.get_results();
+  });
+
+  auto handle = dynamic_pointer_cast<ngraph::he::HESealExecutable>(
+      he_backend->compile(f));
+  handle->enable_client();
+  handle->call_with_validate({t_result}, {t_dummy});
+
+  client_thread.join();
+  EXPECT_TRUE(all_close(results, vector<float>{1, 0.2, 3}, 1e-3f));
+  // Both branches become ready when a is available, and one is awaiting the
+  // client while the other runs
+  EXPECT_GE(handle->max_concurrent_steps(), 2u);
+}
+
+NGRAPH_TEST(${BACKEND_NAME}, server_client_relu_chunks_out_of_order) {
+  // Smaller requests, so a few hundred elements take several requests, as
+  // more than default_client_message_size elements do by default
+  const size_t message_size = 100;
+  const size_t chunk_count = 4;
+  ASSERT_LE(chunk_count,
+            ngraph::he::HESealExecutable::max_client_requests_in_flight);
+  setenv("NGRAPH_HE_CLIENT_MESSAGE_SIZE", to_string(message_size).c_str(), 1);
+
+  auto backend = runtime::Backend::create("${BACKEND_NAME}");
+  auto he_backend = static_cast<ngraph::he::HESealBackend*>(backend.get());
+
+  size_t batch_size = 1;
+
+  Shape shape{batch_size, message_size * chunk_count};
+  auto a = make_shared<op::Parameter>(element::f32, shape);
+  auto relu = make_shared<op::Relu>(a);
+  auto f = make_shared<Function>(relu, ParameterVector{a});
+
+  // Server inputs which are not used
+  auto t_dummy = he_backend->create_plain_tensor(element::f32, shape);
+  auto t_result = he_backend->create_cipher_tensor(element::f32, shape);
+
+  vector<float> inputs(shape_size(shape));
+  vector<float> exp_results(shape_size(shape));
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    inputs[i] = (i % 2 == 0) ? -static_cast<float>(i % 7) : i % 5;
+    exp_results[i] = std::max(inputs[i], 0.0f);
+  }
+
+  // Every chunk is in flight at once, since the proxy only forwards the
+  // results once all are answered, in reverse order
+  auto proxy = make_unique<ReorderingProxy>(34001, 34000, chunk_count);
+
+  vector<float> results;
+  auto client_thread = std::thread([&inputs, &results, &batch_size]() {
+    auto he_client =
+        ngraph::he::HESealClient("localhost", 34001, batch_size, inputs);
+
+    while (!he_client.is_done()) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    results = he_client.get_results();
+  });
+
+  auto handle = dynamic_pointer_cast<ngraph::he::HESealExecutable>(
+      he_backend->compile(f));
+  handle->enable_client();
+  handle->call_with_validate({t_result}, {t_dummy});
+
+  client_thread.join();
+  EXPECT_EQ(proxy->held_results(), chunk_count);
+  proxy = nullptr;
+  unsetenv("NGRAPH_HE_CLIENT_MESSAGE_SIZE");
+  EXPECT_TRUE(all_close(results, exp_results, 1e-3f));
+}
+
 NGRAPH_TEST(${BACKEND_NAME}, server_client_pad_relu) {
   auto backend = runtime::Backend::create("${BACKEND_NAME}");
   auto he_backend = static_cast<ngraph::he::HESealBackend*>(backend.get());
@@ -266,3 +463,239 @@ NGRAPH_TEST(${BACKEND_NAME}, server_client_relu_packed) {
     }
   }
 }
+
+NGRAPH_TEST(${BACKEND_NAME}, server_client_maxpool) {
+  auto backend = runtime::Backend::create("${BACKEND_NAME}");
+  auto he_backend = static_cast<ngraph::he::HESealBackend*>(backend.get());
+
+  size_t batch_size = 1;
+
+  Shape shape{batch_size, 1, 14};
+  Shape window_shape{3};
+  auto a = make_shared<op::Parameter>(element::f32, shape);
+  Shape result_shape{batch_size, 1, 12};
+  auto f = make_shared<Function>(make_shared<op::MaxPool>(a, window_shape),
+                                 ParameterVector{a});
+
+  // Server inputs which are not used
+  auto t_dummy = he_backend->create_plain_tensor(element::f32, shape);
+  auto t_result = he_backend->create_cipher_tensor(element::f32, result_shape);
+
+  // Used for dummy server inputs
+  float DUMMY_FLOAT = 99;
+  copy_data(t_dummy, vector<float>(shape_size(shape), DUMMY_FLOAT));
+
+  vector<float> inputs{0, 1, 0, 2, 1, 0, 3, 2, 0, 0, 2, 0, 0, 0};
+  vector<float> results;
+  auto client_thread = std::thread([&inputs, &results, &batch_size]() {
+    auto he_client =
+        ngraph::he::HESealClient("localhost", 34000, batch_size, inputs);
+
+    while (!he_client.is_done()) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    results = he_client.get_results();
+  });
+
+  auto handle = dynamic_pointer_cast<ngraph::he::HESealExecutable>(
+      he_backend->compile(f));
+  handle->enable_client();
+  handle->call_with_validate({t_result}, {t_dummy});
+
+  client_thread.join();
+  EXPECT_TRUE(all_close(
+      results, vector<float>{1, 2, 2, 2, 3, 3, 3, 2, 2, 2, 2, 0}, 1e-3f));
+}
+
+NGRAPH_TEST(${BACKEND_NAME}, server_client_streaming_convolution) {
+  auto backend = runtime::Backend::create("${BACKEND_NAME}");
+  auto he_backend = static_cast<ngraph::he::HESealBackend*>(backend.get());
+
+  size_t batch_size = 1;
+
+  Shape shape{batch_size, 2, 4, 3};
+  Shape filter_shape{1, 2, 2, 2};
+  Shape result_shape{batch_size, 1, 4, 2};
+  auto a = make_shared<op::Parameter>(element::f32, shape);
+  auto b = op::Constant::create(element::f32, filter_shape,
+                                vector<float>{1, 0, 2, 1, 0, 1, 1, 2});
+  auto t = make_shared<op::Convolution>(a, b, Strides{1, 1},  // move_strides
+                                        Strides{1, 1},  // filter_dilation
+                                        CoordinateDiff{1, 0},  // below_pads
+                                        CoordinateDiff{0, 0},  // above_pads
+                                        Strides{1, 1});        // data_dilation
+  auto f = make_shared<Function>(t, ParameterVector{a});
+
+  // Server inputs which are not used
+  auto t_dummy = he_backend->create_plain_tensor(element::f32, shape);
+  auto t_result = he_backend->create_cipher_tensor(element::f32, result_shape);
+
+  // Used for dummy server inputs
+  float DUMMY_FLOAT = 99;
+  copy_data(t_dummy, vector<float>(shape_size(shape), DUMMY_FLOAT));
+
+  vector<float> inputs(shape_size(shape));
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    inputs[i] = i % 5;
+  }
+  vector<float> results;
+  auto client_thread = std::thread([&inputs, &results, &batch_size]() {
+    auto he_client =
+        ngraph::he::HESealClient("localhost", 34000, batch_size, inputs);
+
+    while (!he_client.is_done()) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    results = he_client.get_results();
+  });
+
+  // The input is streamed row by row into the convolution
+  setenv("NGRAPH_HE_STREAM_INPUT", "1", 1);
+  auto handle = dynamic_pointer_cast<ngraph::he::HESealExecutable>(
+      he_backend->compile(f));
+  handle->enable_client();
+  unsetenv("NGRAPH_HE_STREAM_INPUT");
+  handle->call_with_validate({t_result}, {t_dummy});
+
+  client_thread.join();
+  EXPECT_TRUE(all_close(results, vector<float>{9, 15, 15, 18, 19, 17, 18, 11},
+                        1e-3f));
+}
+
+NGRAPH_TEST(${BACKEND_NAME}, server_client_relu_unix_socket) {
+  auto backend = runtime::Backend::create("${BACKEND_NAME}");
+  auto he_backend = static_cast<ngraph::he::HESealBackend*>(backend.get());
+
+  size_t batch_size = 1;
+
+  Shape shape{batch_size, 3};
+  auto a = make_shared<op::Parameter>(element::f32, shape);
+  auto relu = make_shared<op::Relu>(a);
+  auto f = make_shared<Function>(relu, ParameterVector{a});
+
+  // Server inputs which are not used
+  auto t_dummy = he_backend->create_plain_tensor(element::f32, shape);
+  auto t_result = he_backend->create_cipher_tensor(element::f32, shape);
+
+  // Used for dummy server inputs
+  float DUMMY_FLOAT = 99;
+  copy_data(t_dummy, vector<float>{DUMMY_FLOAT, DUMMY_FLOAT, DUMMY_FLOAT});
+
+  // Both server and client communicate over a Unix domain socket
+  setenv("NGRAPH_HE_TRANSPORT", "unix", 1);
+
+  vector<float> inputs{-1, -0.2, 3};
+  vector<float> results;
+  auto client_thread = std::thread([&inputs, &results, &batch_size]() {
+    auto he_client =
+        ngraph::he::HESealClient("localhost", 34000, batch_size, inputs);
+
+    while (!he_client.is_done()) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    results = he_client.get_results();
+  });
+
+  auto handle = dynamic_pointer_cast<ngraph::he::HESealExecutable>(
+      he_backend->compile(f));
+  handle->enable_client();
+  handle->call_with_validate({t_result}, {t_dummy});
+
+  client_thread.join();
+  unsetenv("NGRAPH_HE_TRANSPORT");
+  EXPECT_TRUE(all_close(results, vector<float>{0, 0, 3}, 1e-3f));
+}
+
+NGRAPH_TEST(${BACKEND_NAME}, server_client_relu_loopback) {
+  auto backend = runtime::Backend::create("${BACKEND_NAME}");
+  auto he_backend = static_cast<ngraph::he::HESealBackend*>(backend.get());
+
+  size_t batch_size = 1;
+
+  Shape shape{batch_size, 3};
+  auto a = make_shared<op::Parameter>(element::f32, shape);
+  auto relu = make_shared<op::Relu>(a);
+  auto f = make_shared<Function>(relu, ParameterVector{a});
+
+  // Server inputs which are not used
+  auto t_dummy = he_backend->create_plain_tensor(element::f32, shape);
+  auto t_result = he_backend->create_cipher_tensor(element::f32, shape);
+
+  // Used for dummy server inputs
+  float DUMMY_FLOAT = 99;
+  copy_data(t_dummy, vector<float>{DUMMY_FLOAT, DUMMY_FLOAT, DUMMY_FLOAT});
+
+  // The client runs in-process, without a socket
+  auto handle = dynamic_pointer_cast<ngraph::he::HESealExecutable>(
+      he_backend->compile(f));
+  auto channel = handle->enable_loopback_client();
+
+  vector<float> inputs{-1, -0.2, 3};
+  ngraph::he::HESealClient he_client(channel, batch_size, inputs);
+  handle->call_with_validate({t_result}, {t_dummy});
+
+  while (!he_client.is_done()) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  EXPECT_TRUE(all_close(he_client.get_results(), vector<float>{0, 0, 3},
+                        1e-3f));
+}
+
+NGRAPH_TEST(${BACKEND_NAME}, server_client_cached_keys) {
+  char key_dir[] = "/tmp/he_client_keys_XXXXXX";
+  char key_cache_dir[] = "/tmp/he_server_keys_XXXXXX";
+  ASSERT_NE(mkdtemp(key_dir), nullptr);
+  ASSERT_NE(mkdtemp(key_cache_dir), nullptr);
+  setenv("NGRAPH_HE_KEY_DIR", key_dir, 1);
+  setenv("NGRAPH_HE_KEY_CACHE_DIR", key_cache_dir, 1);
+
+  // The second client reuses the keys saved by the first one, and the second
+  // server loads them from the cache directory instead of receiving them
+  for (size_t round = 0; round < 2; ++round) {
+    auto backend = runtime::Backend::create("${BACKEND_NAME}");
+    auto he_backend = static_cast<ngraph::he::HESealBackend*>(backend.get());
+
+    size_t batch_size = 1;
+
+    Shape shape{batch_size, 3};
+    auto a = make_shared<op::Parameter>(element::f32, shape);
+    auto relu = make_shared<op::Relu>(a);
+    auto f = make_shared<Function>(relu, ParameterVector{a});
+
+    // Server inputs which are not used
+    auto t_dummy = he_backend->create_plain_tensor(element::f32, shape);
+    auto t_result = he_backend->create_cipher_tensor(element::f32, shape);
+
+    // Used for dummy server inputs
+    float DUMMY_FLOAT = 99;
+    copy_data(t_dummy, vector<float>{DUMMY_FLOAT, DUMMY_FLOAT, DUMMY_FLOAT});
+
+    auto handle = dynamic_pointer_cast<ngraph::he::HESealExecutable>(
+        he_backend->compile(f));
+    auto channel = handle->enable_loopback_client();
+
+    vector<float> inputs{-1, -0.2, 3};
+    ngraph::he::HESealClient he_client(channel, batch_size, inputs);
+    handle->call_with_validate({t_result}, {t_dummy});
+
+    while (!he_client.is_done()) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_TRUE(all_close(he_client.get_results(), vector<float>{0, 0, 3},
+                          1e-3f));
+    EXPECT_EQ(he_backend->get_key_cache().hit_count(), round);
+  }
+
+  // One key file each for the client and the server
+  for (const char* dir : {key_dir, key_cache_dir}) {
+    size_t file_count = 0;
+    file_util::iterate_files(
+        dir, [&file_count](const string&, bool) { file_count++; });
+    EXPECT_EQ(file_count, 1u) << dir;
+  }
+
+  unsetenv("NGRAPH_HE_KEY_DIR");
+  unsetenv("NGRAPH_HE_KEY_CACHE_DIR");
+  file_util::remove_directory(key_dir);
+  file_util::remove_directory(key_cache_dir);
+}
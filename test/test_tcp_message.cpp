@@ -0,0 +1,436 @@
+//*****************************************************************************
+// Copyright 2018-2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//*****************************************************************************
+
+#include <atomic>
+#include <boost/asio.hpp>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "tcp/message_buffer_pool.hpp"
+#include "tcp/spsc_queue.hpp"
+#include "tcp/tcp_message.hpp"
+#include "tcp/tcp_session.hpp"
+
+using namespace std;
+
+namespace {
+// Returns a message holding value, padded to size bytes
+ngraph::he::TCPMessage value_message(size_t value, size_t size) {
+  vector<char> data(size);
+  memcpy(data.data(), &value, sizeof(value));
+  return ngraph::he::TCPMessage(ngraph::he::MessageType::parameter_size, 1,
+                                data.size(), data.data());
+}
+
+// Reads the next message from socket and returns the value it holds
+size_t read_value(boost::asio::local::stream_protocol::socket& socket) {
+  ngraph::he::TCPMessage message;
+  boost::asio::read(socket,
+                    boost::asio::buffer(message.header_ptr(),
+                                        ngraph::he::TCPMessage::header_length));
+  EXPECT_TRUE(message.decode_header());
+  boost::asio::read(socket, boost::asio::buffer(message.body_ptr(),
+                                                message.body_length()));
+  message.decode_body();
+  size_t value;
+  memcpy(&value, message.data_ptr(), sizeof(value));
+  return value;
+}
+}  // namespace
+
+TEST(tcp_message, buffer_pool_reuse) {
+  ngraph::he::MessageBufferPool pool;
+
+  size_t capacity;
+  char* buffer = pool.acquire(10000, capacity);
+  EXPECT_GE(capacity, 10000u);
+  EXPECT_EQ(capacity % ngraph::he::MessageBufferPool::granularity, 0u);
+  pool.release(buffer, capacity);
+  EXPECT_EQ(pool.cached_bytes(), capacity);
+
+  // Similar sizes reuse the cached buffer
+  size_t reused_capacity;
+  char* reused_buffer = pool.acquire(9000, reused_capacity);
+  EXPECT_EQ(reused_buffer, buffer);
+  EXPECT_EQ(reused_capacity, capacity);
+  EXPECT_EQ(pool.cached_bytes(), 0u);
+  pool.release(reused_buffer, reused_capacity);
+
+  // Much smaller requests do not take the large buffer
+  size_t small_capacity;
+  char* small_buffer = pool.acquire(10, small_capacity);
+  EXPECT_NE(small_buffer, buffer);
+  EXPECT_LT(small_capacity, capacity);
+  pool.release(small_buffer, small_capacity);
+}
+
+TEST(tcp_message, buffer_pool_limit) {
+  size_t granularity = ngraph::he::MessageBufferPool::granularity;
+  ngraph::he::MessageBufferPool pool(granularity);
+
+  size_t capacity0;
+  size_t capacity1;
+  char* buffer0 = pool.acquire(1, capacity0);
+  char* buffer1 = pool.acquire(1, capacity1);
+  pool.release(buffer0, capacity0);
+  pool.release(buffer1, capacity1);
+  EXPECT_EQ(pool.cached_bytes(), granularity);
+}
+
+TEST(tcp_message, buffer_pool_trim) {
+  size_t granularity = ngraph::he::MessageBufferPool::granularity;
+  ngraph::he::MessageBufferPool pool;
+
+  size_t capacity0;
+  size_t capacity1;
+  char* buffer0 = pool.acquire(1, capacity0);
+  char* buffer1 = pool.acquire(3 * granularity, capacity1);
+  pool.release(buffer0, capacity0);
+  pool.release(buffer1, capacity1);
+  EXPECT_EQ(pool.cached_bytes(), capacity0 + capacity1);
+
+  // Largest buffers are freed first
+  pool.trim(capacity0);
+  EXPECT_EQ(pool.cached_bytes(), capacity0);
+  pool.trim();
+  EXPECT_EQ(pool.cached_bytes(), 0);
+}
+
+TEST(tcp_message, right_sized) {
+  size_t value = 7;
+  ngraph::he::TCPMessage message(ngraph::he::MessageType::parameter_size, 1,
+                                 sizeof(value),
+                                 reinterpret_cast<char*>(&value));
+  EXPECT_GE(message.capacity(), message.num_bytes());
+  EXPECT_LE(message.capacity(),
+            static_cast<size_t>(ngraph::he::MessageBufferPool::granularity));
+
+  size_t decoded_value;
+  memcpy(&decoded_value, message.data_ptr(), sizeof(decoded_value));
+  EXPECT_EQ(decoded_value, value);
+}
+
+TEST(tcp_message, decode_resizes) {
+  vector<char> data(100000, 'a');
+  ngraph::he::TCPMessage large_message(ngraph::he::MessageType::relu_result, 1,
+                                       data.size(), data.data());
+  large_message.set_request_id(3);
+  large_message.set_result_chain_index(2);
+
+  // Simulate reading large_message into a default-constructed message
+  ngraph::he::TCPMessage read_message;
+  memcpy(read_message.header_ptr(), large_message.header_ptr(),
+         ngraph::he::TCPMessage::header_length);
+  EXPECT_TRUE(read_message.decode_header());
+  EXPECT_GE(read_message.capacity(), large_message.num_bytes());
+  memcpy(read_message.body_ptr(), large_message.body_ptr(),
+         large_message.body_length());
+  EXPECT_TRUE(read_message.decode_body());
+  EXPECT_EQ(read_message.message_type(), ngraph::he::MessageType::relu_result);
+  EXPECT_EQ(read_message.request_id(), 3u);
+  EXPECT_EQ(read_message.result_chain_index(), 2u);
+  EXPECT_EQ(read_message.count(), 1u);
+  EXPECT_EQ(memcmp(read_message.data_ptr(), data.data(), data.size()), 0);
+
+  // A following small message shrinks the buffer again
+  size_t value = 7;
+  ngraph::he::TCPMessage small_message(ngraph::he::MessageType::parameter_size,
+                                       1, sizeof(value),
+                                       reinterpret_cast<char*>(&value));
+  memcpy(read_message.header_ptr(), small_message.header_ptr(),
+         ngraph::he::TCPMessage::header_length);
+  EXPECT_TRUE(read_message.decode_header());
+  EXPECT_LE(read_message.capacity(),
+            static_cast<size_t>(ngraph::he::MessageBufferPool::granularity));
+}
+
+TEST(tcp_message, copy) {
+  vector<char> data(1000, 'b');
+  ngraph::he::TCPMessage message(ngraph::he::MessageType::relu_result, 10,
+                                 data.size(), data.data());
+  message.set_request_id(5);
+  message.set_result_chain_index(1);
+
+  ngraph::he::TCPMessage copy = message.copy();
+  EXPECT_EQ(copy.message_type(), message.message_type());
+  EXPECT_EQ(copy.request_id(), 5u);
+  EXPECT_EQ(copy.result_chain_index(), 1u);
+  EXPECT_EQ(copy.count(), 10u);
+  ASSERT_EQ(copy.num_bytes(), message.num_bytes());
+  EXPECT_NE(copy.header_ptr(), message.header_ptr());
+  EXPECT_EQ(memcmp(copy.header_ptr(), message.header_ptr(), copy.num_bytes()),
+            0);
+}
+
+TEST(tcp_message, frame) {
+  vector<char> data(30, 'c');
+  ngraph::he::TCPMessage message(ngraph::he::MessageType::execute, 3,
+                                 data.size(), data.data());
+  EXPECT_EQ(message.element_offset(), 0u);
+  EXPECT_EQ(message.total_count(), 3u);
+  message.set_frame(6, 9);
+  EXPECT_THROW(message.set_frame(7, 9), ngraph::CheckFailure);
+
+  ngraph::he::TCPMessage read_message;
+  memcpy(read_message.header_ptr(), message.header_ptr(),
+         ngraph::he::TCPMessage::header_length);
+  EXPECT_TRUE(read_message.decode_header());
+  memcpy(read_message.body_ptr(), message.body_ptr(), message.body_length());
+  EXPECT_TRUE(read_message.decode_body());
+  EXPECT_EQ(read_message.count(), 3u);
+  EXPECT_EQ(read_message.element_offset(), 6u);
+  EXPECT_EQ(read_message.total_count(), 9u);
+  EXPECT_EQ(memcmp(read_message.data_ptr(), data.data(), data.size()), 0);
+}
+
+TEST(tcp_message, byte_frames) {
+  string data(1000, 'd');
+  data[999] = 'e';
+  vector<ngraph::he::TCPMessage> frames;
+  ngraph::he::TCPMessage::encode_frames(
+      ngraph::he::MessageType::eval_key, data,
+      [&](ngraph::he::TCPMessage&& frame) {
+        frames.emplace_back(std::move(frame));
+      },
+      300);
+  ASSERT_EQ(frames.size(), 4u);
+  string joined;
+  for (const auto& frame : frames) {
+    EXPECT_EQ(frame.element_offset(), joined.size());
+    EXPECT_EQ(frame.total_count(), data.size());
+    joined.append(frame.data_ptr(), frame.data_size());
+  }
+  EXPECT_EQ(frames[3].count(), 100u);
+  EXPECT_EQ(joined, data);
+
+  EXPECT_THROW(ngraph::he::TCPMessage::encode_frames(
+                   ngraph::he::MessageType::eval_key, data,
+                   [](ngraph::he::TCPMessage&&) {},
+                   ngraph::he::TCPMessage::max_frame_size + 1),
+               ngraph::CheckFailure);
+}
+
+TEST(tcp_message, reject_oversized_body) {
+  // A header announcing a body beyond a frame is rejected before the body
+  // buffer is allocated
+  ngraph::he::TCPMessage message;
+  string header = to_string(ngraph::he::TCPMessage::max_body_length + 1);
+  header.resize(ngraph::he::TCPMessage::header_length, '\0');
+  memcpy(message.header_ptr(), header.data(), header.size());
+  EXPECT_THROW(message.decode_header(), std::invalid_argument);
+  EXPECT_LT(message.capacity(), ngraph::he::TCPMessage::max_body_length);
+
+  string max_header = to_string(ngraph::he::TCPMessage::max_body_length);
+  max_header.resize(ngraph::he::TCPMessage::header_length, '\0');
+  memcpy(message.header_ptr(), max_header.data(), max_header.size());
+  EXPECT_TRUE(message.decode_header());
+
+  vector<char> data(ngraph::he::TCPMessage::max_body_length, 'f');
+  EXPECT_THROW(ngraph::he::TCPMessage(ngraph::he::MessageType::eval_key, 1,
+                                      data.size(), data.data()),
+               std::invalid_argument);
+}
+
+TEST(tcp_message, spsc_queue) {
+  ngraph::he::SPSCQueue<size_t> queue(2);
+  EXPECT_EQ(queue.capacity(), 2u);
+  EXPECT_TRUE(queue.empty());
+  EXPECT_TRUE(queue.try_push(1));
+  EXPECT_TRUE(queue.try_push(2));
+  EXPECT_TRUE(queue.full());
+  EXPECT_FALSE(queue.try_push(3));
+
+  size_t item;
+  EXPECT_TRUE(queue.try_pop(item));
+  EXPECT_EQ(item, 1u);
+  EXPECT_TRUE(queue.try_pop(item));
+  EXPECT_EQ(item, 2u);
+  EXPECT_FALSE(queue.try_pop(item));
+}
+
+TEST(tcp_message, spsc_queue_threads) {
+  ngraph::he::SPSCQueue<ngraph::he::TCPMessage> queue(3);
+  size_t message_count = 1000;
+
+  std::thread producer([&]() {
+    for (size_t i = 0; i < message_count; ++i) {
+      ngraph::he::TCPMessage message(ngraph::he::MessageType::parameter_size,
+                                     1, sizeof(i),
+                                     reinterpret_cast<char*>(&i));
+      while (!queue.try_push(std::move(message))) {
+        std::this_thread::yield();
+      }
+    }
+    queue.close();
+  });
+
+  // Messages arrive in order, and pop() returns false once closed and empty
+  size_t received = 0;
+  ngraph::he::TCPMessage message;
+  while (queue.pop(message)) {
+    size_t value;
+    memcpy(&value, message.data_ptr(), sizeof(value));
+    EXPECT_EQ(value, received);
+    received++;
+  }
+  producer.join();
+  EXPECT_EQ(received, message_count);
+}
+
+TEST(tcp_message, session_gather_write_order) {
+  boost::asio::io_context io_context;
+  boost::asio::local::stream_protocol::socket server_socket(io_context);
+  boost::asio::local::stream_protocol::socket client_socket(io_context);
+  boost::asio::local::connect_pair(server_socket, client_socket);
+  auto session = make_shared<ngraph::he::TCPSession>(
+      std::move(server_socket), [](const ngraph::he::TCPMessage&) {});
+
+  // Messages queued before the io_context runs are written in batches of
+  // max_gather_messages
+  size_t message_count = 3 * ngraph::he::TCPSession::max_gather_messages + 5;
+  for (size_t i = 0; i < message_count; ++i) {
+    session->write_message(value_message(i, 100 + 37 * i));
+  }
+  std::thread io_thread([&]() { io_context.run(); });
+
+  for (size_t i = 0; i < message_count; ++i) {
+    EXPECT_EQ(read_value(client_socket), i);
+  }
+  session->close();
+  client_socket.close();
+  io_thread.join();
+}
+
+TEST(tcp_message, session_write_blocks_when_queue_full) {
+  boost::asio::io_context io_context;
+  boost::asio::local::stream_protocol::socket server_socket(io_context);
+  boost::asio::local::stream_protocol::socket client_socket(io_context);
+  boost::asio::local::connect_pair(server_socket, client_socket);
+  size_t max_queued_bytes = 1000;
+  auto session = make_shared<ngraph::he::TCPSession>(
+      std::move(server_socket), [](const ngraph::he::TCPMessage&) {},
+      max_queued_bytes);
+
+  // Nothing is written while the io_context is not running, so the second
+  // write waits once the first one filled the queue
+  std::atomic<size_t> written{0};
+  std::thread writer([&]() {
+    session->write_message(value_message(0, max_queued_bytes));
+    written++;
+    session->write_message(value_message(1, 10));
+    written++;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  EXPECT_EQ(written, 1u);
+
+  // The io_context keeps running until the second write has been queued
+  auto work = boost::asio::make_work_guard(io_context);
+  std::thread io_thread([&]() { io_context.run(); });
+  EXPECT_EQ(read_value(client_socket), 0u);
+  EXPECT_EQ(read_value(client_socket), 1u);
+  writer.join();
+  EXPECT_EQ(written, 2u);
+
+  session->close();
+  client_socket.close();
+  work.reset();
+  io_thread.join();
+}
+
+TEST(tcp_message, session_outlives_handle_until_peer_closes) {
+  boost::asio::io_context io_context;
+  boost::asio::local::stream_protocol::socket server_socket(io_context);
+  boost::asio::local::stream_protocol::socket client_socket(io_context);
+  boost::asio::local::connect_pair(server_socket, client_socket);
+
+  // The handler owns each message, and runs after the last external
+  // reference to the session is dropped
+  size_t message_count = 3 * ngraph::he::TCPSession::decode_queue_capacity;
+  vector<ngraph::he::TCPMessage> received;
+  auto session = make_shared<ngraph::he::TCPSession>(
+      std::move(server_socket), [&](ngraph::he::TCPMessage&& message) {
+        received.emplace_back(std::move(message));
+      });
+  weak_ptr<ngraph::he::TCPSession> weak_session = session;
+  boost::asio::post(io_context, [&]() {
+    session->start();
+    session = nullptr;
+  });
+  std::thread io_thread([&]() { io_context.run(); });
+
+  for (size_t i = 0; i < message_count; ++i) {
+    ngraph::he::TCPMessage message = value_message(i, 100);
+    boost::asio::write(client_socket, boost::asio::buffer(message.header_ptr(),
+                                                          message.num_bytes()));
+  }
+  client_socket.shutdown(boost::asio::socket_base::shutdown_send);
+  io_thread.join();
+
+  // Messages read before end of file are handled before the session is freed
+  while (!weak_session.expired()) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  ASSERT_EQ(received.size(), message_count);
+  for (size_t i = 0; i < message_count; ++i) {
+    size_t value;
+    memcpy(&value, received[i].data_ptr(), sizeof(value));
+    EXPECT_EQ(value, i);
+  }
+}
+
+TEST(tcp_message, session_close_from_handler) {
+  boost::asio::io_context io_context;
+  boost::asio::local::stream_protocol::socket server_socket(io_context);
+  boost::asio::local::stream_protocol::socket client_socket(io_context);
+  boost::asio::local::connect_pair(server_socket, client_socket);
+
+  // Closing the session from its handler neither joins nor frees the decode
+  // thread while it runs
+  std::atomic<size_t> handled{0};
+  shared_ptr<ngraph::he::TCPSession> session;
+  weak_ptr<ngraph::he::TCPSession> weak_session;
+  session = make_shared<ngraph::he::TCPSession>(
+      std::move(server_socket), [&](ngraph::he::TCPMessage&&) {
+        weak_session.lock()->close();
+        handled++;
+      });
+  weak_session = session;
+  boost::asio::post(io_context, [&]() {
+    session->start();
+    session = nullptr;
+  });
+  std::thread io_thread([&]() { io_context.run(); });
+
+  ngraph::he::TCPMessage message = value_message(0, 100);
+  boost::asio::write(client_socket, boost::asio::buffer(message.header_ptr(),
+                                                        message.num_bytes()));
+  // The session closes its end, so the client reads end of file
+  char byte;
+  boost::system::error_code ec;
+  boost::asio::read(client_socket, boost::asio::buffer(&byte, 1), ec);
+  EXPECT_EQ(ec, boost::asio::error::eof);
+  io_thread.join();
+
+  while (!weak_session.expired()) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  EXPECT_EQ(handled, 1u);
+}
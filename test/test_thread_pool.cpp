@@ -0,0 +1,114 @@
+//*****************************************************************************
+// Copyright 2018-2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//*****************************************************************************
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "seal/thread_pool.hpp"
+
+using namespace std;
+
+TEST(thread_pool, parallel_for) {
+  ngraph::he::ThreadPool pool(4);
+  EXPECT_EQ(pool.num_threads(), 4u);
+
+  vector<size_t> out(1000, 0);
+  pool.parallel_for(0, out.size(), [&](size_t i) { out[i] = i * i; });
+  for (size_t i = 0; i < out.size(); ++i) {
+    EXPECT_EQ(out[i], i * i);
+  }
+}
+
+TEST(thread_pool, nested_parallel_for) {
+  ngraph::he::ThreadPool pool(2);
+  atomic<size_t> count{0};
+  pool.parallel_for(0, 16, [&](size_t i) {
+    pool.parallel_for(0, 16, [&](size_t j) { count++; });
+  });
+  EXPECT_EQ(count.load(), 16u * 16u);
+}
+
+TEST(thread_pool, parallel_for_exception) {
+  ngraph::he::ThreadPool pool(4);
+  EXPECT_THROW(pool.parallel_for(0, 100,
+                                 [](size_t i) {
+                                   if (i == 50) {
+                                     throw runtime_error("error");
+                                   }
+                                 }),
+               runtime_error);
+}
+
+TEST(thread_pool, submit) {
+  ngraph::he::ThreadPool pool(3);
+  mutex mtx;
+  condition_variable cond;
+  size_t done = 0;
+  for (size_t i = 0; i < 10; ++i) {
+    pool.submit([&]() {
+      lock_guard<mutex> guard(mtx);
+      done++;
+      cond.notify_all();
+    });
+  }
+  unique_lock<mutex> lock(mtx);
+  cond.wait(lock, [&done] { return done == 10; });
+  EXPECT_EQ(done, 10u);
+}
+
+TEST(thread_pool, parallel_for_waits_without_running_other_tasks) {
+  ngraph::he::ThreadPool pool(1);
+  const thread::id caller_id = this_thread::get_id();
+  atomic<bool> worker_started{false};
+  atomic<bool> task_submitted{false};
+  mutex mtx;
+  condition_variable cond;
+  bool task_done = false;
+  thread::id task_thread_id;
+
+  // The caller and the worker each run one index. The caller submits a task,
+  // then waits for the worker's index with that task pending
+  pool.parallel_for(0, 2, [&](size_t) {
+    if (this_thread::get_id() == caller_id) {
+      while (!worker_started) {
+        this_thread::yield();
+      }
+      pool.submit([&]() {
+        lock_guard<mutex> guard(mtx);
+        task_thread_id = this_thread::get_id();
+        task_done = true;
+        cond.notify_all();
+      });
+      task_submitted = true;
+    } else {
+      worker_started = true;
+      while (!task_submitted) {
+        this_thread::yield();
+      }
+      this_thread::sleep_for(chrono::milliseconds(50));
+    }
+  });
+
+  unique_lock<mutex> lock(mtx);
+  cond.wait(lock, [&task_done] { return task_done; });
+  EXPECT_NE(task_thread_id, caller_id);
+}